@@ -54,6 +54,10 @@ int process_fork()
     int status;
     struct pcb_s* child_process = sys_fork();
 
+    if (child_process == FORK_FAILED)
+    {
+        return EXIT_FAILURE;
+    }
     if (child_process == 0)
     {
         //On est dans le processus fils.
@@ -186,6 +190,12 @@ int process_screen_top_left()
 
     child_process = sys_fork();
 
+    if (child_process == FORK_FAILED)
+    {
+        //Sans fils, le pere dessine seul.
+        game_of_life(width + 5, 0, width - 5, height - 5, 8);
+        return EXIT_FAILURE;
+    }
     if (child_process == 0)
     {
         //On est dans le processus fils.
@@ -226,9 +236,9 @@ int kmain( void )
     kheap_init();
     sched_init();
 
-    process_screen_right_pcb = sys_create_process((func_t*)&process_screen_right, 18);
-    process_screen_top_left_pcb = sys_create_process((func_t*)&process_screen_top_left, 20);
-    process_screen_bottom_left_pcb = sys_create_process((func_t*)&process_screen_bottom_left, 20);
+    process_screen_right_pcb = sys_create_process((func_t*)&process_screen_right, 18, PROCESS_STACK_LIMIT);
+    process_screen_top_left_pcb = sys_create_process((func_t*)&process_screen_top_left, 20, PROCESS_STACK_LIMIT);
+    process_screen_bottom_left_pcb = sys_create_process((func_t*)&process_screen_bottom_left, 20, PROCESS_STACK_LIMIT);
 	
 	// ******************************************
 	// switch CPU to USER mode
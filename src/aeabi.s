@@ -0,0 +1,97 @@
+;@ Points d'entree de la division et des decalages 64 bits attendus par gcc
+;@ (ABI ARM "run-time helper functions"). Le noyau est lie sans libgcc :
+;@ sans ces symboles, un '/' ou un '%' sur des variables ne se lie pas.
+;@ Le calcul est fait en C dans division.c, ces fonctions ne font
+;@ qu'adapter les conventions d'appel.
+
+;@ unsigned __aeabi_uidiv(unsigned n, unsigned d)
+.globl __aeabi_uidiv
+__aeabi_uidiv:
+	mov r2, #0
+	b udiv32
+
+;@ {unsigned q, unsigned r} __aeabi_uidivmod(unsigned n, unsigned d)
+;@ Quotient dans r0, reste dans r1.
+.globl __aeabi_uidivmod
+__aeabi_uidivmod:
+	push {r0, lr}          @ r0 ne sert qu'a reserver la case du reste
+	mov r2, sp
+	bl udiv32
+	pop {r1, lr}
+	mov pc, lr
+
+;@ int __aeabi_idiv(int n, int d)
+.globl __aeabi_idiv
+__aeabi_idiv:
+	mov r2, #0
+	b sdiv32
+
+;@ {int q, int r} __aeabi_idivmod(int n, int d)
+.globl __aeabi_idivmod
+__aeabi_idivmod:
+	push {r0, lr}
+	mov r2, sp
+	bl sdiv32
+	pop {r1, lr}
+	mov pc, lr
+
+;@ {uint64 q, uint64 r} __aeabi_uldivmod(uint64 n, uint64 d)
+;@ n dans r0:r1, d dans r2:r3. Quotient dans r0:r1, reste dans r2:r3.
+;@ Le pointeur vers le reste est le 5eme argument, passe sur la pile.
+.globl __aeabi_uldivmod
+__aeabi_uldivmod:
+	push {r4, lr}
+	sub sp, sp, #16
+	add r4, sp, #8
+	str r4, [sp]
+	bl udiv64
+	ldr r2, [sp, #8]
+	ldr r3, [sp, #12]
+	add sp, sp, #16
+	pop {r4, pc}
+
+;@ {int64 q, int64 r} __aeabi_ldivmod(int64 n, int64 d)
+.globl __aeabi_ldivmod
+__aeabi_ldivmod:
+	push {r4, lr}
+	sub sp, sp, #16
+	add r4, sp, #8
+	str r4, [sp]
+	bl sdiv64
+	ldr r2, [sp, #8]
+	ldr r3, [sp, #12]
+	add sp, sp, #16
+	pop {r4, pc}
+
+;@ uint64 __aeabi_llsl(uint64 x, int n) : decalage logique a gauche.
+.globl __aeabi_llsl
+__aeabi_llsl:
+	subs r3, r2, #32
+	rsb ip, r2, #32
+	movmi r1, r1, lsl r2
+	movpl r1, r0, lsl r3
+	orrmi r1, r1, r0, lsr ip
+	mov r0, r0, lsl r2
+	mov pc, lr
+
+;@ uint64 __aeabi_llsr(uint64 x, int n) : decalage logique a droite.
+.globl __aeabi_llsr
+__aeabi_llsr:
+	subs r3, r2, #32
+	rsb ip, r2, #32
+	movmi r0, r0, lsr r2
+	movpl r0, r1, lsr r3
+	orrmi r0, r0, r1, lsl ip
+	mov r1, r1, lsr r2
+	mov pc, lr
+
+;@ int64 __aeabi_lasr(int64 x, int n) : decalage arithmetique a droite.
+.globl __aeabi_lasr
+__aeabi_lasr:
+	subs r3, r2, #32
+	rsb ip, r2, #32
+	movmi r0, r0, lsr r2
+	movpl r0, r1, asr r3
+	orrmi r0, r0, r1, lsl ip
+	mov r1, r1, asr r2
+	mov pc, lr
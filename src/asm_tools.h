@@ -12,17 +12,6 @@
 #define ENABLE_AB()    __asm volatile("cpsie a");
 #define DISABLE_AB()    __asm volatile("cpsid a");				
 
-#define LOAD_KERNEL_PAGE_TABLE()					\
-    __asm volatile("push {r0}");					\
-    __asm volatile("mov	r0, %0" : : "r"(kmain_process.page_table));	\
-    __asm volatile("mcr 	p15, 0, r0, c2, c0, 0");		\
-    __asm volatile("pop {r0}");
-
-
-#define LOAD_CURRENT_PAGE_TABLE()					\
-    __asm volatile("mov	  r0, %0" : : "r"(current_process->page_table)); \
-    __asm volatile("mcr   p15, 0, r0, c2, c0, 0");
-
 #define INVALIDATE_TLB()				\
     __asm volatile("mcr   p15, 0, sp, c8, c7, 0");
 
@@ -35,5 +24,12 @@ void delay(unsigned int c);
 void memory_barrier();
 void invalidate_cache();
 void invalidate_tlb_asm();
+void clean_data_cache();
+void clean_invalidate_data_cache();
+void invalidate_instruction_cache();
+void clean_data_cache_range(const void* start, uint32_t size);
+void clean_invalidate_data_cache_range(const void* start, uint32_t size);
+void invalidate_tlb_entry(const void* address, uint32_t asid);
+void invalidate_tlb_asid(uint32_t asid);
 
 #endif
@@ -39,3 +39,86 @@ invalidate_cache:
    mcr   p15, 0, r0, c7, c7, 0
    mov   pc, lr
 
+
+;@ Maintenance du cache de donnees L1 (16ko, lignes de 32 octets).
+;@ Les caches de l'ARM1176 sont indexes et etiquetes physiquement pour des pages
+;@ de 4ko : un changement de table des pages ne demande pas de les vider.
+;@ Il faut par contre nettoyer ce que la MMU et les peripheriques lisent en memoire.
+
+;@ Ecrit en memoire toutes les lignes modifiees du cache de donnees.
+;@ void clean_data_cache()
+.globl clean_data_cache
+clean_data_cache:
+   mov   r0, #0
+   mcr   p15, 0, r0, c7, c10, 0     @ clean entire D cache
+   mcr   p15, 0, r0, c7, c10, 4     @ drain write buffer
+   mov   pc, lr
+
+;@ Ecrit en memoire puis invalide tout le cache de donnees.
+;@ void clean_invalidate_data_cache()
+.globl clean_invalidate_data_cache
+clean_invalidate_data_cache:
+   mov   r0, #0
+   mcr   p15, 0, r0, c7, c14, 0     @ clean and invalidate entire D cache
+   mcr   p15, 0, r0, c7, c10, 4     @ drain write buffer
+   mov   pc, lr
+
+;@ Invalide le cache d'instructions et la prediction de branchement.
+;@ void invalidate_instruction_cache()
+.globl invalidate_instruction_cache
+invalidate_instruction_cache:
+   mov   r0, #0
+   mcr   p15, 0, r0, c7, c5, 0      @ invalidate I cache
+   mcr   p15, 0, r0, c7, c5, 6      @ invalidate BTB
+   mcr   p15, 0, r0, c7, c5, 4      @ prefetch flush
+   mov   pc, lr
+
+;@ Ecrit en memoire les lignes du cache de donnees d'une zone.
+;@ void clean_data_cache_range(const void* start, uint32_t size)
+.globl clean_data_cache_range
+clean_data_cache_range:
+   add   r1, r0, r1
+   bic   r0, r0, #31
+clean_data_cache_range_loop:
+   cmp   r0, r1
+   mcrlo p15, 0, r0, c7, c10, 1     @ clean D cache line by MVA
+   addlo r0, r0, #32
+   blo   clean_data_cache_range_loop
+   mov   r0, #0
+   mcr   p15, 0, r0, c7, c10, 4     @ drain write buffer
+   mov   pc, lr
+
+;@ Ecrit en memoire puis invalide les lignes du cache de donnees d'une zone.
+;@ void clean_invalidate_data_cache_range(const void* start, uint32_t size)
+.globl clean_invalidate_data_cache_range
+clean_invalidate_data_cache_range:
+   add   r1, r0, r1
+   bic   r0, r0, #31
+clean_invalidate_data_cache_range_loop:
+   cmp   r0, r1
+   mcrlo p15, 0, r0, c7, c14, 1     @ clean and invalidate D cache line by MVA
+   addlo r0, r0, #32
+   blo   clean_invalidate_data_cache_range_loop
+   mov   r0, #0
+   mcr   p15, 0, r0, c7, c10, 4     @ drain write buffer
+   mov   pc, lr
+
+;@ Invalide l'entree de la TLB d'une page.
+;@ L'ASID n'est compare que pour les pages non globales.
+;@ void invalidate_tlb_entry(const void* address, uint32_t asid)
+.globl invalidate_tlb_entry
+invalidate_tlb_entry:
+   bic   r0, r0, #0xFF
+   bic   r0, r0, #0xF00
+   and   r1, r1, #0xFF
+   orr   r0, r0, r1
+   mcr   p15, 0, r0, c8, c7, 1      @ invalidate unified TLB entry by MVA
+   mov   pc, lr
+
+;@ Invalide toutes les entrees non globales de la TLB d'un ASID.
+;@ void invalidate_tlb_asid(uint32_t asid)
+.globl invalidate_tlb_asid
+invalidate_tlb_asid:
+   and   r0, r0, #0xFF
+   mcr   p15, 0, r0, c8, c7, 2      @ invalidate unified TLB on ASID match
+   mov   pc, lr
@@ -0,0 +1,155 @@
+#include "buddy.h"
+#include "kheap.h"
+
+//Ordre d'une frame qui ne commence pas un bloc libre.
+#define BUDDY_NOT_FREE 0xFF
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Ajoute un bloc libre en tete de la liste de son ordre.
+ */
+void buddy_push(BuddyZone* zone, uint32_t frame, uint32_t order);
+
+/**
+ * Retire un bloc libre de la liste de son ordre.
+ */
+void buddy_remove(BuddyZone* zone, uint32_t frame, uint32_t order);
+
+
+void buddy_push(BuddyZone* zone, uint32_t frame, uint32_t order)
+{
+	uint32_t index = frame - zone->first_frame;
+	uint32_t head = zone->free_list[order];
+
+	zone->next[index] = head;
+	zone->previous[index] = BUDDY_NONE;
+	if (head != BUDDY_NONE)
+	{
+		zone->previous[head - zone->first_frame] = frame;
+	}
+	zone->free_list[order] = frame;
+	zone->order[index] = order;
+
+	zone->free_block_count[order]++;
+	zone->free_frame_count += 1 << order;
+}
+
+void buddy_remove(BuddyZone* zone, uint32_t frame, uint32_t order)
+{
+	uint32_t index = frame - zone->first_frame;
+	uint32_t next = zone->next[index];
+	uint32_t previous = zone->previous[index];
+
+	if (previous != BUDDY_NONE)
+	{
+		zone->next[previous - zone->first_frame] = next;
+	}
+	else
+	{
+		zone->free_list[order] = next;
+	}
+	if (next != BUDDY_NONE)
+	{
+		zone->previous[next - zone->first_frame] = previous;
+	}
+	zone->order[index] = BUDDY_NOT_FREE;
+
+	zone->free_block_count[order]--;
+	zone->free_frame_count -= 1 << order;
+}
+
+//----------------------------------------------------------Realisations
+void buddy_init(BuddyZone* zone, uint32_t first_frame, uint32_t frame_count)
+{
+	zone->first_frame = first_frame;
+	zone->frame_count = frame_count;
+	//Les chainages ne sont lus que pour les frames qui commencent un bloc libre.
+	zone->next = (uint32_t*)kAlloc(frame_count * sizeof(uint32_t));
+	zone->previous = (uint32_t*)kAlloc(frame_count * sizeof(uint32_t));
+	zone->order = kAlloc(frame_count);
+
+	for (uint32_t i = 0;i < frame_count;i++)
+	{
+		zone->order[i] = BUDDY_NOT_FREE;
+	}
+	for (uint32_t order = 0;order < BUDDY_ORDER_COUNT;order++)
+	{
+		zone->free_list[order] = BUDDY_NONE;
+		zone->free_block_count[order] = 0;
+	}
+	zone->free_frame_count = 0;
+}
+
+void buddy_add_range(BuddyZone* zone, uint32_t first_frame, uint32_t last_frame)
+{
+	uint32_t frame = first_frame;
+	while (frame < last_frame)
+	{
+		//Le plus grand bloc aligne qui commence a cette frame et tient dans la plage.
+		uint32_t order = 0;
+		while (order < BUDDY_MAX_ORDER
+			&& (frame & ((1 << (order + 1)) - 1)) == 0
+			&& frame + (1 << (order + 1)) <= last_frame)
+		{
+			order++;
+		}
+		buddy_free(zone, frame, order);
+		frame += 1 << order;
+	}
+}
+
+uint32_t buddy_alloc(BuddyZone* zone, uint32_t order)
+{
+	//On cherche le plus petit bloc libre assez grand.
+	uint32_t block_order = order;
+	while (block_order < BUDDY_ORDER_COUNT && zone->free_list[block_order] == BUDDY_NONE)
+	{
+		block_order++;
+	}
+	if (block_order >= BUDDY_ORDER_COUNT)
+	{
+		return BUDDY_NONE;
+	}
+
+	uint32_t frame = zone->free_list[block_order];
+	buddy_remove(zone, frame, block_order);
+	//On coupe le bloc en deux, la moitie haute reste libre.
+	while (block_order > order)
+	{
+		block_order--;
+		buddy_push(zone, frame + (1 << block_order), block_order);
+	}
+	return frame;
+}
+
+void buddy_free(BuddyZone* zone, uint32_t frame, uint32_t order)
+{
+	//Tant que le voisin du bloc est libre et du meme ordre, on les fusionne.
+	while (order < BUDDY_MAX_ORDER)
+	{
+		uint32_t buddy = frame ^ (1 << order);
+		if (!buddy_contains(zone, buddy) || zone->order[buddy - zone->first_frame] != order)
+		{
+			break;
+		}
+		buddy_remove(zone, buddy, order);
+		frame &= ~(1 << order);
+		order++;
+	}
+	buddy_push(zone, frame, order);
+}
+
+int buddy_contains(const BuddyZone* zone, uint32_t frame)
+{
+	return frame >= zone->first_frame && frame - zone->first_frame < zone->frame_count;
+}
+
+uint32_t buddy_free_frame_count(const BuddyZone* zone)
+{
+	return zone->free_frame_count;
+}
+
+uint32_t buddy_free_block_count(const BuddyZone* zone, uint32_t order)
+{
+	return zone->free_block_count[order];
+}
@@ -0,0 +1,94 @@
+#ifndef BUDDY_H
+#define BUDDY_H
+
+#include <inttypes.h>
+
+//Un bloc d'ordre n contient 2^n frames consecutives, alignees sur 2^n frames.
+//Les plus grands blocs font 2^BUDDY_MAX_ORDER frames (4Mo).
+#define BUDDY_MAX_ORDER 10
+#define BUDDY_ORDER_COUNT (BUDDY_MAX_ORDER + 1)
+
+//Fin d'une liste de blocs libres.
+#define BUDDY_NONE UINT32_MAX
+
+//-----------------------------------------------------------------Types
+/**
+ * Une zone de frames consecutives gerees par un allocateur buddy.
+ * Les blocs libres de chaque ordre sont chaines dans une liste doublement chainee.
+ * Les chainages sont gardes hors des frames, qui ne sont pas forcement projetees
+ * dans la table du noyau.
+ */
+struct BuddyZone
+{
+	//Premiere frame de la zone et nombre de frames.
+	uint32_t first_frame;
+	uint32_t frame_count;
+	//Pour chaque frame de la zone, la frame suivante et precedente dans sa liste de blocs libres.
+	uint32_t* next;
+	uint32_t* previous;
+	//Pour chaque frame de la zone, l'ordre du bloc libre qui commence a cette frame,
+	//ou BUDDY_NOT_FREE.
+	uint8_t* order;
+	//La premiere frame de chaque liste de blocs libres.
+	uint32_t free_list[BUDDY_ORDER_COUNT];
+	//Statistiques : le nombre de blocs libres de chaque ordre et de frames libres.
+	uint32_t free_block_count[BUDDY_ORDER_COUNT];
+	uint32_t free_frame_count;
+};
+typedef struct BuddyZone BuddyZone;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Initialise une zone, dont toutes les frames sont occupees.
+ * Les frames sont ensuite rendues a la zone par buddy_add_range.
+ * @param zone La zone a initialiser.
+ * @param first_frame La premiere frame de la zone.
+ * @param frame_count Le nombre de frames de la zone.
+ */
+void buddy_init(BuddyZone* zone, uint32_t first_frame, uint32_t frame_count);
+
+/**
+ * Ajoute une plage de frames libres a une zone, par les plus grands blocs possibles.
+ * @param zone La zone dans laquelle ajouter les frames.
+ * @param first_frame La premiere frame de la plage.
+ * @param last_frame La frame qui suit la plage.
+ */
+void buddy_add_range(BuddyZone* zone, uint32_t first_frame, uint32_t last_frame);
+
+/**
+ * Alloue un bloc de 2^order frames consecutives, en O(log n).
+ * Un bloc plus grand est coupe en deux autant de fois que necessaire.
+ * @param zone La zone dans laquelle allouer le bloc.
+ * @param order L'ordre du bloc.
+ * @return La premiere frame du bloc, ou BUDDY_NONE si aucun bloc n'est assez grand.
+ */
+uint32_t buddy_alloc(BuddyZone* zone, uint32_t order);
+
+/**
+ * Libere un bloc de 2^order frames, en le fusionnant avec son voisin (buddy)
+ * tant que celui-ci est libre, en O(log n).
+ * Les frames d'un bloc peuvent aussi etre liberees une par une, a l'ordre 0.
+ * @param zone La zone a laquelle rendre le bloc.
+ * @param frame La premiere frame du bloc.
+ * @param order L'ordre du bloc.
+ */
+void buddy_free(BuddyZone* zone, uint32_t frame, uint32_t order);
+
+/**
+ * Retourne 1 si une frame fait partie d'une zone, 0 sinon.
+ */
+int buddy_contains(const BuddyZone* zone, uint32_t frame);
+
+/**
+ * Retourne le nombre de frames libres d'une zone.
+ */
+uint32_t buddy_free_frame_count(const BuddyZone* zone);
+
+/**
+ * Retourne le nombre de blocs libres d'un ordre dans une zone.
+ * @param zone La zone.
+ * @param order L'ordre des blocs.
+ */
+uint32_t buddy_free_block_count(const BuddyZone* zone, uint32_t order);
+
+#endif
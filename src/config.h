@@ -8,5 +8,24 @@
 #define QEMU 0
 #define DEBUG 1
 #define VMEM 1
+//Remplit les blocs du tas noyau de FORBIDDEN_BYTE a l'allocation et a la liberation.
+#define KHEAP_POISON 0
+//Un bloc libre du tas d'un processus de plus de HEAP_TRIM_THRESHOLD + HEAP_TOP_PAD octets rend ses pages,
+//sauf celles de ses HEAP_TOP_PAD premiers octets. A la fin du tas, les pages rendues sont retirees du tas.
+//En dessous, rien n'est rendu : un tas qui oscille ne refait pas sans cesse les memes fautes.
+#define HEAP_TRIM_THRESHOLD (64 * 1024)
+#define HEAP_TOP_PAD (16 * 1024)
+//Le nombre de frames remplies de 0 a l'avance, et le nombre de frames remplies
+//a chaque sys_yield, quand aucun autre processus n'est pret.
+#define ZEROED_POOL_SIZE 32
+#define ZEROED_FRAMES_PER_YIELD 4
+//Le nombre de pages des processus examinees par le scanner de merge.c, qui partage
+//les pages identiques, a chaque sys_yield quand aucun autre processus n'est pret.
+//0 desactive le scanner.
+#define MERGE_PAGES_PER_YIELD 16
+//Le nombre de frames que l'horloge du swap (swap.c) libere quand l'allocateur de frames est vide,
+//et le nombre maximal d'emplacements d'une page pris dans la partition de swap de la carte SD.
+#define SWAP_RECLAIM_BATCH 8
+#define SWAP_SLOT_MAX 65536
 
 #endif
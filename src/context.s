@@ -0,0 +1,80 @@
+;@ Entrees et sorties des exceptions qui peuvent changer de processus.
+;@ Les registres du processus interrompu sont sauvegardes directement dans
+;@ sa PCB (current_process), puis le handler C est appele avec r0 pointant
+;@ sur ces registres. Au retour, on restaure la PCB de current_process, qui
+;@ a pu changer : un changement de contexte revient a changer current_process.
+;@ Rien ne reste sur les piles des modes noyau entre deux exceptions.
+;@ Les handlers C s'executent tous sur la pile du mode SVC : les modes IRQ et ABT
+;@ partagent une petite pile, qui ne garde que les deux mots de SAVE_CONTEXT.
+;@ Les interruptions restent masquees : le lr du mode SVC n'est utilise par aucune
+;@ autre exception, et RESTORE_CONTEXT reprend le SPSR et le lr dans la PCB.
+
+;@ Decalages dans struct pcb_s (PCB_OFFSET_* de sched.h).
+;@ Des _Static_assert dans sched.c verifient qu'ils sont a jour.
+.equ PCB_OFFSET_SP,         52
+.equ PCB_OFFSET_LR_USER,    56
+.equ PCB_OFFSET_LR_SVC,     60
+.equ PCB_OFFSET_CPSR,       64
+
+;@ Sauvegarde r0-r12, sp et lr du mode user, l'adresse de retour (lr)
+;@ et le SPSR dans current_process.
+;@ Le noyau est projete par TTBR0 dans tous les processus : la PCB est
+;@ accessible sans changer de table des pages.
+;@ En sortie, r0 pointe sur la PCB, c'est-a-dire sur ses registres.
+.macro SAVE_CONTEXT
+	push {r0, r1}
+	ldr r0, =current_process
+	ldr r0, [r0]
+	stmia r0, {r0-r14}^            @ r0-r12, sp et lr du mode user
+	nop                            @ pas d'acces aux registres banques juste apres stm^
+	pop {r1, r2}
+	stmia r0, {r1, r2}             @ les vrais r0 et r1 du processus
+	str lr, [r0, #PCB_OFFSET_LR_SVC]
+	mrs r1, spsr
+	str r1, [r0, #PCB_OFFSET_CPSR]
+.endm
+
+;@ Restaure le contexte de current_process et retourne vers lui.
+;@ Sa table des pages (TTBR1) a deja ete chargee par l'ordonnanceur.
+.macro RESTORE_CONTEXT
+	ldr r0, =current_process
+	ldr r0, [r0]
+	ldr r1, [r0, #PCB_OFFSET_CPSR]
+	msr spsr_cxsf, r1
+	ldr lr, [r0, #PCB_OFFSET_LR_SVC]
+	add r1, r0, #PCB_OFFSET_SP
+	ldmia r1, {sp, lr}^            @ sp et lr du mode user
+	nop
+	ldmia r0, {r1, r2}
+	push {r1, r2}                  @ r0 et r1 du processus
+	add r0, r0, #8
+	ldmia r0, {r2-r12}
+	pop {r0, r1}
+	movs pc, lr                    @ retour, CPSR = SPSR
+.endm
+
+;@ Appel systeme : le numero est dans r0, les parametres dans r1-r3.
+.globl swi_handler
+swi_handler:
+	SAVE_CONTEXT
+	bl swi_handler_C
+	RESTORE_CONTEXT
+
+;@ Interruption du timer : on reprendra l'instruction interrompue.
+.globl irq_handler
+irq_handler:
+	sub lr, lr, #4
+	SAVE_CONTEXT
+	cps #0x13                      @ mode SVC, pour sa pile
+	bl irq_handler_C
+	RESTORE_CONTEXT
+
+;@ Data abort : lr pointe 8 octets apres l'instruction fautive.
+;@ Le handler peut copier des frames, faire grandir la pile ou lire le swap.
+.globl data_handler
+data_handler:
+	sub lr, lr, #8
+	SAVE_CONTEXT
+	cps #0x13                      @ mode SVC, pour sa pile
+	bl data_handler_C
+	RESTORE_CONTEXT
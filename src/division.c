@@ -0,0 +1,223 @@
+#include "division.h"
+#include "config.h"
+#include "util.h"
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Retourne le nombre de zeros en tete d'un entier sur 64 bits non nul.
+ */
+static inline uint32_t clz64(uint64_t x);
+
+/**
+ * Retourne les 64 bits de poids fort du produit de deux entiers sur 64 bits.
+ */
+static inline uint64_t mulhi64(uint64_t a, uint64_t b);
+
+
+static inline uint32_t clz64(uint64_t x)
+{
+	uint32_t high = (uint32_t)(x >> 32);
+	if (high != 0)
+	{
+		return __builtin_clz(high);
+	}
+	return 32 + __builtin_clz((uint32_t)x);
+}
+
+static inline uint64_t mulhi64(uint64_t a, uint64_t b)
+{
+	//On decoupe en mots de 32 bits pour n'utiliser que des umull.
+	uint64_t a0 = (uint32_t)a;
+	uint64_t a1 = a >> 32;
+	uint64_t b0 = (uint32_t)b;
+	uint64_t b1 = b >> 32;
+
+	uint64_t p00 = a0 * b0;
+	uint64_t p01 = a0 * b1;
+	uint64_t p10 = a1 * b0;
+	uint64_t p11 = a1 * b1;
+
+	//La retenue des mots du milieu remonte dans le mot de poids fort.
+	uint64_t middle = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+	return p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+}
+
+//----------------------------------------------------------Realisations
+uint32_t udiv32(uint32_t n, uint32_t d, uint32_t* remainder)
+{
+	uint32_t quotient = 0;
+
+	if (d == 0)
+	{
+		PANIC();
+	}
+
+	if (n >= d)
+	{
+		//On aligne le bit de poids fort du diviseur sur celui du dividende.
+		//Il y a donc une iteration par bit du quotient, et non par unite.
+		uint32_t shift = __builtin_clz(d) - __builtin_clz(n);
+		d <<= shift;
+		for (uint32_t i = 0;i <= shift;i++)
+		{
+			quotient <<= 1;
+			if (n >= d)
+			{
+				n -= d;
+				quotient |= 1;
+			}
+			d >>= 1;
+		}
+	}
+
+	if (remainder != NULL)
+	{
+		*remainder = n;
+	}
+	return quotient;
+}
+
+int32_t sdiv32(int32_t n, int32_t d, int32_t* remainder)
+{
+	//On passe par les valeurs absolues en non signe pour supporter INT32_MIN.
+	uint32_t abs_n = (n < 0) ? -(uint32_t)n : (uint32_t)n;
+	uint32_t abs_d = (d < 0) ? -(uint32_t)d : (uint32_t)d;
+	uint32_t abs_r;
+	uint32_t abs_q = udiv32(abs_n, abs_d, &abs_r);
+
+	if (remainder != NULL)
+	{
+		//Le reste a le signe du dividende.
+		*remainder = (n < 0) ? -(int32_t)abs_r : (int32_t)abs_r;
+	}
+	//Le quotient est negatif si les signes different.
+	return ((n < 0) != (d < 0)) ? -(int32_t)abs_q : (int32_t)abs_q;
+}
+
+uint64_t udiv64(uint64_t n, uint64_t d, uint64_t* remainder)
+{
+	uint64_t quotient = 0;
+
+	if (d == 0)
+	{
+		PANIC();
+	}
+
+	//Si les deux operandes tiennent sur 32 bits, on fait la division courte.
+	if ((n >> 32) == 0 && (d >> 32) == 0)
+	{
+		uint32_t short_remainder;
+		quotient = udiv32((uint32_t)n, (uint32_t)d, &short_remainder);
+		n = short_remainder;
+	}
+	else if (n >= d)
+	{
+		//On aligne le bit de poids fort du diviseur sur celui du dividende.
+		uint32_t shift = clz64(d) - clz64(n);
+		d <<= shift;
+		for (uint32_t i = 0;i <= shift;i++)
+		{
+			quotient <<= 1;
+			if (n >= d)
+			{
+				n -= d;
+				quotient |= 1;
+			}
+			d >>= 1;
+		}
+	}
+
+	if (remainder != NULL)
+	{
+		*remainder = n;
+	}
+	return quotient;
+}
+
+int64_t sdiv64(int64_t n, int64_t d, int64_t* remainder)
+{
+	uint64_t abs_n = (n < 0) ? -(uint64_t)n : (uint64_t)n;
+	uint64_t abs_d = (d < 0) ? -(uint64_t)d : (uint64_t)d;
+	uint64_t abs_r;
+	uint64_t abs_q = udiv64(abs_n, abs_d, &abs_r);
+
+	if (remainder != NULL)
+	{
+		*remainder = (n < 0) ? -(int64_t)abs_r : (int64_t)abs_r;
+	}
+	return ((n < 0) != (d < 0)) ? -(int64_t)abs_q : (int64_t)abs_q;
+}
+
+void reciprocal_init(Reciprocal* reciprocal, uint64_t d)
+{
+	uint32_t floor_log2_d;
+
+	if (d == 0)
+	{
+		PANIC();
+	}
+
+	floor_log2_d = 63 - clz64(d);
+	reciprocal->divisor = d;
+	reciprocal->shift = floor_log2_d;
+	reciprocal->add = 0;
+	reciprocal->magic = 0;
+
+	//Pour une puissance de 2, un simple decalage suffit.
+	if ((d & (d - 1)) == 0)
+	{
+		return;
+	}
+
+	//On calcule m = floor(2^(64 + floor_log2_d) / d) par division longue.
+	//Le mot de poids fort 2^floor_log2_d est inferieur a d, donc m tient sur 64 bits.
+	uint64_t remainder = (uint64_t)1 << floor_log2_d;
+	uint64_t magic = 0;
+	for (uint32_t i = 0;i < 64;i++)
+	{
+		uint32_t carry = (uint32_t)(remainder >> 63);
+		remainder <<= 1;
+		magic <<= 1;
+		if (carry || remainder >= d)
+		{
+			remainder -= d;
+			magic |= 1;
+		}
+	}
+
+	if (d - remainder < ((uint64_t)1 << floor_log2_d))
+	{
+		//L'erreur d'arrondi est assez petite : m + 1 donne un quotient exact.
+		reciprocal->magic = magic + 1;
+	}
+	else
+	{
+		//Sinon il faut un bit de plus : on double m et on corrigera par une addition.
+		uint64_t twice_remainder = remainder + remainder;
+		magic += magic;
+		if (twice_remainder >= d || twice_remainder < remainder)
+		{
+			magic += 1;
+		}
+		reciprocal->magic = magic + 1;
+		reciprocal->add = 1;
+	}
+}
+
+uint64_t reciprocal_divide(uint64_t n, const Reciprocal* reciprocal)
+{
+	uint64_t quotient;
+
+	if (reciprocal->magic == 0)
+	{
+		return n >> reciprocal->shift;
+	}
+
+	quotient = mulhi64(n, reciprocal->magic);
+	if (reciprocal->add)
+	{
+		//Le multiplicateur fait 65 bits, on rajoute n sans deborder.
+		quotient = ((n - quotient) >> 1) + quotient;
+	}
+	return quotient >> reciprocal->shift;
+}
@@ -0,0 +1,73 @@
+#ifndef DIVISION_H
+#define DIVISION_H
+
+#include <inttypes.h>
+
+//-----------------------------------------------------------------Types
+/**
+ * Inverse precalcule d'un diviseur constant sur 64 bits.
+ * La division devient une multiplication haute suivie d'un decalage.
+ */
+struct Reciprocal
+{
+	//Le multiplicateur magique.
+	uint64_t magic;
+	//Le decalage a appliquer apres la multiplication.
+	uint32_t shift;
+	//1 si le multiplicateur deborde sur 65 bits et qu'il faut une addition en plus.
+	uint32_t add;
+	//Le diviseur, utilise directement si c'est une puissance de 2.
+	uint64_t divisor;
+};
+typedef struct Reciprocal Reciprocal;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Division non signee sur 32 bits.
+ * Le temps de calcul depend du nombre de bits du quotient, pas de sa valeur.
+ * @param n Le dividende.
+ * @param d Le diviseur, non nul.
+ * @param remainder Si non nul, recoit le reste de la division.
+ * @return Le quotient.
+ */
+uint32_t udiv32(uint32_t n, uint32_t d, uint32_t* remainder);
+
+/**
+ * Division signee sur 32 bits, le quotient est arrondi vers 0.
+ * @param remainder Si non nul, recoit le reste, du signe du dividende.
+ */
+int32_t sdiv32(int32_t n, int32_t d, int32_t* remainder);
+
+/**
+ * Division non signee sur 64 bits.
+ * Au plus 64 iterations, quelle que soit la valeur du quotient.
+ * @param n Le dividende.
+ * @param d Le diviseur, non nul.
+ * @param remainder Si non nul, recoit le reste de la division.
+ * @return Le quotient.
+ */
+uint64_t udiv64(uint64_t n, uint64_t d, uint64_t* remainder);
+
+/**
+ * Division signee sur 64 bits, le quotient est arrondi vers 0.
+ * @param remainder Si non nul, recoit le reste, du signe du dividende.
+ */
+int64_t sdiv64(int64_t n, int64_t d, int64_t* remainder);
+
+/**
+ * Calcule l'inverse d'un diviseur constant.
+ * Le calcul est couteux, il ne doit etre fait qu'une fois par diviseur.
+ * @param reciprocal La structure a initialiser.
+ * @param d Le diviseur, non nul.
+ */
+void reciprocal_init(Reciprocal* reciprocal, uint64_t d);
+
+/**
+ * Divise n par le diviseur d'un inverse precalcule.
+ * @param n Le dividende.
+ * @param reciprocal L'inverse initialise par reciprocal_init.
+ * @return Le quotient.
+ */
+uint64_t reciprocal_divide(uint64_t n, const Reciprocal* reciprocal);
+
+#endif
@@ -0,0 +1,316 @@
+#include "dma.h"
+#include "slab.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "config.h"
+
+//L'adresse d'un registre d'un canal.
+#define DMA_REGISTER(channel, offset) (DMA_BASE + (channel) * DMA_CHANNEL_SIZE + (offset))
+
+//----------------------------------------------------Variables globales
+
+SlabCache dma_transfer_cache = SLAB_CACHE(sizeof(DmaTransfer), 4, 0);
+SlabCache dma_block_cache = SLAB_CACHE(sizeof(DmaControlBlock), DMA_CONTROL_BLOCK_ALIGNMENT, 0);
+
+//Un bit par canal occupe. Avant dma_init, tous les canaux sont occupes.
+uint32_t dma_used_channels = UINT32_MAX;
+//Un bit par canal lite.
+uint32_t dma_lite_channels = 0;
+//Le transfert en cours sur chaque canal.
+DmaTransfer* dma_channel_transfers[DMA_CHANNEL_COUNT];
+
+//Les transferts lances, ceux qui ont ete refuses faute de canal,
+//ceux qui ont fini en erreur, et les interruptions recues.
+uint32_t dma_started_count = 0;
+uint32_t dma_refused_count = 0;
+uint32_t dma_error_count = 0;
+uint32_t dma_irq_count = 0;
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Ajoute un bloc a la fin d'un transfert.
+ * @return 1 si le bloc est ajoute, 0 si le tas noyau est plein.
+ */
+int dma_append(DmaTransfer* transfer, uint32_t information, uint32_t destination, uint32_t source,
+	uint32_t length, uint32_t stride);
+
+/**
+ * Termine le transfert d'un canal qui n'est plus actif : efface ses flags,
+ * libere le canal et appelle la fonction de fin du transfert.
+ * Ne fait rien si le transfert a deja ete termine.
+ */
+void dma_complete(uint32_t channel);
+
+//----------------------------------------------------------Realisations
+void dma_init()
+{
+	dma_lite_channels = 0;
+	Set32(DMA_ENABLE, Get32(DMA_ENABLE) | DMA_CHANNEL_MASK);
+	for (uint32_t channel = 0;channel < DMA_CHANNEL_COUNT;channel++)
+	{
+		if ((DMA_CHANNEL_MASK & (1 << channel)) == 0)
+		{
+			continue;
+		}
+		Set32(DMA_REGISTER(channel, DMA_CS), DMA_CS_RESET);
+		Set32(DMA_REGISTER(channel, DMA_DEBUG), DMA_DEBUG_ERRORS);
+		if (Get32(DMA_REGISTER(channel, DMA_DEBUG)) & DMA_DEBUG_LITE)
+		{
+			dma_lite_channels |= 1 << channel;
+		}
+		dma_channel_transfers[channel] = NULL;
+		Set32(ENABLE_IRQS_1, 1 << DMA_IRQ_LINE(channel));
+	}
+	dma_used_channels = ~DMA_CHANNEL_MASK;
+}
+
+int dma_usable()
+{
+	uint32_t cpsr;
+	__asm volatile("mrs %[cpsr], cpsr" : [cpsr] "=r"(cpsr));
+	return dma_used_channels != UINT32_MAX && (cpsr & 0x1F) != USER_MODE;
+}
+
+int dma_channel_alloc(int full)
+{
+	uint32_t free_channels = ~dma_used_channels & DMA_CHANNEL_MASK;
+	uint32_t candidates = free_channels & dma_lite_channels;
+
+	if (full || candidates == 0)
+	{
+		candidates = free_channels & ~dma_lite_channels;
+	}
+	if (candidates == 0)
+	{
+		return -1;
+	}
+
+	int channel = __builtin_ctz(candidates);
+	dma_used_channels |= 1 << channel;
+	return channel;
+}
+
+void dma_channel_free(int channel)
+{
+	dma_used_channels &= ~(1 << channel);
+}
+
+DmaTransfer* dma_transfer_create()
+{
+	DmaTransfer* transfer = (DmaTransfer*)slab_alloc(&dma_transfer_cache);
+	if (transfer != FORBIDDEN_ADDRESS)
+	{
+		transfer->first = NULL;
+		transfer->last = NULL;
+		transfer->block_count = 0;
+		transfer->full_channel = 0;
+		transfer->channel = -1;
+		transfer->done = 0;
+		transfer->error = 0;
+		transfer->callback = NULL;
+		transfer->argument = NULL;
+	}
+	return transfer;
+}
+
+int dma_append(DmaTransfer* transfer, uint32_t information, uint32_t destination, uint32_t source,
+	uint32_t length, uint32_t stride)
+{
+	DmaControlBlock* block = (DmaControlBlock*)slab_alloc(&dma_block_cache);
+	if (block == FORBIDDEN_ADDRESS)
+	{
+		return 0;
+	}
+
+	block->transfer_information = information;
+	block->source_address = DMA_BUS_ADDRESS(source);
+	block->destination_address = DMA_BUS_ADDRESS(destination);
+	block->transfer_length = length;
+	block->stride = stride;
+	block->next_control_block = 0;
+	if (transfer->last != NULL)
+	{
+		transfer->last->next_control_block = DMA_BUS_ADDRESS(block);
+	}
+	else
+	{
+		transfer->first = block;
+	}
+	transfer->last = block;
+	transfer->block_count++;
+	return 1;
+}
+
+int dma_add_copy(DmaTransfer* transfer, uint32_t destination, uint32_t source, uint32_t size)
+{
+	if (((destination | source | size) & 3) != 0)
+	{
+		return 0;
+	}
+
+	while (size > 0)
+	{
+		uint32_t length = size < DMA_LITE_MAX_LENGTH ? size : DMA_LITE_MAX_LENGTH;
+		uint32_t information = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP;
+		//Les copies alignees sur 16 octets se font par lectures et ecritures de 128 bits.
+		if (((destination | source | length) & 15) == 0)
+		{
+			information |= DMA_TI_SRC_WIDTH | DMA_TI_DEST_WIDTH | DMA_TI_BURST_LENGTH(2);
+		}
+		if (!dma_append(transfer, information, destination, source, length, 0))
+		{
+			return 0;
+		}
+		destination += length;
+		source += length;
+		size -= length;
+	}
+
+	return 1;
+}
+
+int dma_add_2d(DmaTransfer* transfer, uint32_t destination, uint32_t destination_pitch,
+	uint32_t source, uint32_t source_pitch, uint32_t width, uint32_t height)
+{
+	//Apres chaque ligne, le controleur a avance de width octets : les sauts ramenent au debut de la ligne suivante.
+	int32_t destination_stride = (int32_t)destination_pitch - (int32_t)width;
+	int32_t source_stride = (int32_t)source_pitch - (int32_t)width;
+
+	if (((destination | source | destination_pitch | source_pitch | width) & 3) != 0
+		|| width == 0 || width > DMA_2D_MAX_WIDTH || height == 0 || height > DMA_2D_MAX_HEIGHT
+		|| destination_stride < DMA_2D_STRIDE_MIN || destination_stride > DMA_2D_STRIDE_MAX
+		|| source_stride < DMA_2D_STRIDE_MIN || source_stride > DMA_2D_STRIDE_MAX)
+	{
+		return 0;
+	}
+
+	transfer->full_channel = 1;
+	return dma_append(transfer, DMA_TI_TDMODE | DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP,
+		destination, source, (height << 16) | width,
+		((uint32_t)destination_stride << 16) | ((uint32_t)source_stride & 0xFFFF));
+}
+
+int dma_start(DmaTransfer* transfer, DmaCallback callback, void* argument)
+{
+	if (transfer->first == NULL || !dma_usable())
+	{
+		return 0;
+	}
+	int channel = dma_channel_alloc(transfer->full_channel);
+	if (channel < 0)
+	{
+		dma_refused_count++;
+		return 0;
+	}
+
+	transfer->done = 0;
+	transfer->error = 0;
+	transfer->callback = callback;
+	transfer->argument = argument;
+	transfer->channel = channel;
+	dma_channel_transfers[channel] = transfer;
+	//Seul le dernier bloc leve une interruption, a la fin de toute la liste.
+	transfer->last->transfer_information |= DMA_TI_INTEN;
+
+	//Le controleur lit les blocs et les sources en memoire : les lignes modifiees du cache
+	//y sont ecrites. Les lignes des destinations sont invalidees, pour qu'elles ne soient
+	//pas reecrites par-dessus le transfert et que le processeur relise le resultat.
+	//Les pages utilisateur des frames copiees ne sont pas projetees dans le noyau :
+	//on ne peut pas nettoyer leurs lignes par adresse, tout le cache est vide.
+	clean_invalidate_data_cache();
+
+	Set32(DMA_REGISTER(channel, DMA_CONBLK_AD), DMA_BUS_ADDRESS(transfer->first));
+	Set32(DMA_REGISTER(channel, DMA_CS), DMA_CS_ACTIVE | DMA_CS_WAIT_FOR_OUTSTANDING_WRITES
+		| DMA_CS_PRIORITY(8) | DMA_CS_PANIC_PRIORITY(8));
+	dma_started_count++;
+	return 1;
+}
+
+void dma_complete(uint32_t channel)
+{
+	DmaTransfer* transfer = dma_channel_transfers[channel];
+	if (transfer == NULL)
+	{
+		return;
+	}
+	dma_channel_transfers[channel] = NULL;
+
+	if (Get32(DMA_REGISTER(channel, DMA_CS)) & DMA_CS_ERROR)
+	{
+		//Le canal est remis a zero, les blocs restants ne sont pas executes.
+		transfer->error = 1;
+		dma_error_count++;
+		Set32(DMA_REGISTER(channel, DMA_DEBUG), DMA_DEBUG_ERRORS);
+		Set32(DMA_REGISTER(channel, DMA_CS), DMA_CS_RESET);
+	}
+	Set32(DMA_REGISTER(channel, DMA_CS), DMA_CS_END | DMA_CS_INT);
+	dma_channel_free(channel);
+
+	transfer->done = 1;
+	transfer->channel = -1;
+	if (transfer->callback != NULL)
+	{
+		transfer->callback(transfer, transfer->argument);
+	}
+}
+
+int dma_wait(DmaTransfer* transfer)
+{
+	while (!transfer->done)
+	{
+		//Le canal n'est rendu qu'apres la fin : un transfert sans canal n'a jamais ete lance.
+		int channel = transfer->channel;
+		if (channel < 0)
+		{
+			break;
+		}
+		if ((Get32(DMA_REGISTER(channel, DMA_CS)) & DMA_CS_ACTIVE) == 0)
+		{
+			dma_complete(channel);
+		}
+	}
+	return transfer->done && !transfer->error;
+}
+
+void dma_transfer_destroy(DmaTransfer* transfer)
+{
+	DmaControlBlock* block = transfer->first;
+	for (uint32_t i = 0;i < transfer->block_count;i++)
+	{
+		DmaControlBlock* next = (DmaControlBlock*)DMA_PHYSICAL_ADDRESS(block->next_control_block);
+		slab_free(&dma_block_cache, block);
+		block = next;
+	}
+	slab_free(&dma_transfer_cache, transfer);
+}
+
+int dma_copy(uint32_t destination, uint32_t source, uint32_t size)
+{
+	DmaTransfer* transfer = dma_transfer_create();
+	if (transfer == FORBIDDEN_ADDRESS)
+	{
+		return 0;
+	}
+
+	int copied = dma_add_copy(transfer, destination, source, size)
+		&& dma_start(transfer, NULL, NULL)
+		&& dma_wait(transfer);
+	dma_transfer_destroy(transfer);
+	return copied;
+}
+
+void dma_irq_handler()
+{
+	uint32_t status = Get32(DMA_INT_STATUS) & DMA_CHANNEL_MASK;
+
+	dma_irq_count++;
+	while (status != 0)
+	{
+		uint32_t channel = __builtin_ctz(status);
+		status &= status - 1;
+		//Le transfert a pu etre termine par dma_wait : le flag est efface dans tous les cas,
+		//avant que la fonction de fin ne relance le canal.
+		Set32(DMA_REGISTER(channel, DMA_CS), DMA_CS_END | DMA_CS_INT);
+		dma_complete(channel);
+	}
+}
@@ -0,0 +1,216 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <inttypes.h>
+
+//Le controleur DMA du BCM2835 : 15 canaux, dont les registres se suivent tous les 0x100 octets.
+#define DMA_BASE 0x20007000
+#define DMA_CHANNEL_SIZE 0x100
+#define DMA_CHANNEL_COUNT 15
+//Un bit par canal : les interruptions en attente, et les canaux actives.
+#define DMA_INT_STATUS (DMA_BASE + 0xFE0)
+#define DMA_ENABLE (DMA_BASE + 0xFF0)
+
+//Les registres d'un canal.
+#define DMA_CS 0x00
+#define DMA_CONBLK_AD 0x04
+#define DMA_DEBUG 0x20
+
+//Les bits du registre CS. END et INT s'effacent en y ecrivant 1.
+#define DMA_CS_ACTIVE 0x1
+#define DMA_CS_END 0x2
+#define DMA_CS_INT 0x4
+#define DMA_CS_ERROR 0x100
+#define DMA_CS_PRIORITY(priority) ((priority) << 16)
+#define DMA_CS_PANIC_PRIORITY(priority) ((priority) << 20)
+#define DMA_CS_WAIT_FOR_OUTSTANDING_WRITES 0x10000000
+#define DMA_CS_RESET 0x80000000
+
+//Les bits du champ transfer_information d'un bloc de controle.
+#define DMA_TI_INTEN 0x1
+#define DMA_TI_TDMODE 0x2
+#define DMA_TI_WAIT_RESP 0x8
+#define DMA_TI_DEST_INC 0x10
+#define DMA_TI_DEST_WIDTH 0x20
+#define DMA_TI_SRC_INC 0x100
+#define DMA_TI_SRC_WIDTH 0x200
+#define DMA_TI_BURST_LENGTH(length) ((length) << 12)
+
+//Les bits du registre DEBUG : les erreurs de lecture, et le type du canal.
+#define DMA_DEBUG_ERRORS 0x7
+#define DMA_DEBUG_LITE 0x10000000
+
+//Les canaux laisses a l'ARM par le firmware, les autres servent au GPU.
+#define DMA_CHANNEL_MASK 0x7F35
+
+//Les canaux 0 a 10 ont chacun leur ligne d'interruption (16 a 26 dans la premiere banque),
+//les canaux 11 a 14 partagent la ligne 27.
+#define DMA_IRQ_LINE(channel) ((channel) < 11 ? 16 + (channel) : 27)
+#define DMA_IRQ_MASK 0x0FFF0000
+
+//Les canaux lite ne copient pas plus de 64ko par bloc et ne font pas de transferts 2D.
+//Les copies sont decoupees en blocs de cette taille, multiple de 16.
+#define DMA_LITE_MAX_LENGTH 0xFFF0
+//Les bornes d'un transfert 2D : la largeur et le nombre de lignes tiennent sur 16 et 14 bits,
+//les sauts entre deux lignes sont signes sur 16 bits.
+#define DMA_2D_MAX_WIDTH 0xFFFC
+#define DMA_2D_MAX_HEIGHT 0x3FFF
+#define DMA_2D_STRIDE_MIN -32768
+#define DMA_2D_STRIDE_MAX 32767
+
+//Le controleur voit la ram par l'alias de bus du cache L2, coherent avec le GPU.
+//Le noyau est projete a l'identique : ses adresses virtuelles sont physiques.
+#define DMA_BUS_ALIAS 0x40000000
+#define DMA_BUS_ADDRESS(address) ((uint32_t)(address) | DMA_BUS_ALIAS)
+#define DMA_PHYSICAL_ADDRESS(address) ((uint32_t)(address) & ~0xC0000000)
+//Les adresses de l'espace utilisateur (USER_SPACE_START) ne sont pas physiques.
+#define DMA_USER_SPACE_START 0x80000000
+
+//En dessous de cette taille, un transfert coute plus cher a preparer qu'a faire
+//avec le processeur : le cache de donnees est vide a chaque lancement.
+#define DMA_MIN_TRANSFER 4096
+
+//-----------------------------------------------------------------Types
+/**
+ * Un bloc de controle, lu par le controleur en memoire.
+ * Les blocs d'un transfert sont chaines par leur adresse de bus.
+ */
+struct DmaControlBlock
+{
+	uint32_t transfer_information;
+	uint32_t source_address;
+	uint32_t destination_address;
+	//En mode 2D : le nombre de lignes dans les 16 bits de poids fort, la largeur dans les autres.
+	uint32_t transfer_length;
+	//En mode 2D : les sauts ajoutes apres chaque ligne, destination en poids fort.
+	uint32_t stride;
+	uint32_t next_control_block;
+	uint32_t reserved[2];
+};
+typedef struct DmaControlBlock DmaControlBlock;
+
+//Les blocs doivent etre alignes sur 32 octets.
+#define DMA_CONTROL_BLOCK_ALIGNMENT 32
+
+struct DmaTransfer;
+
+/**
+ * Appelee a la fin d'un transfert, par l'interruption du canal ou par dma_wait.
+ */
+typedef void (*DmaCallback)(struct DmaTransfer* transfer, void* argument);
+
+/**
+ * Une liste de copies, faites l'une apres l'autre par un seul canal.
+ */
+struct DmaTransfer
+{
+	DmaControlBlock* first;
+	DmaControlBlock* last;
+	uint32_t block_count;
+	//1 si un bloc demande un canal complet (transfert 2D).
+	uint32_t full_channel;
+	//Le canal du transfert en cours, -1 avant le lancement et apres la fin.
+	volatile int channel;
+	volatile uint32_t done;
+	uint32_t error;
+	DmaCallback callback;
+	void* argument;
+};
+typedef struct DmaTransfer DmaTransfer;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Active et remet a zero les canaux de l'ARM, et leurs lignes d'interruption.
+ * Avant l'appel, aucun canal ne peut etre alloue : les transferts sont refuses
+ * et les appelants copient avec le processeur.
+ */
+void dma_init();
+
+/**
+ * Indique si le processeur peut lancer un transfert : la maintenance du cache
+ * faite au lancement est interdite en mode user, les processus copient eux-memes.
+ * @return 1 si dma_init a ete appele et que le processeur n'est pas en mode user.
+ */
+int dma_usable();
+
+/**
+ * Alloue un canal libre.
+ * Les canaux lite sont donnes en premier, les canaux complets restent aux transferts 2D.
+ * @param full 1 si le canal doit etre complet.
+ * @return Le numero du canal, -1 si aucun canal n'est libre.
+ */
+int dma_channel_alloc(int full);
+
+/**
+ * Libere un canal alloue par dma_channel_alloc.
+ */
+void dma_channel_free(int channel);
+
+/**
+ * Alloue un transfert vide.
+ * @return Le transfert, ou FORBIDDEN_ADDRESS si le tas noyau est plein.
+ */
+DmaTransfer* dma_transfer_create();
+
+/**
+ * Ajoute une copie a la fin d'un transfert. Les adresses sont physiques.
+ * Une grande copie est decoupee en plusieurs blocs.
+ * @return 1 si la copie est ajoutee, 0 si les adresses ou la taille ne sont pas
+ * alignees sur 4 octets ou si le tas noyau est plein. Le transfert ne doit alors
+ * pas etre lance.
+ */
+int dma_add_copy(DmaTransfer* transfer, uint32_t destination, uint32_t source, uint32_t size);
+
+/**
+ * Ajoute une copie de rectangle a la fin d'un transfert. Les adresses sont physiques.
+ * Une source de pas 0 relit la meme ligne pour chaque ligne de la destination :
+ * c'est ainsi qu'on remplit une zone a partir d'une ligne deja remplie.
+ * @param destination L'adresse de la premiere ligne de la destination.
+ * @param destination_pitch L'ecart en octets entre deux lignes de la destination.
+ * @param source L'adresse de la premiere ligne de la source.
+ * @param source_pitch L'ecart en octets entre deux lignes de la source.
+ * @param width La largeur des lignes, en octets.
+ * @param height Le nombre de lignes.
+ * @return 1 si la copie est ajoutee, 0 si elle sort des bornes du controleur, n'est
+ * pas alignee sur 4 octets, ou si le tas noyau est plein.
+ */
+int dma_add_2d(DmaTransfer* transfer, uint32_t destination, uint32_t destination_pitch,
+	uint32_t source, uint32_t source_pitch, uint32_t width, uint32_t height);
+
+/**
+ * Lance un transfert sur un canal libre, sans attendre sa fin.
+ * Le cache de donnees est ecrit en memoire puis invalide : le processeur ne doit
+ * pas toucher aux destinations avant la fin du transfert.
+ * @param callback Appelee a la fin du transfert, peut etre NULL.
+ * @param argument Passe a callback.
+ * @return 1 si le transfert est lance, 0 s'il est vide, si aucun canal n'est libre
+ * ou si dma_usable est faux.
+ */
+int dma_start(DmaTransfer* transfer, DmaCallback callback, void* argument);
+
+/**
+ * Attend la fin d'un transfert lance, en lisant l'etat du canal :
+ * l'attente fonctionne aussi quand les interruptions sont masquees.
+ * @return 1 si le transfert s'est termine sans erreur, 0 sinon.
+ */
+int dma_wait(DmaTransfer* transfer);
+
+/**
+ * Libere un transfert termine, ou jamais lance, et ses blocs.
+ */
+void dma_transfer_destroy(DmaTransfer* transfer);
+
+/**
+ * Copie une zone de la memoire physique par le controleur, et attend la fin de la copie.
+ * @return 1 si la zone est copiee, 0 si le controleur n'a pas pu la copier :
+ * l'appelant doit alors la copier avec le processeur.
+ */
+int dma_copy(uint32_t destination, uint32_t source, uint32_t size);
+
+/**
+ * Termine les transferts des canaux qui ont leve une interruption,
+ * appele par irq_handler_C.
+ */
+void dma_irq_handler();
+
+#endif
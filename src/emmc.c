@@ -0,0 +1,280 @@
+#include "emmc.h"
+#include "asm_tools.h"
+
+//Les commandes utilisees, avec le type de leur reponse.
+#define EMMC_GO_IDLE_STATE EMMC_CMD_INDEX(0)
+#define EMMC_ALL_SEND_CID (EMMC_CMD_INDEX(2) | EMMC_CMD_RESPONSE_136 | EMMC_CMD_CRC_CHECK)
+#define EMMC_SEND_RELATIVE_ADDR (EMMC_CMD_INDEX(3) | EMMC_CMD_RESPONSE_48 | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK)
+#define EMMC_SELECT_CARD (EMMC_CMD_INDEX(7) | EMMC_CMD_RESPONSE_48_BUSY | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK)
+#define EMMC_SEND_IF_COND (EMMC_CMD_INDEX(8) | EMMC_CMD_RESPONSE_48 | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK)
+#define EMMC_SET_BLOCKLEN (EMMC_CMD_INDEX(16) | EMMC_CMD_RESPONSE_48 | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK)
+//Les transferts de plusieurs blocs sont termines par un CMD12 envoye par le controleur.
+#define EMMC_READ_MULTIPLE_BLOCK (EMMC_CMD_INDEX(18) | EMMC_CMD_RESPONSE_48 | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK \
+	| EMMC_CMD_DATA | EMMC_TM_READ | EMMC_TM_MULTI_BLOCK | EMMC_TM_BLOCK_COUNT | EMMC_TM_AUTO_CMD12)
+#define EMMC_WRITE_MULTIPLE_BLOCK (EMMC_CMD_INDEX(25) | EMMC_CMD_RESPONSE_48 | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK \
+	| EMMC_CMD_DATA | EMMC_TM_MULTI_BLOCK | EMMC_TM_BLOCK_COUNT | EMMC_TM_AUTO_CMD12)
+//ACMD41, precede de APP_CMD. Sa reponse (R3) n'a ni CRC ni index.
+#define EMMC_SD_SEND_OP_COND (EMMC_CMD_INDEX(41) | EMMC_CMD_RESPONSE_48)
+#define EMMC_APP_CMD (EMMC_CMD_INDEX(55) | EMMC_CMD_RESPONSE_48 | EMMC_CMD_CRC_CHECK | EMMC_CMD_INDEX_CHECK)
+
+//L'argument de SEND_IF_COND : la tension 2.7-3.6V et un motif, renvoyes par une carte SD 2.0.
+#define EMMC_IF_COND_ARGUMENT 0x1AA
+//Le registre OCR de la carte : les tensions acceptees, le support des cartes haute capacite,
+//et la fin du demarrage.
+#define EMMC_OCR_VOLTAGES 0x00FF8000
+#define EMMC_OCR_HIGH_CAPACITY 0x40000000
+#define EMMC_OCR_READY 0x80000000
+
+//En mode divise de SDHCI 3.0, l'horloge de la carte est l'horloge de base divisee par 2 * divider.
+#define EMMC_CLOCK_DIVIDER(frequency) ((EMMC_BASE_CLOCK + 2 * (frequency) - 1) / (2 * (frequency)))
+//La duree maximale d'un transfert, 2^27 periodes de l'horloge de la carte.
+#define EMMC_DATA_TIMEOUT_UNIT 0xE
+
+//----------------------------------------------------Variables globales
+
+//1 si une carte a ete identifiee par emmc_init.
+int emmc_ready = 0;
+//Une carte haute capacite est adressee en blocs, les autres en octets.
+int emmc_high_capacity;
+//L'adresse de la carte, donnee par SEND_RELATIVE_ADDR.
+uint32_t emmc_rca;
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Attend que les bits d'un registre soient tous nuls.
+ * @return 1 s'ils le sont devenus, 0 apres EMMC_TIMEOUT lectures.
+ */
+int emmc_wait_clear(uint32_t address, uint32_t mask);
+
+/**
+ * Attend qu'un flag du registre INTERRUPT soit mis, puis l'efface.
+ * En cas d'erreur ou d'attente trop longue, les lignes de commande et de donnees
+ * sont remises a zero.
+ * @return 1 si le flag a ete mis, 0 sinon.
+ */
+int emmc_wait_interrupt(uint32_t flag);
+
+/**
+ * Remet a zero les lignes de commande et de donnees apres une erreur, et efface les flags.
+ */
+void emmc_reset_lines();
+
+/**
+ * Change la frequence de l'horloge de la carte.
+ * @return 1 si l'horloge est stable, 0 sinon.
+ */
+int emmc_set_clock(uint32_t divider);
+
+/**
+ * Envoie une commande et attend sa reponse, lue ensuite dans EMMC_RESP0.
+ * @return 1 si la carte a repondu sans erreur, 0 sinon.
+ */
+int emmc_command(uint32_t command, uint32_t argument);
+
+/**
+ * Envoie une commande specifique aux cartes SD, precedee de APP_CMD.
+ */
+int emmc_app_command(uint32_t command, uint32_t argument);
+
+/**
+ * Lit ou ecrit des blocs par le registre DATA, mot par mot.
+ * @param command EMMC_READ_MULTIPLE_BLOCK ou EMMC_WRITE_MULTIPLE_BLOCK.
+ * @param words Les mots lus ou ecrits.
+ */
+int emmc_transfer(uint32_t command, uint32_t block, uint32_t block_nb, uint32_t* words);
+
+//----------------------------------------------------------Realisations
+int emmc_wait_clear(uint32_t address, uint32_t mask)
+{
+	for (uint32_t i = 0;i < EMMC_TIMEOUT;i++)
+	{
+		if (((uint32_t)Get32(address) & mask) == 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int emmc_wait_interrupt(uint32_t flag)
+{
+	for (uint32_t i = 0;i < EMMC_TIMEOUT;i++)
+	{
+		uint32_t interrupt = Get32(EMMC_INTERRUPT);
+		if (interrupt & EMMC_INTERRUPT_ERRORS)
+		{
+			break;
+		}
+		if (interrupt & flag)
+		{
+			Set32(EMMC_INTERRUPT, flag);
+			return 1;
+		}
+	}
+	emmc_reset_lines();
+	return 0;
+}
+
+void emmc_reset_lines()
+{
+	Set32(EMMC_CONTROL1, Get32(EMMC_CONTROL1) | EMMC_CONTROL1_SRST_CMD | EMMC_CONTROL1_SRST_DATA);
+	emmc_wait_clear(EMMC_CONTROL1, EMMC_CONTROL1_SRST_CMD | EMMC_CONTROL1_SRST_DATA);
+	Set32(EMMC_INTERRUPT, 0xFFFFFFFF);
+}
+
+int emmc_set_clock(uint32_t divider)
+{
+	uint32_t control = EMMC_CONTROL1_DATA_TIMEOUT(EMMC_DATA_TIMEOUT_UNIT) | EMMC_CONTROL1_CLK_DIVIDER(divider)
+		| EMMC_CONTROL1_CLK_INTLEN;
+
+	//L'horloge de la carte est coupee pendant le changement de frequence.
+	Set32(EMMC_CONTROL1, control);
+	for (uint32_t i = 0;i < EMMC_TIMEOUT;i++)
+	{
+		if (Get32(EMMC_CONTROL1) & EMMC_CONTROL1_CLK_STABLE)
+		{
+			Set32(EMMC_CONTROL1, control | EMMC_CONTROL1_CLK_EN);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int emmc_command(uint32_t command, uint32_t argument)
+{
+	//Une commande avec des donnees ou une attente de fin d'occupation utilise aussi la ligne de donnees.
+	int busy = (command & EMMC_CMD_RESPONSE_48_BUSY) == EMMC_CMD_RESPONSE_48_BUSY;
+	uint32_t inhibit = EMMC_STATUS_CMD_INHIBIT;
+	if (busy || (command & EMMC_CMD_DATA))
+	{
+		inhibit |= EMMC_STATUS_DAT_INHIBIT;
+	}
+	if (!emmc_wait_clear(EMMC_STATUS, inhibit))
+	{
+		emmc_reset_lines();
+		return 0;
+	}
+
+	Set32(EMMC_INTERRUPT, 0xFFFFFFFF);
+	Set32(EMMC_ARG1, argument);
+	Set32(EMMC_CMDTM, command);
+	if (!emmc_wait_interrupt(EMMC_INTERRUPT_CMD_DONE))
+	{
+		return 0;
+	}
+	//La fin de l'occupation de la carte est signalee comme la fin d'un transfert.
+	return !busy || emmc_wait_interrupt(EMMC_INTERRUPT_DATA_DONE);
+}
+
+int emmc_app_command(uint32_t command, uint32_t argument)
+{
+	return emmc_command(EMMC_APP_CMD, emmc_rca << 16) && emmc_command(command, argument);
+}
+
+int emmc_transfer(uint32_t command, uint32_t block, uint32_t block_nb, uint32_t* words)
+{
+	if (!emmc_ready || block_nb == 0)
+	{
+		return 0;
+	}
+
+	Set32(EMMC_BLKSIZECNT, (block_nb << 16) | EMMC_BLOCK_SIZE);
+	if (!emmc_command(command, emmc_high_capacity ? block : block * EMMC_BLOCK_SIZE))
+	{
+		return 0;
+	}
+	int read = (command & EMMC_TM_READ) != 0;
+	for (uint32_t i = 0;i < block_nb;i++)
+	{
+		//Le flag est efface avant de transferer le bloc : le controleur le remet pour le bloc suivant.
+		if (!emmc_wait_interrupt(read ? EMMC_INTERRUPT_READ_READY : EMMC_INTERRUPT_WRITE_READY))
+		{
+			return 0;
+		}
+		for (uint32_t word = 0;word < EMMC_BLOCK_SIZE / sizeof(uint32_t);word++)
+		{
+			if (read)
+			{
+				*words = Get32(EMMC_DATA);
+			}
+			else
+			{
+				Set32(EMMC_DATA, *words);
+			}
+			words++;
+		}
+	}
+	return emmc_wait_interrupt(EMMC_INTERRUPT_DATA_DONE);
+}
+
+int emmc_init()
+{
+	emmc_ready = 0;
+	emmc_rca = 0;
+
+	Set32(EMMC_CONTROL1, EMMC_CONTROL1_SRST_HC);
+	if (!emmc_wait_clear(EMMC_CONTROL1, EMMC_CONTROL1_SRST_HC))
+	{
+		return 0;
+	}
+	Set32(EMMC_CONTROL2, 0);
+	if (!emmc_set_clock(EMMC_CLOCK_DIVIDER(EMMC_IDENTIFICATION_CLOCK)))
+	{
+		return 0;
+	}
+	//Tous les flags apparaissent dans INTERRUPT, aucun ne leve d'interruption : le controleur est interroge.
+	Set32(EMMC_IRPT_EN, 0);
+	Set32(EMMC_IRPT_MASK, 0xFFFFFFFF);
+	Set32(EMMC_INTERRUPT, 0xFFFFFFFF);
+
+	if (!emmc_command(EMMC_GO_IDLE_STATE, 0))
+	{
+		return 0;
+	}
+	//Une carte SD 2.0 renvoie l'argument de SEND_IF_COND, une carte 1.x ne repond pas.
+	int version_2 = emmc_command(EMMC_SEND_IF_COND, EMMC_IF_COND_ARGUMENT)
+		&& ((uint32_t)Get32(EMMC_RESP0) & 0xFFF) == EMMC_IF_COND_ARGUMENT;
+
+	//La carte demarre : ACMD41 est repete jusqu'a ce qu'elle soit prete.
+	uint32_t ocr = 0;
+	for (uint32_t i = 0;i < EMMC_OP_COND_TRIES && (ocr & EMMC_OCR_READY) == 0;i++)
+	{
+		if (!emmc_app_command(EMMC_SD_SEND_OP_COND, EMMC_OCR_VOLTAGES | (version_2 ? EMMC_OCR_HIGH_CAPACITY : 0)))
+		{
+			return 0;
+		}
+		ocr = Get32(EMMC_RESP0);
+		delay(1000);
+	}
+	if ((ocr & EMMC_OCR_READY) == 0)
+	{
+		return 0;
+	}
+	emmc_high_capacity = (ocr & EMMC_OCR_HIGH_CAPACITY) != 0;
+
+	//La carte recoit une adresse, puis elle est selectionnee pour les transferts.
+	if (!emmc_command(EMMC_ALL_SEND_CID, 0) || !emmc_command(EMMC_SEND_RELATIVE_ADDR, 0))
+	{
+		return 0;
+	}
+	emmc_rca = (uint32_t)Get32(EMMC_RESP0) >> 16;
+	if (!emmc_command(EMMC_SELECT_CARD, emmc_rca << 16) || !emmc_command(EMMC_SET_BLOCKLEN, EMMC_BLOCK_SIZE)
+		|| !emmc_set_clock(EMMC_CLOCK_DIVIDER(EMMC_TRANSFER_CLOCK)))
+	{
+		return 0;
+	}
+
+	emmc_ready = 1;
+	return 1;
+}
+
+int emmc_read(uint32_t block, uint32_t block_nb, void* buffer)
+{
+	return emmc_transfer(EMMC_READ_MULTIPLE_BLOCK, block, block_nb, (uint32_t*)buffer);
+}
+
+int emmc_write(uint32_t block, uint32_t block_nb, const void* buffer)
+{
+	//Les mots sont seulement lus.
+	return emmc_transfer(EMMC_WRITE_MULTIPLE_BLOCK, block, block_nb, (uint32_t*)buffer);
+}
@@ -0,0 +1,100 @@
+#ifndef EMMC_H
+#define EMMC_H
+
+#include <inttypes.h>
+
+//Le controleur de la carte SD du BCM2835, compatible SDHCI 3.0.
+//QEMU y branche la carte donnee par -sd.
+#define EMMC_BASE 0x20300000
+
+//Les registres du controleur.
+#define EMMC_BLKSIZECNT (EMMC_BASE + 0x04)
+#define EMMC_ARG1 (EMMC_BASE + 0x08)
+#define EMMC_CMDTM (EMMC_BASE + 0x0C)
+#define EMMC_RESP0 (EMMC_BASE + 0x10)
+#define EMMC_DATA (EMMC_BASE + 0x20)
+#define EMMC_STATUS (EMMC_BASE + 0x24)
+#define EMMC_CONTROL1 (EMMC_BASE + 0x2C)
+#define EMMC_INTERRUPT (EMMC_BASE + 0x30)
+#define EMMC_IRPT_MASK (EMMC_BASE + 0x34)
+#define EMMC_IRPT_EN (EMMC_BASE + 0x38)
+#define EMMC_CONTROL2 (EMMC_BASE + 0x3C)
+
+//Le champ CMDTM : l'index de la commande, le type de sa reponse et le sens des donnees.
+#define EMMC_CMD_INDEX(index) ((index) << 24)
+#define EMMC_CMD_RESPONSE_136 (1 << 16)
+#define EMMC_CMD_RESPONSE_48 (2 << 16)
+#define EMMC_CMD_RESPONSE_48_BUSY (3 << 16)
+#define EMMC_CMD_CRC_CHECK (1 << 19)
+#define EMMC_CMD_INDEX_CHECK (1 << 20)
+#define EMMC_CMD_DATA (1 << 21)
+#define EMMC_TM_BLOCK_COUNT (1 << 1)
+#define EMMC_TM_AUTO_CMD12 (1 << 2)
+#define EMMC_TM_READ (1 << 4)
+#define EMMC_TM_MULTI_BLOCK (1 << 5)
+
+//Les bits du registre STATUS : une commande ou un transfert de donnees est en cours.
+#define EMMC_STATUS_CMD_INHIBIT 0x1
+#define EMMC_STATUS_DAT_INHIBIT 0x2
+
+//Les bits du registre CONTROL1 : l'horloge de la carte, et les remises a zero.
+#define EMMC_CONTROL1_CLK_INTLEN 0x1
+#define EMMC_CONTROL1_CLK_STABLE 0x2
+#define EMMC_CONTROL1_CLK_EN 0x4
+#define EMMC_CONTROL1_CLK_DIVIDER(divider) ((((divider) & 0xFF) << 8) | ((((divider) >> 8) & 0x3) << 6))
+#define EMMC_CONTROL1_DATA_TIMEOUT(unit) ((unit) << 16)
+#define EMMC_CONTROL1_SRST_HC (1 << 24)
+#define EMMC_CONTROL1_SRST_CMD (1 << 25)
+#define EMMC_CONTROL1_SRST_DATA (1 << 26)
+
+//Les flags du registre INTERRUPT, effaces en y ecrivant 1.
+#define EMMC_INTERRUPT_CMD_DONE 0x1
+#define EMMC_INTERRUPT_DATA_DONE 0x2
+#define EMMC_INTERRUPT_WRITE_READY 0x10
+#define EMMC_INTERRUPT_READ_READY 0x20
+#define EMMC_INTERRUPT_ERROR 0x8000
+//Les flags des erreurs, dans les 16 bits de poids fort.
+#define EMMC_INTERRUPT_ERRORS 0xFFFF8000
+
+//L'horloge de base du controleur, donnee au noyau Linux par emmc_clock_freq.
+//La carte est identifiee a 400kHz au plus, puis lue et ecrite a 25MHz.
+#define EMMC_BASE_CLOCK 100000000
+#define EMMC_IDENTIFICATION_CLOCK 400000
+#define EMMC_TRANSFER_CLOCK 25000000
+
+//Le nombre de lectures d'un registre avant d'abandonner une attente,
+//et le nombre d'essais de ACMD41 le temps que la carte demarre.
+#define EMMC_TIMEOUT 1000000
+#define EMMC_OP_COND_TRIES 1000
+
+//La taille d'un bloc de la carte.
+#define EMMC_BLOCK_SIZE 512
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Remet a zero le controleur et identifie la carte, lue ensuite par blocs de 512 octets.
+ * Le controleur est interroge sans interruption.
+ * @return 1 si une carte a repondu, 0 s'il n'y a pas de carte ou qu'elle n'est pas reconnue :
+ * emmc_read et emmc_write echouent alors.
+ */
+int emmc_init();
+
+/**
+ * Lit des blocs consecutifs de la carte.
+ * @param block Le premier bloc.
+ * @param block_nb Le nombre de blocs.
+ * @param buffer La destination, alignee sur 4 octets.
+ * @return 1 si les blocs sont lus, 0 en cas d'erreur.
+ */
+int emmc_read(uint32_t block, uint32_t block_nb, void* buffer);
+
+/**
+ * Ecrit des blocs consecutifs de la carte.
+ * @param block Le premier bloc.
+ * @param block_nb Le nombre de blocs.
+ * @param buffer La source, alignee sur 4 octets.
+ * @return 1 si les blocs sont ecrits, 0 en cas d'erreur.
+ */
+int emmc_write(uint32_t block, uint32_t block_nb, const void* buffer);
+
+#endif
@@ -1,13 +1,22 @@
 #include <stdint.h>
 #include "fb.h"
+#include "memory.h"
+#include "kheap.h"
+#include "dma.h"
 
 /*
  * Adresse du framebuffer, taille en byte, résolution de l'écran, pitch et depth (couleurs)
+ * La résolution est la largeur et la hauteur : les pixels vont de 0 à fb_x - 1 et fb_y - 1
  */
 static uint32_t fb_address;
 static uint32_t fb_size_bytes;
 static uint32_t fb_x, fb_y, pitch, depth;
 
+/*
+ * Dernier transfert DMA lancé sur l'écran, 0 quand il n'y en a pas en cours
+ */
+static DmaTransfer* fb_transfer = 0;
+
 /*
  * Fonction pour lire et écrire dans les mailboxs
  */
@@ -181,9 +190,6 @@ int FramebufferInitialize() {
 
     pitch = mb[5];
 
-    fb_x--;
-    fb_y--;
-
     return 1;
 }
 
@@ -192,20 +198,21 @@ int FramebufferInitialize() {
  */
 void put_pixel_RGB24(uint32_t x, uint32_t y, uint8_t red, uint8_t green, uint8_t blue) {
 
-    if (x >= 0 && x <= fb_x  && y >= 0 && y <= fb_y) {
-        volatile uint32_t *ptr = 0;
+    waitFB();
+    if (x < fb_x && y < fb_y) {
+        volatile uint8_t *ptr = 0;
         uint32_t offset = 0;
 
         offset = (y * pitch) + (x * 3);
-        ptr = (uint32_t*) (fb_address + offset);
+        ptr = (uint8_t*) (fb_address + offset);
 #ifdef QEMU
-        *((uint8_t*) ptr) = blue;
-        *((uint8_t*) (ptr + 2)) = red;
+        ptr[0] = blue;
+        ptr[2] = red;
 #else
-        *((uint8_t*) ptr) = red;
-        *((uint8_t*) (ptr + 2)) = blue;      
+        ptr[0] = red;
+        ptr[2] = blue;
 #endif
-        *((uint8_t*) (ptr + 1)) = green;
+        ptr[1] = green;
 
     }
 }
@@ -241,32 +248,108 @@ void draw() {
  * Rempli l'écran de rouge
  */
 void drawRed() {
-    uint32_t x = 0, y = 0;
-    for (x = 0; x < fb_x; x++) {
-        for (y = 0; y < fb_y; y++) {
-            put_pixel_RGB24(x, y, 255, 0, 0);
-        }
-    }
+    drawRect(0, 0, fb_x, fb_y, 255, 0, 0);
 }
 
 /*
  * Rempli l'écran de blanc
  */
 void drawBlue() {
-    uint32_t x = 0, y = 0;
-    for (x = 0; x < fb_x; x++) {
-        for (y = 0; y < fb_y; y++) {
-            put_pixel_RGB24(x, y, 0, 0, 255);
-        }
+    drawRect(0, 0, fb_x, fb_y, 0, 0, 255);
+}
+
+/*
+ * Coupe un rectangle aux bords de l'écran, comme put_pixel_RGB24
+ * Retourne 0 si le rectangle est entièrement hors de l'écran
+ */
+static int clipRect(uint32_t left, uint32_t top, uint32_t *width, uint32_t *height) {
+    if (left >= fb_x || top >= fb_y || *width == 0 || *height == 0) {
+        return 0;
+    }
+    if (*width > fb_x - left) {
+        *width = fb_x - left;
     }
+    if (*height > fb_y - top) {
+        *height = fb_y - top;
+    }
+    return 1;
+}
+
+/*
+ * Lance un transfert DMA d'une seule copie 2D sur l'écran, sans attendre sa fin
+ * Retourne 0 si le contrôleur ne peut pas la faire : la copie est alors à faire par le processeur
+ */
+static int startTransferFB(uint8_t *destination, const uint8_t *source, uint32_t source_pitch, uint32_t row_size, uint32_t row_nb) {
+    if (row_size * row_nb < DMA_MIN_TRANSFER || (uint32_t) source >= DMA_USER_SPACE_START || !dma_usable()) {
+        return 0;
+    }
+    DmaTransfer *transfer = dma_transfer_create();
+    if (transfer == FORBIDDEN_ADDRESS) {
+        return 0;
+    }
+    if (dma_add_2d(transfer, (uint32_t) destination, pitch, (uint32_t) source, source_pitch, row_size, row_nb)
+        && dma_start(transfer, 0, 0)) {
+        fb_transfer = transfer;
+        return 1;
+    }
+    dma_transfer_destroy(transfer);
+    return 0;
 }
 
 void drawRect(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint8_t red, uint8_t green, uint8_t blue) {
-	uint32_t x, y;
-	for (x = left; x < left + width; x++) {
-        for (y = top; y < top + height; y++) {
-            put_pixel_RGB24(x, y, red, green, blue);
-        }
+    uint32_t x, y;
+    if (!clipRect(left, top, &width, &height)) {
+        return;
+    }
+    // La première ligne est dessinée pixel par pixel, les suivantes en sont des copies
+    for (x = left; x < left + width; x++) {
+        put_pixel_RGB24(x, top, red, green, blue);
+    }
+    uint8_t *first_row = (uint8_t*) (fb_address + top * pitch + left * 3);
+    uint32_t row_size = width * 3;
+    // Le contrôleur DMA copie la partie de la ligne alignée sur des mots, en relisant
+    // la première ligne pour chaque ligne : le processeur n'écrit que les octets des bords
+    uint32_t head = (4 - ((uint32_t) first_row & 3)) & 3;
+    if (head > row_size) {
+        head = row_size;
+    }
+    uint32_t words = (row_size - head) & ~3;
+    uint32_t tail = row_size - head - words;
+    for (y = 1; y < height; y++) {
+        memcpy(first_row + y * pitch, first_row, head);
+        memcpy(first_row + y * pitch + head + words, first_row + head + words, tail);
+    }
+    if (height > 1 && startTransferFB(first_row + pitch + head, first_row + head, 0, words, height - 1)) {
+        return;
+    }
+    for (y = 1; y < height; y++) {
+        memcpy(first_row + y * pitch + head, first_row + head, words);
+    }
+}
+
+void blitRect(uint32_t left, uint32_t top, uint32_t width, uint32_t height, const uint8_t *pixels, uint32_t source_pitch) {
+    uint32_t y;
+    waitFB();
+    if (!clipRect(left, top, &width, &height)) {
+        return;
+    }
+    uint8_t *destination = (uint8_t*) (fb_address + top * pitch + left * 3);
+    // Les pixels appartiennent à l'appelant, qui peut les modifier ou les libérer au retour :
+    // le transfert est attendu, contrairement à celui de drawRect qui relit l'écran
+    if (startTransferFB(destination, pixels, source_pitch, width * 3, height)) {
+        waitFB();
+        return;
+    }
+    for (y = 0; y < height; y++) {
+        memcpy(destination + y * pitch, pixels + y * source_pitch, width * 3);
+    }
+}
+
+void waitFB() {
+    if (fb_transfer != 0) {
+        dma_wait(fb_transfer);
+        dma_transfer_destroy(fb_transfer);
+        fb_transfer = 0;
     }
 }
 
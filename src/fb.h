@@ -58,8 +58,24 @@ void drawRed();
 
 void drawBlue();
 
+/*
+ * Les rectangles assez grands sont remplis ou copiés par le contrôleur DMA, sans attendre
+ * la fin du transfert : le dessin suivant, ou waitFB, l'attend
+ */
 void drawRect(uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint8_t red, uint8_t green, uint8_t blue);
 
+/*
+ * Copie une image au format de l'écran (3 octets par pixel), dont les lignes sont
+ * espacées de source_pitch octets
+ * La copie est finie au retour, même faite par le contrôleur DMA : les pixels peuvent être réutilisés
+ */
+void blitRect(uint32_t left, uint32_t top, uint32_t width, uint32_t height, const uint8_t *pixels, uint32_t source_pitch);
+
+/*
+ * Attend la fin du dernier transfert DMA lancé sur l'écran
+ */
+void waitFB();
+
 uint32_t getWidthFB();
 
 uint32_t getHeightFB();
@@ -1,188 +1,509 @@
 #include "heap.h"
-#include "kheap.h"
 #include "vmem.h"
+#include "page_table.h"
+#include "kheap.h"
 #include "config.h"
 
-//-----------------------------------------------------Variables privees
+/*
+ * Les blocs du tas sont dans les pages du processus, a la suite de l'en-tete.
+ * Chaque bloc commence par une etiquette (taille | HEAP_USED) et finit par la
+ * meme etiquette. Les blocs commencent 4 octets apres une frontiere de 8 octets
+ * pour que les zones rendues soient alignees sur 8 octets.
+ * Un bloc libre garde dans sa zone les adresses du bloc suivant et du bloc
+ * precedent de sa liste.
+ * Les blocs couvrent tout le tas, du premier bloc a heap->end. Les 4 derniers
+ * octets de la derniere page ne servent pas, pour garder l'alignement.
+ *
+ * Un bloc libre de plus de HEAP_TRIM_THRESHOLD + HEAP_TOP_PAD octets rend ses frames
+ * (voir heap_trim) : seules restent projetees ses HEAP_TOP_PAD premiers octets et
+ * la page de son etiquette de fin.
+ *
+ * Le noyau lit et ecrit ces pages pour le processus : chaque acces passe par
+ * vmem_touch, qui refuse les adresses hors de l'espace utilisateur. Un tas
+ * abime par le processus ne peut donc pas faire ecrire le noyau ailleurs.
+ * Chaque acces peut prendre une frame et faire tourner l'horloge du swap :
+ * la frame de l'en-tete, lu directement, est epinglee pendant toute l'operation.
+ */
+
+//Le bit de l'etiquette qui marque un bloc occupe.
+#define HEAP_USED 0x1
+//La taille d'une etiquette.
+#define HEAP_TAG_SIZE 4
+//Un bloc libre contient ses deux etiquettes et ses deux liens.
+#define HEAP_MIN_BLOCK 16
+//La position du premier bloc par rapport au debut du tas.
+#define HEAP_FIRST_BLOCK (((sizeof(Heap) + 7) & ~7) + HEAP_TAG_SIZE)
 
 //-----------------------------------------------------Fonctions privees
+/**
+ * Indique si la premiere page du tas a deja une frame, ou a ete evincee dans le swap.
+ * Tant que ce n'est pas le cas, le tas est vide et il n'y a rien a lire.
+ */
+int heap_mapped(Heap* heap, uint32_t* page_table);
+
+/**
+ * Prepare l'en-tete du tas a etre modifie par le noyau, et epingle sa frame :
+ * l'horloge du swap ne la vieillit ni ne l'evince pendant l'operation.
+ * @return La frame de l'en-tete, UINT32_MAX si l'en-tete n'est pas accessible.
+ */
+uint32_t heap_pin(Heap* heap, uint32_t* page_table);
+
+/**
+ * Rend a l'horloge du swap la frame de l'en-tete, a la fin de l'operation.
+ */
+void heap_unpin(uint32_t frame);
+
+/**
+ * Lit un mot du tas, 0 si l'adresse n'est pas accessible au processus.
+ */
+uint32_t heap_read(uint32_t* page_table, uint8_t* address);
+
+/**
+ * Ecrit un mot du tas, rien si l'adresse n'est pas accessible au processus.
+ */
+void heap_write(uint32_t* page_table, uint8_t* address, uint32_t value);
+
+/**
+ * Verifie qu'une adresse lue dans le tas est bien celle d'un bloc.
+ */
+int heap_is_block(Heap* heap, uint8_t* block);
+
+/**
+ * Retourne la liste des blocs libres d'une taille donnee.
+ */
+uint32_t heap_class(uint32_t block_size);
+
+/**
+ * Ecrit les deux etiquettes d'un bloc.
+ */
+void heap_set_tags(uint32_t* page_table, uint8_t* block, uint32_t block_size, uint32_t used);
+
+/**
+ * Ajoute un bloc libre en tete de sa liste.
+ */
+void heap_push(Heap* heap, uint32_t* page_table, uint8_t* block, uint32_t block_size);
+
+/**
+ * Retire un bloc libre de sa liste.
+ */
+void heap_remove(Heap* heap, uint32_t* page_table, uint8_t* block, uint32_t block_size);
+
+/**
+ * Recherche un bloc libre d'au moins block_size octets.
+ * Le parcours d'une liste s'arrete apres heap->size / HEAP_MIN_BLOCK blocs, le plus
+ * grand nombre de blocs que le tas peut contenir : une liste plus longue a ete
+ * abimee par le processus, par exemple en une boucle.
+ * @return Le bloc trouve, NULL s'il n'y en a pas, FORBIDDEN_ADDRESS si la liste est abimee.
+ */
+uint8_t* heap_find(Heap* heap, uint32_t* page_table, uint32_t block_size);
+
+/**
+ * Agrandit le tas de pages pour qu'il contienne un bloc libre d'au moins block_size octets.
+ * Les pages sont ajoutees juste apres la fin du tas, le dernier bloc est agrandi s'il est libre.
+ * @return Le bloc libre, NULL si les pages suivant le tas ne sont pas libres.
+ */
+uint8_t* heap_grow(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint32_t block_size);
+
+/**
+ * Rend les pages d'un bloc libre qui vient d'etre fusionne, s'il est assez grand,
+ * en gardant les frames de ses HEAP_TOP_PAD premiers octets.
+ * A la fin du tas, les pages sont retirees du tas. Ailleurs, leurs frames sont rendues
+ * et les pages restent reservees.
+ * @return La nouvelle taille du bloc.
+ */
+uint32_t heap_trim(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint8_t* block, uint32_t block_size);
+
+/**
+ * Alloue un bloc d'au moins block_size octets, l'en-tete etant epingle.
+ * @return Le bloc, NULL si l'allocation n'est pas possible.
+ */
+uint8_t* heap_alloc_block(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint32_t block_size);
+
+/**
+ * Libere un bloc s'il est bien occupe, l'en-tete etant epingle.
+ */
+void heap_free_block(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint8_t* block);
 
 //----------------------------------------------------------Realisations
-MemoryBlock* heap_init(void* address)
+int heap_mapped(Heap* heap, uint32_t* page_table)
+{
+	uint32_t page = (uint32_t)heap / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	//Une page evincee est relue par vmem_touch.
+	return IS_MAPPED_DESCRIPTOR(descriptor) || IS_SWAPPED_DESCRIPTOR(descriptor);
+}
+
+uint32_t heap_pin(Heap* heap, uint32_t* page_table)
 {
-	//Allocation du premier bloc de la liste.
-	MemoryBlock* heap = (MemoryBlock*)kAlloc(sizeof(MemoryBlock));
-	//Initialisation du bloc.
-	heap->next = NULL;
-	heap->previous = NULL;
-	heap->address = address;
-	heap->size = 0;
-	heap->type = FREE;
+	//Le noyau modifie l'en-tete, qui peut etre partage par fork.
+	if (!vmem_touch(page_table, heap, sizeof(Heap), 1))
+	{
+		return UINT32_MAX;
+	}
+	uint32_t page = (uint32_t)heap / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t frame = get_entry_page_table(page_table, first_level_index, second_level_index) / PAGE_SIZE;
 
-	return heap;
+	get_frame_descriptor(frame)->flags |= FRAME_PINNED;
+	return frame;
 }
 
-void* heap_alloc(MemoryBlock* heap, uint32_t* page_table, uint32_t size)
+void heap_unpin(uint32_t frame)
 {
-	//On recherche un bloc libre assez grand pour accueillir ce nouveau bloc.
-	MemoryBlock* last_block = NULL;
-	MemoryBlock* current_block = heap;
-	while (current_block != NULL && (current_block->type != FREE || current_block->size < size))
+	get_frame_descriptor(frame)->flags &= ~FRAME_PINNED;
+}
+
+uint32_t heap_read(uint32_t* page_table, uint8_t* address)
+{
+	if (!vmem_touch(page_table, address, sizeof(uint32_t), 0))
 	{
-		last_block = current_block;
-		current_block = current_block->next;
+		return 0;
 	}
+	return *(uint32_t*)address;
+}
 
-	//On n'a pas trouvé un bloc dans la liste. On alloue des pages en plus.
-	if (current_block == NULL && last_block != NULL)
+void heap_write(uint32_t* page_table, uint8_t* address, uint32_t value)
+{
+	if (vmem_touch(page_table, address, sizeof(uint32_t), 1))
 	{
-		uint32_t start_address = (uint32_t)last_block->address + last_block->size;
-		//On calcule la taille des pages nécessaires.
-		uint32_t pages_size = (((size - 1) / PAGE_SIZE) + 1) * PAGE_SIZE;
-		uint8_t* pages_address = vmem_alloc_for_userland(page_table, pages_size, start_address, UP);
-		//Si l'allocation de page a réussie.
-		if (pages_address != NULL)
+		*(uint32_t*)address = value;
+	}
+}
+
+int heap_is_block(Heap* heap, uint8_t* block)
+{
+	return block >= (uint8_t*)heap + HEAP_FIRST_BLOCK
+		&& block < heap->end
+		&& ((uint32_t)block & 7) == HEAP_TAG_SIZE;
+}
+
+uint32_t heap_class(uint32_t block_size)
+{
+	//Une liste par puissance de 2.
+	return 31 - __builtin_clz(block_size);
+}
+
+void heap_set_tags(uint32_t* page_table, uint8_t* block, uint32_t block_size, uint32_t used)
+{
+	heap_write(page_table, block, block_size | used);
+	heap_write(page_table, block + block_size - HEAP_TAG_SIZE, block_size | used);
+}
+
+void heap_push(Heap* heap, uint32_t* page_table, uint8_t* block, uint32_t block_size)
+{
+	uint32_t class = heap_class(block_size);
+	uint8_t* head = heap->free_lists[class];
+
+	//Les liens sont apres l'etiquette : le suivant, puis le precedent.
+	heap_write(page_table, block + 4, (uint32_t)head);
+	heap_write(page_table, block + 8, 0);
+	if (head != NULL)
+	{
+		heap_write(page_table, head + 8, (uint32_t)block);
+	}
+	heap->free_lists[class] = block;
+	heap->bitmap |= 1u << class;
+}
+
+void heap_remove(Heap* heap, uint32_t* page_table, uint8_t* block, uint32_t block_size)
+{
+	uint32_t class = heap_class(block_size);
+	uint8_t* next = (uint8_t*)heap_read(page_table, block + 4);
+	uint8_t* previous = (uint8_t*)heap_read(page_table, block + 8);
+
+	if (previous != NULL && heap_is_block(heap, previous))
+	{
+		heap_write(page_table, previous + 4, (uint32_t)next);
+	}
+	else
+	{
+		heap->free_lists[class] = next;
+	}
+	if (next != NULL && heap_is_block(heap, next))
+	{
+		heap_write(page_table, next + 8, (uint32_t)previous);
+	}
+	//La liste est vide.
+	if (heap->free_lists[class] == NULL)
+	{
+		heap->bitmap &= ~(1u << class);
+	}
+}
+
+uint8_t* heap_find(Heap* heap, uint32_t* page_table, uint32_t block_size)
+{
+	uint32_t class = heap_class(block_size);
+
+	//Dans la liste de cette taille, les blocs peuvent etre trop petits : on cherche le premier qui convient.
+	uint8_t* block = heap->free_lists[class];
+	uint32_t step_limit = heap->size / HEAP_MIN_BLOCK;
+	for (uint32_t step = 0;block != NULL && heap_is_block(heap, block);step++)
+	{
+		if (step >= step_limit)
 		{
-			//On ajoute un bloc libre à la fin.
-			if (last_block->type == FREE)
-			{
-				//Si le dernier bloc est déjà libre, on l'agrandi.
-				last_block->address = pages_address - last_block->size;
-				last_block->size += pages_size;
-				current_block = last_block;
-			}
-			else
+			return FORBIDDEN_ADDRESS;
+		}
+		if ((heap_read(page_table, block) & ~7) >= block_size)
+		{
+			return block;
+		}
+		block = (uint8_t*)heap_read(page_table, block + 4);
+	}
+
+	//Dans les listes suivantes, tous les blocs conviennent : on prend la premiere non vide.
+	if (class + 1 < HEAP_CLASS_COUNT)
+	{
+		uint32_t larger = heap->bitmap & (UINT32_MAX << (class + 1));
+		if (larger != 0)
+		{
+			block = heap->free_lists[__builtin_ctz(larger)];
+			if (heap_is_block(heap, block))
 			{
-				//Sinon on crée un bloc libre à la fin.
-				MemoryBlock* new_block = (MemoryBlock*)kAlloc(sizeof(MemoryBlock));
-				//Initialisation du bloc.
-				new_block->next = NULL;
-				new_block->previous = last_block;
-				new_block->address = pages_address;
-				new_block->size = pages_size;
-				new_block->type = FREE;
-				//On relit le bloc au precedent.
-				last_block->next = new_block;
-				//On change de current_block maintenant qu'il y en a un nouveau à la fin.
-				current_block = new_block;
+				return block;
 			}
 		}
 	}
 
-	//On alloue un bloc dans le bloc vide si on en a trouvé un.
-	if (current_block != NULL && current_block->size >= size)
+	return NULL;
+}
+
+uint8_t* heap_grow(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint32_t block_size)
+{
+	uint8_t* first_block = (uint8_t*)heap + HEAP_FIRST_BLOCK;
+	uint8_t* block = heap->end;
+	uint32_t free_size = 0;
+
+	//Si le dernier bloc est libre, il n'y a que la difference a ajouter.
+	if (heap->end > first_block)
 	{
-		if (current_block->size == size)
+		uint32_t last_tag = heap_read(page_table, heap->end - HEAP_TAG_SIZE);
+		if ((last_tag & HEAP_USED) == 0 && heap_is_block(heap, heap->end - (last_tag & ~7)))
 		{
-			//La taille du bloc libre est déjà adaptée, il suffit de passer ce bloc en occupé.
-			current_block->type = OCCUPIED;
+			free_size = last_tag & ~7;
+			block = heap->end - free_size;
 		}
-		else
+	}
+
+	//Les pages doivent suivre exactement la fin du tas.
+	uint8_t* pages_start = heap->end + HEAP_TAG_SIZE;
+	uint32_t pages_size = (((block_size - free_size - 1) / PAGE_SIZE) + 1) * PAGE_SIZE;
+	uint8_t* pages_address = vmem_alloc_for_userland(page_table, vmas, pages_size, (uint32_t)pages_start, UP, VMA_HEAP);
+	if (pages_address != pages_start)
+	{
+		if (pages_address != NULL)
 		{
-			//On coupe le bloc courant en deux. La première partie sera occupée, la deuxième libre.
-			MemoryBlock* new_block = (MemoryBlock*)kAlloc(sizeof(MemoryBlock));
-			new_block->address = current_block->address + size;
-			new_block->size = current_block->size - size;
-			new_block->type = FREE;
-			//On relie les blocs pour insérer le nouveau bloc.
-			new_block->next = current_block->next;
-			current_block->next->previous = new_block;
-			new_block->previous = current_block;
-			current_block->next = new_block;
-			//On redimensionne le bloc courant.
-			current_block->size = size;
-			current_block->type = OCCUPIED;
+			vmem_free(page_table, vmas, pages_address, pages_size);
 		}
-		//On retourne l'adresse de début du bloc.
-		return current_block->address;
+		return NULL;
 	}
-	else
+
+	if (free_size > 0)
 	{
-		return NULL;
+		heap_remove(heap, page_table, block, free_size);
+	}
+	heap->end += pages_size;
+	heap->size += pages_size;
+	heap_set_tags(page_table, block, free_size + pages_size, 0);
+	heap_push(heap, page_table, block, free_size + pages_size);
+
+	return block;
+}
+
+uint32_t heap_trim(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint8_t* block, uint32_t block_size)
+{
+	//Un bloc qui depasse le seuil de moins de HEAP_TOP_PAD octets garde ses frames :
+	//le meme cycle d'allocation et de liberation ne refait pas les memes fautes.
+	if (block_size < HEAP_TRIM_THRESHOLD + HEAP_TOP_PAD)
+	{
+		return block_size;
+	}
+
+	//Les HEAP_TOP_PAD premiers octets du bloc, avec son etiquette et ses liens, restent projetes.
+	uint8_t* kept_end = (uint8_t*)aligned_value((uint32_t)block + HEAP_MIN_BLOCK + HEAP_TOP_PAD + HEAP_TAG_SIZE, 12);
+	//Le dernier bloc est raccourci, sur une fin de page : les pages suivantes sont retirees du tas.
+	if (block + block_size == heap->end)
+	{
+		uint8_t* old_top = heap->end + HEAP_TAG_SIZE;
+		if (kept_end < old_top)
+		{
+			vmem_free(page_table, vmas, kept_end, old_top - kept_end);
+			heap->size -= old_top - kept_end;
+			heap->end = kept_end - HEAP_TAG_SIZE;
+			block_size = heap->end - block;
+		}
+		return block_size;
 	}
+	//Ailleurs, les frames suivantes sont rendues, sauf celle de l'etiquette de fin.
+	vmem_release(page_table, kept_end, block + block_size - HEAP_TAG_SIZE - kept_end);
+
+	return block_size;
+}
+
+Heap* heap_init(uint32_t* page_table, VmaSet* vmas, void* address)
+{
+	//La premiere page est seulement reservee : elle sera remplie de 0 a son premier acces.
+	vmem_alloc_for_userland(page_table, vmas, PAGE_SIZE, (uint32_t)address, UP, VMA_HEAP);
+
+	return (Heap*)address;
 }
 
-uint32_t heap_size(MemoryBlock* heap)
+void* heap_alloc(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint32_t size)
 {
-	//On retient la taille totale du tas.
-	uint32_t size = 0;
-	//On parcourt toute la liste.
-	MemoryBlock* current_block = heap;
-	while (current_block != NULL)
+	//La taille du bloc, etiquettes comprises, arrondie a 8 octets.
+	if (size == 0 || size > UINT32_MAX / 2)
 	{
-		size += current_block->size;
+		return NULL;
+	}
+	uint32_t block_size = (size + 2 * HEAP_TAG_SIZE + 7) & ~7;
+	if (block_size < HEAP_MIN_BLOCK)
+	{
+		block_size = HEAP_MIN_BLOCK;
+	}
 
-		current_block = current_block->next;
+	uint32_t header_frame = heap_pin(heap, page_table);
+	if (header_frame == UINT32_MAX)
+	{
+		return NULL;
 	}
+	uint8_t* block = heap_alloc_block(heap, page_table, vmas, block_size);
+	heap_unpin(header_frame);
 
-	return size;
+	//On retourne l'adresse de début de la zone, apres l'etiquette.
+	return block != NULL ? block + HEAP_TAG_SIZE : NULL;
 }
 
-void heap_free(MemoryBlock* heap, void* address)
+uint8_t* heap_alloc_block(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint32_t block_size)
 {
-	//On recherche le bloc débutant à cette adresse et on le libère.
-	MemoryBlock* current_block = heap;
-	while (current_block != NULL && current_block->address != address)
+	uint8_t* first_block = (uint8_t*)heap + HEAP_FIRST_BLOCK;
+
+	//Au premier appel, le reste de la premiere page forme un bloc libre.
+	if (heap->end == NULL)
 	{
-		current_block = current_block->next;
+		heap->end = (uint8_t*)heap + PAGE_SIZE - HEAP_TAG_SIZE;
+		heap->size = heap->end - first_block;
+		heap_set_tags(page_table, first_block, heap->size, 0);
+		heap_push(heap, page_table, first_block, heap->size);
 	}
-	//Si le bloc débutant à cette adresse a été trouvé.
-	if (current_block != NULL)
+
+	//On recherche un bloc libre assez grand, sinon on ajoute des pages au tas.
+	//Une liste abimee ne doit pas faire grandir le tas a chaque allocation.
+	uint8_t* block = heap_find(heap, page_table, block_size);
+	if (block == FORBIDDEN_ADDRESS)
 	{
-		//On libère le bloc.
-		current_block->type = FREE;
-		//Si il y a un bloc vide avant, on fusionne les deux blocs.
-		if (current_block->previous != NULL && current_block->previous->type == FREE)
+		return NULL;
+	}
+	if (block == NULL)
+	{
+		block = heap_grow(heap, page_table, vmas, block_size);
+		if (block == NULL)
 		{
-			current_block->previous->size += current_block->size;
-			//On reconstitue les liens.
-			current_block->previous->next = current_block->next;
-			//Si il y a effectivement un noeud suivant.
-			if (current_block->next != NULL)
-			{
-				current_block->next->previous = current_block->previous;
-			}
-			//On libère le bloc courant.
-			MemoryBlock* previous_block = current_block->previous;
-			kFree((void*)current_block, sizeof(MemoryBlock));
-			current_block = previous_block;
+			return NULL;
 		}
-		//Si il y a un bloc vide après, on fusionne les deux blocs.
-		if (current_block->next != NULL && current_block->next->type == FREE)
-		{
-			current_block->size += current_block->next->size;
-			MemoryBlock* next_block = current_block->next;
+	}
 
-			current_block->next = current_block->next->next;
-			//S'il y a un bloc après le suivant.
-			if (current_block->next != NULL)
-			{
-				current_block->next->previous = current_block;
-			}
-			kFree((void*)next_block, sizeof(MemoryBlock));
-		}
+	uint32_t free_size = heap_read(page_table, block) & ~7;
+	heap_remove(heap, page_table, block, free_size);
+	//On coupe le bloc libre si le reste peut former un bloc.
+	if (free_size - block_size >= HEAP_MIN_BLOCK)
+	{
+		heap_set_tags(page_table, block + block_size, free_size - block_size, 0);
+		heap_push(heap, page_table, block + block_size, free_size - block_size);
 	}
+	else
+	{
+		block_size = free_size;
+	}
+	heap_set_tags(page_table, block, block_size, HEAP_USED);
+	heap->used += block_size;
+
+	return block;
 }
 
-void heap_free_all(MemoryBlock* heap, uint32_t* page_table)
+uint32_t heap_size(Heap* heap, uint32_t* page_table)
 {
-	//On retient la taille totale du tas pour libérer les pages mémoire.
-	uint32_t size = 0;
-	//On libère toute la liste des blocs en la parcourant.
-	MemoryBlock* next_bloc;
-	MemoryBlock* current_block = heap;
-	while (current_block != NULL)
+	//L'en-tete est lu juste apres vmem_touch, sans autre acces qui puisse l'evincer.
+	if (!heap_mapped(heap, page_table) || !vmem_touch(page_table, heap, sizeof(Heap), 0))
 	{
-		next_bloc = current_block->next;
+		return 0;
+	}
+	return heap->size;
+}
 
-		size += current_block->size;
-		kFree((void*)current_block, sizeof(MemoryBlock));
+void heap_free(Heap* heap, uint32_t* page_table, VmaSet* vmas, void* address)
+{
+	if (!heap_mapped(heap, page_table))
+	{
+		return;
+	}
+	uint32_t header_frame = heap_pin(heap, page_table);
+	if (header_frame == UINT32_MAX)
+	{
+		return;
+	}
+	heap_free_block(heap, page_table, vmas, (uint8_t*)address - HEAP_TAG_SIZE);
+	heap_unpin(header_frame);
+}
 
-		current_block = next_bloc;
+void heap_free_block(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint8_t* block)
+{
+	uint8_t* first_block = (uint8_t*)heap + HEAP_FIRST_BLOCK;
+
+	//On verifie que l'adresse est celle d'un bloc occupe, a l'aide de ses deux etiquettes.
+	if (!heap_is_block(heap, block))
+	{
+		return;
+	}
+	uint32_t tag = heap_read(page_table, block);
+	uint32_t block_size = tag & ~7;
+	if ((tag & HEAP_USED) == 0 || block_size < HEAP_MIN_BLOCK || block_size > (uint32_t)(heap->end - block)
+		|| heap_read(page_table, block + block_size - HEAP_TAG_SIZE) != tag)
+	{
+		return;
+	}
+	heap->used -= block_size;
+
+	//Si le bloc precedent est libre, on fusionne les deux blocs.
+	if (block > first_block)
+	{
+		uint32_t previous_tag = heap_read(page_table, block - HEAP_TAG_SIZE);
+		uint32_t previous_size = previous_tag & ~7;
+		if ((previous_tag & HEAP_USED) == 0 && heap_is_block(heap, block - previous_size))
+		{
+			block -= previous_size;
+			block_size += previous_size;
+			heap_remove(heap, page_table, block, previous_size);
+		}
 	}
-	//On libère les pages mémoire réservées au tas, si le tas a été alloué.
-	if (size > 0)
+	//Si le bloc suivant est libre, on fusionne les deux blocs.
+	if (block + block_size < heap->end)
 	{
-		vmem_free(page_table, (uint8_t*)heap->address, size);
+		uint32_t next_tag = heap_read(page_table, block + block_size);
+		uint32_t next_size = next_tag & ~7;
+		if ((next_tag & HEAP_USED) == 0 && next_size >= HEAP_MIN_BLOCK)
+		{
+			heap_remove(heap, page_table, block + block_size, next_size);
+			block_size += next_size;
+		}
 	}
-}
\ No newline at end of file
+
+	//Un grand bloc libre rend ses pages.
+	block_size = heap_trim(heap, page_table, vmas, block, block_size);
+	heap_set_tags(page_table, block, block_size, 0);
+	heap_push(heap, page_table, block, block_size);
+}
+
+void heap_free_all(Heap* heap, uint32_t* page_table, VmaSet* vmas)
+{
+	//Le tas occupe les pages jusqu'a la fin du dernier bloc, au moins la premiere page.
+	uint32_t size = PAGE_SIZE;
+	if (heap_mapped(heap, page_table) && vmem_touch(page_table, heap, sizeof(Heap), 0) && heap->end != NULL)
+	{
+		size = heap->end + HEAP_TAG_SIZE - (uint8_t*)heap;
+	}
+	vmem_free(page_table, vmas, (uint8_t*)heap, size);
+}
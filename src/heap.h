@@ -2,63 +2,81 @@
 #define HEAP_H
 
 #include <inttypes.h>
+#include "vma.h"
 
-//-----------------------------------------------------------------Types
-enum MemoryBlockType
-{
-    FREE, OCCUPIED
-};
-typedef enum MemoryBlockType MemoryBlockType;
+//Le nombre de listes de blocs libres, une par puissance de 2.
+#define HEAP_CLASS_COUNT 32
 
-struct MemoryBlock
+//-----------------------------------------------------------------Types
+/**
+ * L'en-tete d'un tas, au debut de sa premiere page, dans la memoire du processus.
+ * Les blocs suivent l'en-tete. Chaque bloc porte sa taille et son etat a ses deux
+ * extremites (boundary tags), ce qui permet de liberer un bloc a partir de son
+ * adresse et de le fusionner avec ses voisins en O(1).
+ * Comme le tas est entierement dans les pages du processus, fork le copie
+ * simplement en partageant ces pages.
+ * La page est remplie de 0 a son premier acces : un en-tete nul est un tas vide.
+ */
+struct Heap
 {
-	struct MemoryBlock* previous;
-	struct MemoryBlock* next;
-	uint8_t* address;
+	//La fin du dernier bloc, 0 tant que le tas n'a pas ete utilise.
+	uint8_t* end;
+	//La taille totale des blocs du tas, et celle des blocs occupes.
 	uint32_t size;
-	MemoryBlockType type;
+	uint32_t used;
+	//Les blocs libres de taille comprise entre 2^n et 2^(n+1).
+	uint8_t* free_lists[HEAP_CLASS_COUNT];
+	//Un bit a 1 pour chaque liste non vide.
+	uint32_t bitmap;
 };
-typedef struct MemoryBlock MemoryBlock;
+typedef struct Heap Heap;
 
 //---------------------------------------------------Fonctions publiques
 /**
  * Initialise un tas contenant les blocs de mémoire alloués d'un processus.
- * @param address L'adresse à laquelle commence le tas.
- * @return Un pointeur vers une structure decrivant le tas.
+ * La premiere page est reservee dans la table des pages du processus.
+ * @param page_table La table des pages du processus.
+ * @param vmas Les zones du processus.
+ * @param address L'adresse à laquelle commence le tas, alignee sur une page.
+ * @return Un pointeur vers l'en-tete du tas, valide quand la table du processus est chargee.
  */
-MemoryBlock* heap_init(void* address);
+Heap* heap_init(uint32_t* page_table, VmaSet* vmas, void* address);
 
 /**
  * Alloue un bloc de size octets dans un tas d'un processus.
  * Si l'allocation n'est pas possible, retourne l'adresse 0.
  * @param heap Le tas dans lequel allouer le bloc.
  * @param page_table La table des pages dans laquelle allouer des pages si le tas est trop petit.
+ * @param vmas Les zones du processus.
  * @param size La taille en octet à allouer.
  * @return L'adresse de debut de la zone allouée.
  */
-void* heap_alloc(MemoryBlock* heap, uint32_t* page_table, uint32_t size);
+void* heap_alloc(Heap* heap, uint32_t* page_table, VmaSet* vmas, uint32_t size);
 
 /**
  * Retourne la taille occupée en mémoire par le tas.
  * @param heap Le tas dont on veut connaitre la taille.
+ * @param page_table La table des pages du processus.
  * @return La taille totale du tas.
  */
-uint32_t heap_size(MemoryBlock* heap);
+uint32_t heap_size(Heap* heap, uint32_t* page_table);
 
 /**
  * Libère la mémoire du bloc commençant à une certaine adresse.
+ * Une adresse qui n'est pas celle d'un bloc occupe est ignoree.
  * @param heap Le tas dans lequel libérer le bloc.
+ * @param page_table La table des pages du processus.
+ * @param vmas Les zones du processus.
  * @param address L'adresse de début du bloc à libérer.
  */
-void heap_free(MemoryBlock* heap, void* address);
+void heap_free(Heap* heap, uint32_t* page_table, VmaSet* vmas, void* address);
 
 /**
  * Libère la mémoire du tas d'un processus.
  * @param heap Le tas à libérer.
  * @param page_table La table des pages dans laquelle libérer les pages occupées par le tas.
+ * @param vmas Les zones du processus.
  */
-void heap_free_all(MemoryBlock* heap, uint32_t* page_table);
-
-
+void heap_free_all(Heap* heap, uint32_t* page_table, VmaSet* vmas);
 
-#endif
\ No newline at end of file
+#endif
@@ -2,30 +2,39 @@
 
 #include "hw.h"
 #include "asm_tools.h"
+#include "division.h"
 
 /***************************
  ******** Utilities ********
  ***************************/
 uint64_t
 divide(uint64_t x, uint64_t y) {
-    int quotient = 0;
-    while (x >= y) {
-        x  -=  y;
-        quotient++;
-    }
-    return quotient;
+    return udiv64(x, y, NULL);
 }
 
 /* ***************************
  * ********** Timer **********
  * ***************************/
+
+/* Inverse of SYS_TIMER_CLOCK_div_1000, computed on first use */
+static Reciprocal ticks_per_ms;
+
+uint64_t
+timer_ticks_to_ms(uint64_t ticks)
+{
+    if (ticks_per_ms.divisor == 0) {
+        reciprocal_init(&ticks_per_ms, SYS_TIMER_CLOCK_div_1000);
+    }
+    return reciprocal_divide(ticks, &ticks_per_ms);
+}
+
 uint64_t
 get_date_ms()
 {
 #if RPI
     uint32_t date_lowbits = Get32(CLO);
     uint64_t date_highbits = (uint64_t) Get32(CHI);
-    uint64_t date = divide(((date_highbits << 32) | date_lowbits), SYS_TIMER_CLOCK_div_1000);
+    uint64_t date = timer_ticks_to_ms((date_highbits << 32) | date_lowbits);
 #else
     uint64_t date = ((uint64_t) 0x43 << 32) | 0x42;
 #endif
@@ -70,7 +79,7 @@ timer_init()
     ENABLE_TIMER_IRQ();
 
     /* Enable interrupt *line* */
-    Set32(0x2000B210, 0x00000002);
+    Set32(ENABLE_IRQS_1, TIMER_MATCH_1);
 }
 
 /* **************************
@@ -28,6 +28,7 @@
 #define CLOCK_BASE        (BCM2708_PERI_BASE + 0x101000) /* Address */
 
 /*********** Processor modes *************/
+#define USER_MODE 0x10
 #define IRQ_MODE 0x12
 #define SVC_MODE 0x13
 #define SYS_MODE 0x1F
@@ -46,10 +47,16 @@
 #define DEFAULT_TIMER_INTERVAL 2500000 /* 10 ms */
 #define CLOCK_PATCH 1111
 
+#define TIMER_MATCH_1 0x2
+
 #define ENABLE_TIMER_IRQ() Set32(CS,2)
 #define DISABLE_TIMER_IRQ() Set32(CS,~2);
 
 
+/********** Interrupt controller *********/
+#define IRQ_PENDING_1 0x2000B204 /* IRQ 0-31 pending */
+#define ENABLE_IRQS_1 0x2000B210 /* Writing 1 enables the line */
+
 /******************* GPIO ***************/
 #define SET_GPIO_ALT(g,a) *(gpio+(((g)/10))) |= (((a)<=3?(a)+4:(a)==4?3:2)<<(((g)%10)*3))
 #define GPFSEL1 0x20200004
@@ -104,6 +111,7 @@
 #define PM_RSTC_WRCFG_FULL_RESET 0x00000020
 
 /*************** Functions declaration *****************/
+uint64_t timer_ticks_to_ms(uint64_t ticks);
 uint64_t get_date_ms();
 void set_date_ms(uint64_t date_ms);
 void set_next_tick(uint32_t time_ms);
@@ -1,121 +1,360 @@
 #include <stdint.h>
 #include "kheap.h"
+#include "buddy.h"
+#include "config.h"
+#include "memory.h"
 
+/*
+ * Chunks carry a boundary tag at both ends: a header before the payload and
+ * a footer at the end, each holding the chunk size and the USED bit. Freeing
+ * a chunk looks at the footer of the previous one and the header of the next
+ * one to merge free neighbours. Chunks start 4 bytes after an 8-byte boundary
+ * so that payloads are 8-byte aligned, and their sizes are multiples of 8.
+ *
+ * Free chunks are kept in segregated lists: one exact size class per 8 bytes
+ * below KHEAP_SMALL_LIMIT, then one class per power of 2. A bitmap of the
+ * non-empty classes finds the next class with a free chunk in a few words.
+ *
+ * The memory above the last chunk (the wilderness) runs from kernel_heap_top
+ * to kernel_heap_limit. A freed chunk that touches it is merged back into it.
+ */
+
+#define KHEAP_USED 0x1
+#define KHEAP_TAG_SIZE 4
+#define KHEAP_MIN_CHUNK 16
+#define KHEAP_SMALL_LIMIT 512
+#define KHEAP_SMALL_CLASSES (KHEAP_SMALL_LIMIT / 8)
+#define KHEAP_CLASS_COUNT (KHEAP_SMALL_CLASSES + 24)
+#define KHEAP_BITMAP_SIZE ((KHEAP_CLASS_COUNT + 31) / 32)
 
 struct fl {
+	unsigned int	header;
 	struct fl	*next;
-	unsigned int	size;
-} *freelist = (struct fl *) 0;
+	struct fl	*prev;
+};
+
+struct fl *freelists[KHEAP_CLASS_COUNT];
+uint32_t freelist_bitmap[KHEAP_BITMAP_SIZE];
 
 uint8_t* kernel_heap_top;
 uint8_t* kernel_heap_limit;
 
+struct kheap_stats kernel_heap_stats;
+
+BuddyZone kernel_page_zone;
+
+/* Private functions */
+unsigned int kheap_class(unsigned int chunk_size);
+void kheap_push(struct fl *chunk, unsigned int chunk_size);
+void kheap_remove(struct fl *chunk, unsigned int chunk_size);
+struct fl *kheap_find(unsigned int chunk_size);
+void kheap_set_tags(uint8_t *chunk, unsigned int chunk_size, unsigned int used);
+uint8_t *kheap_take(uint8_t *chunk, unsigned int chunk_size, unsigned int needed);
+void kheap_release(uint8_t *chunk);
+
 unsigned int
 aligned_value(unsigned int addr, unsigned int pwr_of_2)
-{    
+{
     unsigned int modulo = (1 << pwr_of_2);
     unsigned int max_value_modulo = modulo - 1;
     return (addr + max_value_modulo) & ~max_value_modulo;
 }
 
-uint8_t*
-kAlloc_aligned(unsigned int size, unsigned int pwr_of_2)
+unsigned int
+kheap_class(unsigned int chunk_size)
 {
-	register struct fl *cfl = freelist, **prev;
-	unsigned int aligned_cfl = aligned_value((unsigned int) cfl, pwr_of_2);
-	unsigned int size_aligned = aligned_value(size, 2);
+	if (chunk_size < KHEAP_SMALL_LIMIT)
+	    return chunk_size / 8;
 
-	prev = &freelist;
-	while (cfl && (aligned_cfl != (unsigned int) cfl || cfl->size != size_aligned))
-	{
-	    prev = &(cfl->next);
-	    cfl = cfl->next;
-	    aligned_cfl = aligned_value((unsigned int) cfl, pwr_of_2);
-	}
+	/* One class per power of 2 above the small sizes */
+	return KHEAP_SMALL_CLASSES + (31 - __builtin_clz(chunk_size)) - (31 - __builtin_clz(KHEAP_SMALL_LIMIT));
+}
 
-	if (! cfl)
-	{
-	    cfl = (struct fl *) kernel_heap_top;
-	    aligned_cfl = aligned_value((unsigned int) cfl, pwr_of_2);
+void
+kheap_push(struct fl *chunk, unsigned int chunk_size)
+{
+	unsigned int class = kheap_class(chunk_size);
 
-	    if (aligned_cfl == (unsigned int) cfl)
-	    {
-		kernel_heap_top += size_aligned;
-	    }
-	    else
-	    {
-		kFree((uint8_t*) cfl, (aligned_cfl - (unsigned int) cfl));
-		kernel_heap_top = (uint8_t*) (aligned_cfl + size_aligned);
-	    }
+	chunk->prev = (struct fl *) 0;
+	chunk->next = freelists[class];
+	if (chunk->next)
+	    chunk->next->prev = chunk;
+	freelists[class] = chunk;
+	freelist_bitmap[class / 32] |= 1u << (class % 32);
 
-	    /* No space available anymore */
-	    if (kernel_heap_top > kernel_heap_limit)
-		return FORBIDDEN_ADDRESS;
-	}
+	kernel_heap_stats.free_bytes += chunk_size;
+	kernel_heap_stats.free_chunks++;
+}
+
+void
+kheap_remove(struct fl *chunk, unsigned int chunk_size)
+{
+	unsigned int class = kheap_class(chunk_size);
+
+	if (chunk->prev)
+	    chunk->prev->next = chunk->next;
 	else
+	    freelists[class] = chunk->next;
+	if (chunk->next)
+	    chunk->next->prev = chunk->prev;
+	if (! freelists[class])
+	    freelist_bitmap[class / 32] &= ~(1u << (class % 32));
+
+	kernel_heap_stats.free_bytes -= chunk_size;
+	kernel_heap_stats.free_chunks--;
+}
+
+struct fl *
+kheap_find(unsigned int chunk_size)
+{
+	unsigned int class = kheap_class(chunk_size);
+	register struct fl *cfl;
+
+	/* Large classes hold several sizes: first fit in the class itself */
+	if (class >= KHEAP_SMALL_CLASSES)
 	{
-	    if (aligned_cfl == (unsigned int) cfl)
+	    for (cfl = freelists[class]; cfl; cfl = cfl->next)
 	    {
-		*prev = cfl->next;
-	    }
-	    else
-	    {
-		kFree((uint8_t*) cfl, cfl->size - size_aligned);
+		if (cfl->header >= chunk_size)
+		    return cfl;
 	    }
+	    class++;
 	}
 
-	/* Fill with FORBIDDEN_BYTE to debug (more) easily */
-	for (int i = 0 ; i < size_aligned ; i++) {
-	    *(((uint8_t*) aligned_cfl) + i) = FORBIDDEN_BYTE;
+	/* Any chunk of a higher non-empty class is large enough */
+	for (unsigned int word = class / 32; word < KHEAP_BITMAP_SIZE; word++)
+	{
+	    uint32_t bits = freelist_bitmap[word];
+	    if (word == class / 32)
+		bits &= ~((1u << (class % 32)) - 1);
+	    if (bits)
+		return freelists[word * 32 + __builtin_ctz(bits)];
 	}
-	
-	return ((uint8_t *) aligned_cfl);
+
+	return (struct fl *) 0;
 }
 
-uint8_t*
-kAlloc(unsigned int size)
+void
+kheap_set_tags(uint8_t *chunk, unsigned int chunk_size, unsigned int used)
+{
+	*(unsigned int *) chunk = chunk_size | used;
+	*(unsigned int *) (chunk + chunk_size - KHEAP_TAG_SIZE) = chunk_size | used;
+}
+
+/*
+ * Marks the first needed bytes of a free chunk as used, and gives the rest
+ * back to the free lists if it can hold a chunk.
+ */
+uint8_t *
+kheap_take(uint8_t *chunk, unsigned int chunk_size, unsigned int needed)
 {
-	register struct fl *cfl = freelist, **prev;
-	unsigned int size_aligned = (size + 3) & ~3;
+	if (chunk + chunk_size == kernel_heap_top)
+	{
+	    /* Taken from the wilderness: the rest stays in it */
+	    kernel_heap_top = chunk + needed;
+	    chunk_size = needed;
+	}
+	else if (chunk_size - needed >= KHEAP_MIN_CHUNK)
+	{
+	    kheap_set_tags(chunk + needed, chunk_size - needed, 0);
+	    kheap_push((struct fl *) (chunk + needed), chunk_size - needed);
+	    chunk_size = needed;
+	}
+	kheap_set_tags(chunk, chunk_size, KHEAP_USED);
+
+	kernel_heap_stats.used_bytes += chunk_size;
+	if (kernel_heap_stats.used_bytes > kernel_heap_stats.high_water)
+	    kernel_heap_stats.high_water = kernel_heap_stats.used_bytes;
+
+	return chunk + KHEAP_TAG_SIZE;
+}
 
-	prev = &freelist;
+/*
+ * Frees a chunk marked as used, merging it with its free neighbours.
+ */
+void
+kheap_release(uint8_t *chunk)
+{
+	unsigned int chunk_size = *(unsigned int *) chunk & ~KHEAP_USED;
+	unsigned int prev_tag = *(unsigned int *) (chunk - KHEAP_TAG_SIZE);
 
-	while (cfl && cfl->size != size_aligned)
+	kernel_heap_stats.used_bytes -= chunk_size;
+
+	/* The word before the first chunk is a fence marked as used */
+	if (! (prev_tag & KHEAP_USED))
 	{
-	    prev = &cfl->next;
-	    cfl = cfl->next;
+	    chunk -= prev_tag;
+	    kheap_remove((struct fl *) chunk, prev_tag);
+	    chunk_size += prev_tag;
 	}
 
-	if (! cfl)
+	if (chunk + chunk_size == kernel_heap_top)
 	{
-	    cfl = (struct fl *) kernel_heap_top;
-	    kernel_heap_top += size_aligned;
+	    /* Back to the wilderness */
+	    kernel_heap_top = chunk;
+	    return;
+	}
+
+	unsigned int next_tag = *(unsigned int *) (chunk + chunk_size);
+	if (! (next_tag & KHEAP_USED))
+	{
+	    kheap_remove((struct fl *) (chunk + chunk_size), next_tag);
+	    chunk_size += next_tag;
+	}
 
+	kheap_set_tags(chunk, chunk_size, 0);
+	kheap_push((struct fl *) chunk, chunk_size);
+}
+
+uint8_t*
+kAlloc_aligned(unsigned int size, unsigned int pwr_of_2)
+{
+	unsigned int alignment = 1 << pwr_of_2;
+	unsigned int needed = aligned_value(size + 2 * KHEAP_TAG_SIZE, 3);
+
+	if (alignment <= 8)
+	    return kAlloc(size);
+	if (needed < KHEAP_MIN_CHUNK)
+	    needed = KHEAP_MIN_CHUNK;
+
+	/* Room for the chunk and a free chunk in front of it */
+	unsigned int search = needed + alignment + KHEAP_MIN_CHUNK;
+	uint8_t *chunk;
+	unsigned int chunk_size;
+	struct fl *cfl = kheap_find(search);
+
+	if (cfl)
+	{
+	    chunk = (uint8_t *) cfl;
+	    chunk_size = cfl->header;
+	    kheap_remove(cfl, chunk_size);
+	}
+	else
+	{
 	    /* No space available anymore */
-	    if (kernel_heap_top > kernel_heap_limit)
+	    if (kernel_heap_top + search > kernel_heap_limit)
 		return FORBIDDEN_ADDRESS;
+	    chunk = kernel_heap_top;
+	    chunk_size = search;
+	    kernel_heap_top += search;
+	}
+
+	unsigned int payload = aligned_value((unsigned int) chunk + KHEAP_TAG_SIZE, pwr_of_2);
+	unsigned int front = payload - KHEAP_TAG_SIZE - (unsigned int) chunk;
+	if (front != 0 && front < KHEAP_MIN_CHUNK)
+	{
+	    payload += alignment;
+	    front += alignment;
+	}
+	if (front != 0)
+	{
+	    kheap_set_tags(chunk, front, KHEAP_USED);
+	    kernel_heap_stats.used_bytes += front;
+	    kheap_set_tags(chunk + front, chunk_size - front, KHEAP_USED);
+	    kernel_heap_stats.used_bytes += chunk_size - front;
+	    kheap_release(chunk);
+	    chunk += front;
+	    chunk_size -= front;
+	    kernel_heap_stats.used_bytes -= chunk_size;
+	}
+
+	uint8_t *ptr = kheap_take(chunk, chunk_size, needed);
+#if KHEAP_POISON
+	memset(ptr, FORBIDDEN_BYTE, needed - 2 * KHEAP_TAG_SIZE);
+#endif
+	return ptr;
+}
+
+uint8_t*
+kAlloc(unsigned int size)
+{
+	unsigned int needed = aligned_value(size + 2 * KHEAP_TAG_SIZE, 3);
+	uint8_t *chunk;
+	unsigned int chunk_size;
+
+	if (needed < KHEAP_MIN_CHUNK)
+	    needed = KHEAP_MIN_CHUNK;
+
+	struct fl *cfl = kheap_find(needed);
+	if (cfl)
+	{
+	    chunk = (uint8_t *) cfl;
+	    chunk_size = cfl->header;
+	    kheap_remove(cfl, chunk_size);
 	}
 	else
 	{
-	    *prev = cfl->next;
+	    /* No space available anymore */
+	    if (kernel_heap_top + needed > kernel_heap_limit)
+		return FORBIDDEN_ADDRESS;
+	    chunk = kernel_heap_top;
+	    chunk_size = needed;
+	    kernel_heap_top += needed;
 	}
 
+	uint8_t *ptr = kheap_take(chunk, chunk_size, needed);
+#if KHEAP_POISON
 	/* Fill with FORBIDDEN_BYTE to debug (more) easily */
-	for (int i = 0 ; i < size_aligned ; i++) {
-	    *((uint8_t*) cfl + i) = FORBIDDEN_BYTE;
+	memset(ptr, FORBIDDEN_BYTE, needed - 2 * KHEAP_TAG_SIZE);
+#endif
+	return ptr;
+}
+
+void
+kFree(uint8_t* ptr, unsigned int size)
+{
+	uint8_t *chunk = ptr - KHEAP_TAG_SIZE;
+
+	/* The size is kept in the boundary tag */
+	(void) size;
+#if KHEAP_POISON
+	memset(ptr, FORBIDDEN_BYTE, (*(unsigned int *) chunk & ~KHEAP_USED) - 2 * KHEAP_TAG_SIZE);
+#endif
+	kheap_release(chunk);
+}
+
+void
+kheap_get_stats(struct kheap_stats *stats)
+{
+	*stats = kernel_heap_stats;
+	stats->wilderness_bytes = kernel_heap_limit - kernel_heap_top;
+
+	/* The largest free chunk is in the highest non-empty class */
+	stats->largest_free_chunk = 0;
+	for (int class = KHEAP_CLASS_COUNT - 1; class >= 0; class--)
+	{
+	    if (! freelists[class])
+		continue;
+	    for (struct fl *cfl = freelists[class]; cfl; cfl = cfl->next)
+	    {
+		if (cfl->header > stats->largest_free_chunk)
+		    stats->largest_free_chunk = cfl->header;
+	    }
+	    break;
 	}
+}
 
-	return ((uint8_t *) cfl);
+uint8_t*
+kAlloc_pages(unsigned int order)
+{
+	uint32_t frame = buddy_alloc(&kernel_page_zone, order);
+
+	if (frame == BUDDY_NONE)
+	    return FORBIDDEN_ADDRESS;
+
+	return (uint8_t*) (frame * KHEAP_PAGE_SIZE);
 }
 
 void
-kFree(uint8_t* ptr, unsigned int size)
+kFree_pages(uint8_t* ptr, unsigned int order)
 {
-	register struct fl* cfl = (struct fl*) ptr;
+	buddy_free(&kernel_page_zone, (unsigned int) ptr / KHEAP_PAGE_SIZE, order);
+}
 
-	cfl->size = (size + 3) & ~3;
-	cfl->next = freelist;
-	freelist = cfl;
+unsigned int
+kheap_free_page_count()
+{
+	return buddy_free_frame_count(&kernel_page_zone);
 }
 
 void
@@ -123,4 +362,21 @@ kheap_init()
 {
     kernel_heap_top = (uint8_t*) &__kernel_heap_start__;
     kernel_heap_limit = (uint8_t*) &__kernel_heap_end__;
+
+    /* The page zone is taken at the start of the heap, which is page aligned */
+    unsigned int first_page = aligned_value((unsigned int) kernel_heap_top, 12) / KHEAP_PAGE_SIZE;
+    kernel_heap_top = (uint8_t*) ((first_page * KHEAP_PAGE_SIZE) + KHEAP_PAGES_SIZE);
+
+    /* A fence marked as used before the first chunk, which starts 4 bytes after an 8-byte boundary */
+    *(unsigned int *) kernel_heap_top = KHEAP_USED;
+    kernel_heap_top += KHEAP_TAG_SIZE;
+
+    for (int class = 0; class < KHEAP_CLASS_COUNT; class++)
+	freelists[class] = (struct fl *) 0;
+    for (int word = 0; word < KHEAP_BITMAP_SIZE; word++)
+	freelist_bitmap[word] = 0;
+    memset(&kernel_heap_stats, 0, sizeof(kernel_heap_stats));
+
+    buddy_init(&kernel_page_zone, first_page, KHEAP_PAGES_SIZE / KHEAP_PAGE_SIZE);
+    buddy_add_range(&kernel_page_zone, first_page, first_page + KHEAP_PAGES_SIZE / KHEAP_PAGE_SIZE);
 }
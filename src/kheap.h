@@ -14,11 +14,38 @@ extern uint32_t __devices_end__;
 extern uint32_t __stacks_end__;
 extern uint32_t __bss_end__;
 
+/*
+ * Counters of the kernel heap, in bytes. Free chunks are in the free lists,
+ * the wilderness is the untouched memory at the end of the heap.
+ * free_bytes against largest_free_chunk gives the fragmentation.
+ */
+struct kheap_stats {
+	unsigned int	used_bytes;
+	unsigned int	high_water;
+	unsigned int	free_bytes;
+	unsigned int	free_chunks;
+	unsigned int	largest_free_chunk;
+	unsigned int	wilderness_bytes;
+};
+
 unsigned int aligned_value(unsigned int addr, unsigned int pwr_of_2);
 uint8_t* kAlloc_aligned(unsigned int size, unsigned int pwr_of_2);
 uint8_t* kAlloc(unsigned int size);
 void kFree(uint8_t* ptr, unsigned int size);
 void kheap_init();
+void kheap_get_stats(struct kheap_stats *stats);
+
+/*
+ * Pages of the kernel heap, handed out by a buddy allocator in blocks of
+ * 2^order pages, aligned on their size. They back the slab caches and the
+ * first level translation tables.
+ */
+#define KHEAP_PAGE_SIZE 4096
+#define KHEAP_PAGES_SIZE 0x800000
+
+uint8_t* kAlloc_pages(unsigned int order);
+void kFree_pages(uint8_t* ptr, unsigned int order);
+unsigned int kheap_free_page_count();
 
 #define FORBIDDEN_BYTE ((uint8_t) 0x00)
 #define FORBIDDEN_ADDRESS (void*) 0xFFFFFFF0
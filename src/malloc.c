@@ -0,0 +1,258 @@
+#include "malloc.h"
+#include "syscall.h"
+#include "vmem.h"
+#include "memory.h"
+#include "config.h"
+
+//Chaque bloc est precede d'un en-tete de 8 octets : sa taille, en-tete compris,
+//avec des flags dans les bits de poids faible, et pour un bloc aligne le
+//decalage vers le bloc alloue par malloc.
+#define MALLOC_HEADER_SIZE 8
+//Le bloc a ete projete par sys_mmap.
+#define MALLOC_LARGE 0x1
+//Le bloc est a l'interieur d'un bloc plus grand, pour aligned_alloc.
+#define MALLOC_ALIGNED 0x2
+#define MALLOC_FLAGS 0xF
+
+//-----------------------------------------------------------------Types
+struct MallocHeader
+{
+	uint32_t size;
+	uint32_t offset;
+};
+typedef struct MallocHeader MallocHeader;
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Retourne la classe d'un bloc de size octets, en-tete compris.
+ * Les classes sont 16, 32, 48, 64, 96, 128, ... : une puissance de 2 et 1,5 fois une puissance de 2.
+ */
+uint32_t malloc_class(uint32_t size);
+
+/**
+ * Retourne la taille des blocs d'une classe.
+ */
+uint32_t malloc_class_size(uint32_t class);
+
+/**
+ * Retourne l'en-tete d'un bloc.
+ */
+MallocHeader* malloc_header(void* address);
+
+/**
+ * Retourne le nombre d'octets utilisables d'un bloc.
+ */
+uint32_t malloc_usable_size(void* address);
+
+
+uint32_t malloc_class(uint32_t size)
+{
+	if (size <= 16)
+	{
+		return 0;
+	}
+	if (size <= 32)
+	{
+		return 1;
+	}
+	//2^k < size <= 2^(k+1)
+	uint32_t k = 31 - __builtin_clz(size - 1);
+	if (size <= (3u << (k - 1)))
+	{
+		return 2 * (k - 5) + 2;
+	}
+	return 2 * (k - 5) + 3;
+}
+
+uint32_t malloc_class_size(uint32_t class)
+{
+	if (class < 2)
+	{
+		return 16 << class;
+	}
+	uint32_t k = 5 + (class - 2) / 2;
+	if ((class - 2) % 2 == 0)
+	{
+		return 3u << (k - 1);
+	}
+	return 1u << (k + 1);
+}
+
+MallocHeader* malloc_header(void* address)
+{
+	return (MallocHeader*)((uint8_t*)address - MALLOC_HEADER_SIZE);
+}
+
+uint32_t malloc_usable_size(void* address)
+{
+	MallocHeader* header = malloc_header(address);
+	if (header->size & MALLOC_ALIGNED)
+	{
+		void* block = (uint8_t*)address - header->offset;
+		return malloc_usable_size(block) - header->offset;
+	}
+	return (header->size & ~MALLOC_FLAGS) - MALLOC_HEADER_SIZE;
+}
+
+//----------------------------------------------------------Realisations
+MallocState* malloc_state()
+{
+	//La page est reservee par le noyau a la creation du processus.
+	return (MallocState*)USER_BREAK_START;
+}
+
+void* malloc(size_t size)
+{
+	MallocState* state = malloc_state();
+	uint32_t block_size = (size + MALLOC_HEADER_SIZE + 15) & ~15;
+	MallocHeader* header;
+
+	if (size > UINT32_MAX - MALLOC_SMALL_MAX)
+	{
+		return NULL;
+	}
+	if (!state->initialized)
+	{
+		//La page est neuve : les listes sont vides et la zone courante aussi.
+		state->bump = NULL;
+		state->bump_end = NULL;
+		state->initialized = 1;
+	}
+	state->alloc_count++;
+
+	//Les gros blocs ont leurs propres pages.
+	if (block_size > MALLOC_SMALL_MAX)
+	{
+		block_size = (block_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+		header = (MallocHeader*)sys_mmap(block_size);
+		if (header == NULL)
+		{
+			return NULL;
+		}
+		state->mmap_count++;
+		header->size = block_size | MALLOC_LARGE;
+		return (uint8_t*)header + MALLOC_HEADER_SIZE;
+	}
+
+	uint32_t class = malloc_class(block_size);
+	//Le cas courant : un bloc libere de la meme classe.
+	header = (MallocHeader*)state->free_lists[class];
+	if (header != NULL)
+	{
+		state->free_lists[class] = *(void**)header;
+	}
+	else
+	{
+		//Sinon on decoupe un nouveau bloc dans la zone courante.
+		block_size = malloc_class_size(class);
+		if (state->bump + block_size > state->bump_end)
+		{
+			//Les pages ne sont que reservees : en demander beaucoup ne coute rien.
+			uint8_t* refill = (uint8_t*)sys_sbrk(MALLOC_REFILL_SIZE);
+			if (refill == (uint8_t*)-1)
+			{
+				return NULL;
+			}
+			state->sbrk_count++;
+			//La fin de la zone precedente est perdue si le break a ete deplace ailleurs.
+			if (refill != state->bump_end)
+			{
+				state->bump = refill;
+			}
+			state->bump_end = refill + MALLOC_REFILL_SIZE;
+		}
+		header = (MallocHeader*)state->bump;
+		state->bump += block_size;
+	}
+	header->size = malloc_class_size(class);
+	return (uint8_t*)header + MALLOC_HEADER_SIZE;
+}
+
+void free(void* address)
+{
+	if (address == NULL)
+	{
+		return;
+	}
+	MallocState* state = malloc_state();
+	MallocHeader* header = malloc_header(address);
+
+	if (header->size & MALLOC_ALIGNED)
+	{
+		//On libere le bloc qui contient le bloc aligne.
+		free((uint8_t*)address - header->offset);
+		return;
+	}
+	state->free_count++;
+	if (header->size & MALLOC_LARGE)
+	{
+		sys_munmap(header, header->size & ~MALLOC_FLAGS);
+		return;
+	}
+	uint32_t class = malloc_class(header->size);
+	*(void**)header = state->free_lists[class];
+	state->free_lists[class] = header;
+}
+
+void* calloc(size_t count, size_t size)
+{
+	if (size != 0 && count > UINT32_MAX / size)
+	{
+		return NULL;
+	}
+	uint32_t total = count * size;
+	uint32_t* words = (uint32_t*)malloc(total);
+	if (words != NULL)
+	{
+		//Un bloc recycle n'est pas vide. Les blocs font un nombre entier de mots.
+		for (uint32_t i = 0;i < (total + 3) / 4;i++)
+		{
+			words[i] = 0;
+		}
+	}
+	return words;
+}
+
+void* realloc(void* address, size_t size)
+{
+	if (address == NULL)
+	{
+		return malloc(size);
+	}
+	if (size == 0)
+	{
+		free(address);
+		return NULL;
+	}
+	uint32_t usable = malloc_usable_size(address);
+	if (size <= usable)
+	{
+		return address;
+	}
+	void* new_address = malloc(size);
+	if (new_address != NULL)
+	{
+		memcpy(new_address, address, usable);
+		free(address);
+	}
+	return new_address;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+	if (alignment <= MALLOC_HEADER_SIZE)
+	{
+		return malloc(size);
+	}
+	//Assez de place pour aligner le bloc et lui donner son propre en-tete.
+	uint8_t* block = (uint8_t*)malloc(size + alignment + MALLOC_HEADER_SIZE);
+	if (block == NULL)
+	{
+		return NULL;
+	}
+	uint8_t* address = (uint8_t*)(((uint32_t)block + MALLOC_HEADER_SIZE + alignment - 1) & ~(alignment - 1));
+	MallocHeader* header = malloc_header(address);
+	header->size = MALLOC_ALIGNED;
+	header->offset = address - block;
+	return address;
+}
@@ -0,0 +1,74 @@
+#ifndef MALLOC_H
+#define MALLOC_H
+
+#include <inttypes.h>
+
+typedef __SIZE_TYPE__ size_t;
+
+//Allocateur des processus, execute en mode user.
+//Les petits blocs sont pris dans des listes par classe de taille, remplies
+//depuis une zone obtenue par sys_sbrk en une seule fois : le cas courant
+//ne fait aucun appel systeme. Les gros blocs sont projetes par sys_mmap.
+//L'etat de l'allocateur est dans la premiere page de la zone du break,
+//propre a chaque processus et copiee par fork.
+
+//Les classes vont de 16 octets a MALLOC_SMALL_MAX, en-tete compris.
+#define MALLOC_CLASS_COUNT 16
+#define MALLOC_SMALL_MAX 4096
+//Taille demandee a sys_sbrk quand la zone courante est epuisee.
+#define MALLOC_REFILL_SIZE (64 * 1024)
+
+//-----------------------------------------------------------------Types
+struct MallocState
+{
+	//1 une fois l'etat initialise. La page est remplie de 0 a son premier acces.
+	uint32_t initialized;
+	//La zone dans laquelle on decoupe les nouveaux blocs.
+	uint8_t* bump;
+	uint8_t* bump_end;
+	//Les blocs libres de chaque classe, chaines par leur premier mot.
+	void* free_lists[MALLOC_CLASS_COUNT];
+	//Statistiques.
+	uint32_t alloc_count;
+	uint32_t free_count;
+	uint32_t sbrk_count;
+	uint32_t mmap_count;
+};
+typedef struct MallocState MallocState;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Alloue size octets, alignes sur 8 octets.
+ * @return L'adresse du bloc, NULL si la memoire ne peut pas etre obtenue.
+ */
+void* malloc(size_t size);
+
+/**
+ * Libere un bloc alloue par malloc, calloc, realloc ou aligned_alloc.
+ */
+void free(void* address);
+
+/**
+ * Alloue un tableau de count elements de size octets, rempli de 0.
+ */
+void* calloc(size_t count, size_t size);
+
+/**
+ * Change la taille d'un bloc. Le bloc n'est deplace que s'il est trop petit.
+ * @param address Le bloc, ou NULL pour en allouer un.
+ * @param size La nouvelle taille, 0 pour liberer le bloc.
+ * @return L'adresse du bloc, qui garde son contenu.
+ */
+void* realloc(void* address, size_t size);
+
+/**
+ * Alloue size octets alignes sur alignment, une puissance de 2.
+ */
+void* aligned_alloc(size_t alignment, size_t size);
+
+/**
+ * Retourne l'etat de l'allocateur du processus courant.
+ */
+MallocState* malloc_state();
+
+#endif
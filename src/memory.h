@@ -0,0 +1,38 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <inttypes.h>
+
+//Fonctions de memory.s. Les zones alignees sur 4 octets sont traitees par rafales
+//de 32 octets ; les tailles et les adresses peuvent etre quelconques.
+//gcc peut aussi appeler memcpy et memset pour copier ou initialiser des structures.
+
+/**
+ * Copie une zone de mémoire dans une autre zone.
+ * Les zones ne doivent pas se chevaucher, sauf si la destination est avant la source.
+ * @param destination L'adresse de destination.
+ * @param source L'adresse source.
+ * @param size La taille de la zone mémoire à copier, en octets.
+ * @return La destination.
+ */
+void* memcpy(void* destination, const void* source, uint32_t size);
+
+/**
+ * Copie une zone de mémoire dans une autre zone, qui peut la chevaucher.
+ * @param destination L'adresse de destination.
+ * @param source L'adresse source.
+ * @param size La taille de la zone mémoire à copier, en octets.
+ * @return La destination.
+ */
+void* memmove(void* destination, const void* source, uint32_t size);
+
+/**
+ * Remplit une zone de mémoire d'un octet.
+ * @param destination L'adresse de la zone.
+ * @param value L'octet, dans les 8 bits de poids faible.
+ * @param size La taille de la zone, en octets.
+ * @return La destination.
+ */
+void* memset(void* destination, int value, uint32_t size);
+
+#endif
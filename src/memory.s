@@ -0,0 +1,149 @@
+;@ Copie et remplissage de la memoire.
+;@ Les zones alignees sont traitees par rafales de 8 registres (32 octets, une ligne
+;@ de cache) avec ldm/stm, en prechargeant les lignes suivantes avec pld.
+;@ Le bit U du registre de controle n'est pas mis : un ldr/str non aligne ne lit
+;@ pas les bons octets. Les octets de tete sont donc copies un par un jusqu'a
+;@ aligner la destination, et une source qui ne peut pas etre alignee en meme
+;@ temps est copiee octet par octet.
+.syntax unified
+
+;@ void* memcpy(void* destination, const void* source, uint32_t size)
+;@ Les zones ne doivent pas se chevaucher, sauf si la destination est avant la source.
+.globl memcpy
+memcpy:
+	mov   ip, r0                    @ on retourne la destination
+	push  {r4-r10}
+	eor   r3, r0, r1
+	tst   r3, #3
+	bne   memcpy_bytes              @ source et destination jamais alignees ensemble
+memcpy_head:
+	tst   r0, #3
+	beq   memcpy_aligned
+	subs  r2, r2, #1
+	blo   memcpy_done
+	ldrb  r3, [r1], #1
+	strb  r3, [r0], #1
+	b     memcpy_head
+memcpy_aligned:
+	subs  r2, r2, #32
+	blo   memcpy_words
+memcpy_burst:
+	pld   [r1, #64]
+	ldmia r1!, {r3-r10}
+	stmia r0!, {r3-r10}
+	subs  r2, r2, #32
+	bhs   memcpy_burst
+memcpy_words:
+	add   r2, r2, #32
+memcpy_words_loop:
+	subs  r2, r2, #4
+	ldrhs r3, [r1], #4
+	strhs r3, [r0], #4
+	bhs   memcpy_words_loop
+	add   r2, r2, #4
+memcpy_bytes:
+	subs  r2, r2, #1
+	ldrbhs r3, [r1], #1
+	strbhs r3, [r0], #1
+	bhs   memcpy_bytes
+memcpy_done:
+	pop   {r4-r10}
+	mov   r0, ip
+	mov   pc, lr
+
+;@ void* memmove(void* destination, const void* source, uint32_t size)
+;@ Les zones peuvent se chevaucher : si la destination est dans la source,
+;@ la copie se fait depuis la fin.
+.globl memmove
+memmove:
+	cmp   r0, r1
+	bls   memcpy                    @ destination avant la source
+	add   r3, r1, r2
+	cmp   r0, r3
+	bhs   memcpy                    @ pas de chevauchement
+	mov   ip, r0
+	push  {r4-r10}
+	add   r0, r0, r2
+	add   r1, r1, r2
+	eor   r3, r0, r1
+	tst   r3, #3
+	bne   memmove_bytes
+memmove_head:
+	tst   r0, #3
+	beq   memmove_aligned
+	subs  r2, r2, #1
+	blo   memmove_done
+	ldrb  r3, [r1, #-1]!
+	strb  r3, [r0, #-1]!
+	b     memmove_head
+memmove_aligned:
+	subs  r2, r2, #32
+	blo   memmove_words
+memmove_burst:
+	pld   [r1, #-64]
+	ldmdb r1!, {r3-r10}
+	stmdb r0!, {r3-r10}
+	subs  r2, r2, #32
+	bhs   memmove_burst
+memmove_words:
+	add   r2, r2, #32
+memmove_words_loop:
+	subs  r2, r2, #4
+	ldrhs r3, [r1, #-4]!
+	strhs r3, [r0, #-4]!
+	bhs   memmove_words_loop
+	add   r2, r2, #4
+memmove_bytes:
+	subs  r2, r2, #1
+	ldrbhs r3, [r1, #-1]!
+	strbhs r3, [r0, #-1]!
+	bhs   memmove_bytes
+memmove_done:
+	pop   {r4-r10}
+	mov   r0, ip
+	mov   pc, lr
+
+;@ void* memset(void* destination, int value, uint32_t size)
+.globl memset
+memset:
+	mov   ip, r0
+	and   r1, r1, #0xFF
+	orr   r1, r1, r1, lsl #8
+	orr   r1, r1, r1, lsl #16       @ l'octet dans les 4 octets du mot
+memset_head:
+	tst   r0, #3
+	beq   memset_aligned
+	subs  r2, r2, #1
+	blo   memset_return
+	strb  r1, [r0], #1
+	b     memset_head
+memset_aligned:
+	subs  r2, r2, #32
+	blo   memset_words
+	push  {r4-r9}
+	mov   r3, r1
+	mov   r4, r1
+	mov   r5, r1
+	mov   r6, r1
+	mov   r7, r1
+	mov   r8, r1
+	mov   r9, r1
+memset_burst:
+	stmia r0!, {r1, r3-r9}
+	subs  r2, r2, #32
+	bhs   memset_burst
+	pop   {r4-r9}
+memset_words:
+	add   r2, r2, #32
+memset_words_loop:
+	subs  r2, r2, #4
+	strhs r1, [r0], #4
+	bhs   memset_words_loop
+	add   r2, r2, #4
+memset_bytes:
+	subs  r2, r2, #1
+	strbhs r1, [r0], #1
+	bhs   memset_bytes
+memset_return:
+	mov   r0, ip
+	mov   pc, lr
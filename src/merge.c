@@ -0,0 +1,208 @@
+#include "merge.h"
+#include "vmem.h"
+#include "page_table.h"
+#include "config.h"
+
+//----------------------------------------------------Variables globales
+
+//Les pages stables deja examinees, rangees par somme de leur contenu.
+//Une nouvelle page stable remplace celle de sa case : la table ne grossit pas.
+MergeCandidate merge_candidates[MERGE_TABLE_SIZE];
+
+//La prochaine frame examinee, dans la table des frames.
+uint32_t merge_hand = 0;
+
+uint32_t merge_scanned_count = 0;
+uint32_t merge_merged_count = 0;
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Retourne la somme du contenu d'une page.
+ */
+uint32_t merge_checksum(const uint32_t* words);
+
+/**
+ * Indique si deux pages ont le meme contenu.
+ */
+int merge_same_content(const uint32_t* first, const uint32_t* second);
+
+/**
+ * Indique si la page d'un candidat est toujours projetee sur sa frame.
+ */
+int merge_candidate_valid(const MergeCandidate* candidate);
+
+/**
+ * Indique si une frame peut etre partagee : elle n'est projetee qu'une fois, par une page
+ * de 4ko de l'espace utilisateur de sa table proprietaire.
+ */
+int merge_scannable(uint32_t frame);
+
+/**
+ * Examine une page d'un processus : retient sa somme, ou partage sa frame
+ * avec une page candidate identique.
+ */
+void merge_scan_page(uint32_t* page_table, uint32_t page);
+
+//----------------------------------------------------------Realisations
+uint32_t merge_checksum(const uint32_t* words)
+{
+	uint32_t checksum = 0;
+	for (uint32_t i = 0;i < PAGE_SIZE / sizeof(uint32_t);i++)
+	{
+		checksum = (checksum << 5) - checksum + words[i];
+	}
+	return checksum;
+}
+
+int merge_same_content(const uint32_t* first, const uint32_t* second)
+{
+	for (uint32_t i = 0;i < PAGE_SIZE / sizeof(uint32_t);i++)
+	{
+		if (first[i] != second[i])
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int merge_candidate_valid(const MergeCandidate* candidate)
+{
+	uint32_t first_level_index = candidate->page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = candidate->page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(candidate->page_table, first_level_index, second_level_index);
+
+	return IS_MAPPED_DESCRIPTOR(descriptor) && !IS_LARGE_PAGE_DESCRIPTOR(descriptor)
+		&& descriptor / PAGE_SIZE == candidate->frame;
+}
+
+int merge_scannable(uint32_t frame)
+{
+	const FrameDescriptor* descriptor = get_frame_descriptor(frame);
+
+	//Une frame deja partagee ne libererait rien, et sans proprietaire sa page n'est pas connue.
+	if (descriptor == NULL || descriptor->refcount != 1 || descriptor->owner == NULL
+		|| (descriptor->flags & (FRAME_KERNEL | FRAME_PINNED | FRAME_DMA | FRAME_ZEROED))
+		|| descriptor->owner_page < USER_SPACE_START / PAGE_SIZE)
+	{
+		return 0;
+	}
+	uint32_t first_level_index = descriptor->owner_page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = descriptor->owner_page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t entry = get_entry_page_table(descriptor->owner, first_level_index, second_level_index);
+
+	return IS_MAPPED_DESCRIPTOR(entry) && entry / PAGE_SIZE == frame;
+}
+
+void merge_scan_page(uint32_t* page_table, uint32_t page)
+{
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	//Seules les pages de 4ko qui ont une frame sont partagees.
+	if (!IS_MAPPED_DESCRIPTOR(descriptor) || IS_LARGE_PAGE_DESCRIPTOR(descriptor))
+	{
+		return;
+	}
+	uint32_t frame = descriptor / PAGE_SIZE;
+	FrameDescriptor* frame_descriptor = get_frame_descriptor(frame);
+	if (frame_descriptor == NULL || (frame_descriptor->flags & (FRAME_KERNEL | FRAME_PINNED | FRAME_DMA)))
+	{
+		return;
+	}
+
+	//La page est lue par sa frame, pas a son adresse : une page vieillie par l'horloge
+	//du swap ferait fauter le noyau, et les pages froides sont celles a partager.
+	merge_scanned_count++;
+	uint8_t* scanned = vmem_map_frame(frame);
+	uint32_t checksum = merge_checksum((const uint32_t*)scanned);
+	vmem_unmap_frame(scanned);
+	//Une page modifiee depuis son dernier examen est encore utilisee, on la laisse.
+	if ((frame_descriptor->flags & FRAME_CHECKSUM) == 0 || frame_descriptor->checksum != checksum)
+	{
+		frame_descriptor->checksum = checksum;
+		frame_descriptor->flags |= FRAME_CHECKSUM;
+		return;
+	}
+
+	MergeCandidate* candidate = &merge_candidates[(checksum ^ (checksum >> 16)) & (MERGE_TABLE_SIZE - 1)];
+	if (candidate->page_table == NULL || candidate->checksum != checksum || !merge_candidate_valid(candidate))
+	{
+		candidate->page_table = page_table;
+		candidate->page = page;
+		candidate->frame = frame;
+		candidate->checksum = checksum;
+		return;
+	}
+	//Les deux pages partagent deja la meme frame, ou elle ne peut plus etre projetee une fois de plus.
+	if (candidate->frame == frame || get_frame_occupancy_table(candidate->frame) >= UINT16_MAX)
+	{
+		return;
+	}
+
+	//Deux contenus differents peuvent avoir la meme somme : on compare les deux frames.
+	//Les interruptions sont masquees, aucun processus ne peut les modifier entre-temps.
+	uint8_t* kept = vmem_map_frame(candidate->frame);
+	scanned = vmem_map_frame(frame);
+	int same = merge_same_content((const uint32_t*)kept, (const uint32_t*)scanned);
+	vmem_unmap_frame(scanned);
+	vmem_unmap_frame(kept);
+	if (!same)
+	{
+		return;
+	}
+
+	//La page candidate garde sa frame, en lecture seule, et la page examinee la partage.
+	vmem_protect_page(candidate->page_table, candidate->page);
+	vmem_share_frame(page_table, page, candidate->frame);
+	get_frame_descriptor(candidate->frame)->flags |= FRAME_MERGED;
+	merge_merged_count++;
+}
+
+void merge_scan(uint32_t page_nb)
+{
+	uint32_t scanned = 0;
+
+	//Les frames libres ou du noyau sont sautees sans etre comptees.
+	for (uint32_t step = 0;step < FRAME_OCCUPANCY_TT_SIZE && scanned < page_nb;step++)
+	{
+		uint32_t frame = merge_hand;
+		merge_hand = frame + 1 < FRAME_OCCUPANCY_TT_SIZE ? frame + 1 : 0;
+		if (!merge_scannable(frame))
+		{
+			continue;
+		}
+		const FrameDescriptor* descriptor = get_frame_descriptor(frame);
+		merge_scan_page((uint32_t*)descriptor->owner, descriptor->owner_page);
+		scanned++;
+	}
+}
+
+void merge_forget(const uint32_t* page_table)
+{
+	for (uint32_t i = 0;i < MERGE_TABLE_SIZE;i++)
+	{
+		if (merge_candidates[i].page_table == page_table)
+		{
+			merge_candidates[i].page_table = NULL;
+		}
+	}
+}
+
+void merge_get_stats(MergeStats* stats)
+{
+	stats->scanned_pages = merge_scanned_count;
+	stats->merged_pages = merge_merged_count;
+	stats->merged_frames = 0;
+	stats->saved_pages = 0;
+	for (uint32_t frame = 0;frame < FRAME_OCCUPANCY_TT_SIZE;frame++)
+	{
+		const FrameDescriptor* descriptor = get_frame_descriptor(frame);
+		if ((descriptor->flags & FRAME_MERGED) && descriptor->refcount > 1)
+		{
+			stats->merged_frames++;
+			stats->saved_pages += descriptor->refcount - 1;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <inttypes.h>
+
+//Le nombre de cases de la table des pages candidates, une puissance de 2.
+#define MERGE_TABLE_SIZE 256
+
+//-----------------------------------------------------------------Types
+/**
+ * Une page stable, dont une page identique pourra partager la frame.
+ */
+struct MergeCandidate
+{
+	//La table des pages du processus, NULL si la case est vide.
+	uint32_t* page_table;
+	uint32_t page;
+	uint32_t frame;
+	uint32_t checksum;
+};
+typedef struct MergeCandidate MergeCandidate;
+
+/**
+ * Les compteurs du scanner.
+ */
+struct MergeStats
+{
+	//Les pages examinees, et les pages dont la frame a ete remplacee par une frame identique.
+	uint32_t scanned_pages;
+	uint32_t merged_pages;
+	//Les frames partagees par le scanner, et les frames economisees :
+	//les projections de ces frames en plus de la premiere.
+	uint32_t merged_frames;
+	uint32_t saved_pages;
+};
+typedef struct MergeStats MergeStats;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Examine les pages suivantes de tous les processus, en reprenant la ou le passage
+ * precedent s'est arrete. Comme l'horloge du swap, le scanner parcourt la table des frames
+ * et retrouve la page qui projette chaque frame par son proprietaire : les tables des pages
+ * n'ont pas a etre chargees. Une page dont le contenu n'a pas change depuis son dernier
+ * examen est stable : si une page stable identique est deja connue, les deux pages
+ * partagent une seule frame en lecture seule, et l'autre frame est liberee.
+ * Une ecriture sur la page la copie de nouveau (voir vmem_cow_fault).
+ * A appeler quand le processeur n'a rien d'autre a faire.
+ * @param page_nb Le nombre de pages a examiner, au plus un tour de la table des frames.
+ */
+void merge_scan(uint32_t page_nb);
+
+/**
+ * Oublie les pages candidates d'une table des pages, avant qu'elle ne soit liberee.
+ */
+void merge_forget(const uint32_t* page_table);
+
+/**
+ * Remplit les compteurs du scanner.
+ * Les frames partagees sont comptees en parcourant la table des frames.
+ */
+void merge_get_stats(MergeStats* stats);
+
+#endif
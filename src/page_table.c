@@ -2,11 +2,30 @@
 #include "kheap.h"
 #include "vmem.h"
 #include "config.h"
+#include "asm_tools.h"
+#include "buddy.h"
+#include "slab.h"
+#include "fb.h"
+#include "memory.h"
+#include "swap.h"
+#include "util.h"
+
+//Ordre d'une table de niveau 1 dans les pages du tas noyau : 4 pages, alignees sur 16ko.
+#define FIRST_LEVEL_TABLE_ORDER 2
+//Les tables de niveau 2 sont prises dans des slabs de 16ko, alignees sur leur taille.
+#define SECOND_LEVEL_TABLE_SLAB_ORDER 2
 
 //-----------------------------------------------------Variables privees
-uint32_t frame_occupancy_table_size;
-uint32_t frame_occupancy_table_last_free_frame;
-uint8_t* frame_occupancy_table;
+//Les descripteurs des frames de la ram.
+uint32_t frame_table_size;
+FrameDescriptor* frame_table;
+
+//Les frames de la ram au-dessus du tas noyau, donnees aux processus.
+BuddyZone frame_zone;
+//Les tables de niveau 2.
+SlabCache second_level_table_cache = SLAB_CACHE(SECOND_LVL_TT_SIZE, SECOND_LVL_TT_SIZE, SECOND_LEVEL_TABLE_SLAB_ORDER);
+//Le nombre de tables de niveau 1 allouees.
+uint32_t first_level_table_count;
 
 //-----------------------------------------------------Fonctions privees
 /**
@@ -25,20 +44,46 @@ int is_free_page_table(const uint32_t* page_table, uint32_t first_level_index, u
 
 /**
  * Crée une table de niveau 2 vide.
+ * @return La table, NULL si le cache des tables de niveau 2 est épuisé.
  */
 uint32_t* create_second_level_page_table();
 
 /**
- * Libère une table de niveau 2.
+ * Retourne la table de niveau 2 d'un index de niveau 1, en la créant si besoin.
+ * @return La table, NULL si elle n'existait pas et n'a pas pu être créée.
  */
-void free_second_level_page_table(uint32_t* second_level_table);
+uint32_t* second_level_page_table_or_create(uint32_t* page_table, uint32_t first_level_index);
 
 /**
- * Change l'état d'une frame.
- * @param frame Le numéro de la frame.
- * @param state L'état de la frame. 1 Si la frame est occupée, 0 sinon.
+ * Libère une table de niveau 2 de l'espace utilisateur.
+ * @param page_table La table de niveau 1 qui pointe sur la table de niveau 2.
  */
-void set_frame_occupancy_table(uint32_t frame, uint32_t state);
+void free_second_level_page_table(const uint32_t* page_table, uint32_t* second_level_table);
+
+/**
+ * Retire la projection d'une frame par une table des pages, qui n'en est plus le propriétaire.
+ * Si c'était la dernière projection, la frame est rendue a l'allocateur.
+ */
+void release_frame_page_table(const uint32_t* page_table, uint32_t frame);
+
+/**
+ * Convertit les flags d'une page de 4ko en flags d'une section de 1Mo.
+ * Les bits B et C ne bougent pas, AP, TEX, APX, S et nG sont decales de 6 bits, XN passe du bit 0 au bit 4.
+ */
+uint32_t section_flags(uint32_t frame_flags);
+
+/**
+ * Convertit les flags d'une page de 4ko en flags d'une grande page de 64ko.
+ * B, C, AP, APX, S et nG ne bougent pas, TEX est decale de 6 bits, XN passe du bit 0 au bit 15.
+ */
+uint32_t large_page_flags(uint32_t frame_flags);
+
+/**
+ * Retourne la frame projetée par une entrée de niveau 2, page de 4ko ou grande page.
+ * @param descriptor Le descripteur de l'entrée.
+ * @param second_level_index L'index de l'entrée, qui donne sa place dans une grande page.
+ */
+uint32_t descriptor_frame(uint32_t descriptor, uint32_t second_level_index);
 
 
 uint32_t* second_level_page_table(const uint32_t* page_table, uint32_t first_level_index)
@@ -57,8 +102,8 @@ uint32_t* second_level_page_table(const uint32_t* page_table, uint32_t first_lev
     first_level_descriptor_address = (uint32_t*) (table_base | (first_level_index << 2));
     first_level_descriptor = *(first_level_descriptor_address);
     
-    /*Translation fault*/
-    if(! (first_level_descriptor & 0x3)) {
+    /*Translation fault, or a section without second level table*/
+    if((first_level_descriptor & FIRST_LEVEL_TYPE_MASK) != FIRST_LEVEL_FLAGS) {
         return (uint32_t*)FORBIDDEN_ADDRESS;
     }
     
@@ -69,6 +114,11 @@ uint32_t* second_level_page_table(const uint32_t* page_table, uint32_t first_lev
 
 int is_free_page_table(const uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index)
 {
+    //Toutes les pages d'une section sont occupées.
+    if ((page_table[first_level_index] & FIRST_LEVEL_TYPE_MASK) == FIRST_LEVEL_SECTION)
+    {
+        return 0;
+    }
     uint32_t* second_level_table = second_level_page_table(page_table, first_level_index);
     if (second_level_table != FORBIDDEN_ADDRESS)
     {
@@ -85,142 +135,284 @@ int is_free_page_table(const uint32_t* page_table, uint32_t first_level_index, u
 uint32_t* create_second_level_page_table()
 {
 	//On alloue une table de niveau 2.
-	uint32_t* table_niveau2 = (uint32_t*)kAlloc_aligned(SECOND_LVL_TT_SIZE, SECOND_LVL_INDEX_SIZE + 2);
-	
-	//On initialise les entrées de cette table a 0.
-	for (int i = 0;i < SECOND_LVL_TT_COUNT;i++)
+	uint32_t* table_niveau2 = (uint32_t*)slab_alloc(&second_level_table_cache);
+	if (table_niveau2 == FORBIDDEN_ADDRESS)
 	{
-		table_niveau2[i] = 0;
+		return NULL;
 	}
 	
+	//On initialise les entrées de cette table a 0.
+	memset(table_niveau2, 0, SECOND_LVL_TT_SIZE);
+	//La MMU lit les tables en memoire, sans passer par le cache de donnees.
+	clean_data_cache_range(table_niveau2, SECOND_LVL_TT_SIZE);
+	
 	return table_niveau2;
 }
 
-void free_second_level_page_table(uint32_t* second_level_table)
+void free_second_level_page_table(const uint32_t* page_table, uint32_t* second_level_table)
 {
     //Pour chaque frame de la table de niveau 2.
     for (uint32_t second_level_index = 0;second_level_index < SECOND_LVL_TT_COUNT;second_level_index++)
     {
-        uint32_t frame = (second_level_table[second_level_index] & 0xFFFFF000) / PAGE_SIZE;
-        second_level_table[second_level_index] = 0;
+        uint32_t descriptor = second_level_table[second_level_index];
+        //Une entrée vide ou réservée ne tient aucune frame, une page évincée tient un emplacement du swap.
+        //Les entrées ne sont pas remises a 0 : create_second_level_page_table le fait.
+        if (IS_SWAPPED_DESCRIPTOR(descriptor))
+        {
+            swap_free_slot(SWAPPED_DESCRIPTOR_SLOT(descriptor));
+        }
+        if (!IS_MAPPED_DESCRIPTOR(descriptor))
+        {
+            continue;
+        }
         //On précise que la frame n'est plus occupée par cette table.
-        set_frame_occupancy_table(frame, 0);
+        release_frame_page_table(page_table, descriptor_frame(descriptor, second_level_index));
     }
     //On libère la mémoire.
-    kFree((void*)second_level_table, SECOND_LVL_TT_SIZE);
+    slab_free(&second_level_table_cache, second_level_table);
+}
+
+void release_frame_page_table(const uint32_t* page_table, uint32_t frame)
+{
+    //Les autres tables qui projettent la frame ne sont pas connues : elle n'a plus de propriétaire.
+    FrameDescriptor* descriptor = get_frame_descriptor(frame);
+    if (descriptor != NULL && descriptor->owner == page_table)
+    {
+        descriptor->owner = NULL;
+    }
+    set_frame_occupancy_table(frame, 0);
+}
+
+uint32_t section_flags(uint32_t frame_flags)
+{
+    return FIRST_LEVEL_SECTION | (frame_flags & 0xC) | ((frame_flags & 0xFF0) << 6) | ((frame_flags & 0x1) << 4);
+}
+
+uint32_t large_page_flags(uint32_t frame_flags)
+{
+    return 0x1 | (frame_flags & 0xE3C) | ((frame_flags & 0x1C0) << 6) | ((frame_flags & 0x1) << 15);
+}
+
+uint32_t descriptor_frame(uint32_t descriptor, uint32_t second_level_index)
+{
+    if (IS_LARGE_PAGE_DESCRIPTOR(descriptor))
+    {
+        return (descriptor & 0xFFFF0000) / PAGE_SIZE + second_level_index % LARGE_PAGE_ENTRY_NB;
+    }
+    return (descriptor & 0xFFFFF000) / PAGE_SIZE;
 }
 
 void set_frame_occupancy_table(uint32_t frame, uint32_t state)
 {
+    //Les frames du noyau et des devices ne sont pas comptees.
+    if (frame >= frame_table_size || (frame_table[frame].flags & FRAME_KERNEL))
+    {
+        return;
+    }
+    FrameDescriptor* descriptor = &frame_table[frame];
     if (state > 0) {
-        frame_occupancy_table[frame] += 1;
-    } else {
-        frame_occupancy_table[frame] -= 1;
+        //Le compteur reviendrait a 0 : la frame serait rendue alors qu'elle est projetee.
+        if (descriptor->refcount == UINT16_MAX)
+        {
+            PANIC();
+        }
+        descriptor->refcount += 1;
+    } else if (descriptor->refcount > 0) {
+        descriptor->refcount -= 1;
+        //La derniere projection d'une frame allouee est supprimee : on la rend a l'allocateur.
+        if (descriptor->refcount == 0 && buddy_contains(&frame_zone, frame))
+        {
+            descriptor->flags = 0;
+            descriptor->owner = NULL;
+            buddy_free(&frame_zone, frame, 0);
+        }
     }
 }
 
 //----------------------------------------------------------Realisations
 void init_frame_occupancy_table(uint32_t size)
 {
-    frame_occupancy_table_size = size;
-	//On alloue la table d'occupation des pages.
-	frame_occupancy_table = kAlloc(frame_occupancy_table_size);
+    frame_table_size = size;
+	//On alloue la table des frames.
+	frame_table = (FrameDescriptor*)kAlloc(frame_table_size * sizeof(FrameDescriptor));
+
+    //Les frames au-dessus du tas noyau sont libres, sauf celles du framebuffer.
+    const uint32_t FIRST_FREE_FRAME = (uint32_t)&__after_kernel_heap__ / PAGE_SIZE;
+    const uint32_t LAST_FREE_FRAME = (RAM_LIMIT + 1) / PAGE_SIZE;
+    uint32_t framebuffer_first_frame = getAddressFB() / PAGE_SIZE;
+    uint32_t framebuffer_last_frame = (getAddressFB() + getSizeFB()) / PAGE_SIZE + 1;
+    if (framebuffer_first_frame < FIRST_FREE_FRAME)
+    {
+        framebuffer_first_frame = FIRST_FREE_FRAME;
+    }
+    if (framebuffer_last_frame < framebuffer_first_frame)
+    {
+        framebuffer_last_frame = framebuffer_first_frame;
+    }
 
-    frame_occupancy_table[frame_occupancy_table_size - 1] = 0;
-    //On initialise toutes les pages comme occupees.
-	for (int i = 0;i < frame_occupancy_table_size;i++)
+    //Les autres frames sont projetees a l'identique par la table du noyau.
+	for (uint32_t frame = 0;frame < frame_table_size;frame++)
 	{
-		frame_occupancy_table[i] = 0;
+		int free = (frame >= FIRST_FREE_FRAME && frame < framebuffer_first_frame)
+			|| (frame >= framebuffer_last_frame && frame < LAST_FREE_FRAME);
+		frame_table[frame].refcount = 0;
+		frame_table[frame].flags = free ? 0 : FRAME_KERNEL;
+		frame_table[frame].owner = NULL;
+		frame_table[frame].owner_page = 0;
+		frame_table[frame].checksum = 0;
 	}
-    //On initialise la derniere frame libre.
-    frame_occupancy_table_last_free_frame = 0;
+
+    buddy_init(&frame_zone, FIRST_FREE_FRAME, LAST_FREE_FRAME - FIRST_FREE_FRAME);
+    buddy_add_range(&frame_zone, FIRST_FREE_FRAME, framebuffer_first_frame);
+    buddy_add_range(&frame_zone, framebuffer_last_frame, LAST_FREE_FRAME);
 }
 
 void free_frame_occupancy_table()
 {
-	kFree(frame_occupancy_table, frame_occupancy_table_size);
+	kFree((uint8_t*)frame_table, frame_table_size * sizeof(FrameDescriptor));
 }
 
 uint32_t get_frame_occupancy_table(uint32_t frame)
 {
-    return frame_occupancy_table[frame];
+    if (frame >= frame_table_size)
+    {
+        return 0;
+    }
+    return frame_table[frame].refcount;
+}
+
+FrameDescriptor* get_frame_descriptor(uint32_t frame)
+{
+    if (frame >= frame_table_size)
+    {
+        return NULL;
+    }
+    return &frame_table[frame];
 }
 
 uint32_t find_free_frame_occupancy_table()
 {
-    //A partir de la dernière frame libre, on trouve une frame libre.
-    uint32_t frame = frame_occupancy_table_last_free_frame + 1;
-    //Tant que la frame considerée n'est pas libre et que l'on n'a pas testé toutes les frames de la table.
-    while (frame_occupancy_table[frame] > 0 && frame != frame_occupancy_table_last_free_frame)
+    return find_free_frames_occupancy_table(0);
+}
+
+uint32_t find_free_frames_occupancy_table(uint32_t order)
+{
+    uint32_t frame = buddy_alloc(&frame_zone, order);
+    if (frame == BUDDY_NONE)
+    {
+        //Aucun bloc n'est assez grand, on retourne UINT32_MAX.
+        return UINT32_MAX;
+    }
+    //Un bloc de plusieurs frames sert de tampon physiquement contigu : il ne doit pas bouger.
+    if (order > 0)
     {
-        //On teste la frame suivante.
-        frame += 1;
-        //Si on dépasse la taille de la table d'ocupation, on revient au début.
-        if (frame >= frame_occupancy_table_size)
+        for (uint32_t block_frame = frame;block_frame < frame + (1 << order);block_frame++)
         {
-            frame = 0;
+            frame_table[block_frame].flags |= FRAME_DMA | FRAME_PINNED;
         }
     }
+    return frame;
+}
 
-    //On vérifie que la table n'est pas pleine.
-    if (frame_occupancy_table[frame] == 0 && frame != frame_occupancy_table_last_free_frame)
-    {
-        frame_occupancy_table_last_free_frame = frame;
-    }
-    else
+void release_frames_occupancy_table(uint32_t frame, uint32_t order)
+{
+    for (uint32_t block_frame = frame;block_frame < frame + (1 << order);block_frame++)
     {
-        //Si la table est pleine, aucune frame n'est libre. On retourne UINT32_MAX.
-        frame = UINT32_MAX;
+        frame_table[block_frame].flags = 0;
+        frame_table[block_frame].owner = NULL;
     }
+    buddy_free(&frame_zone, frame, order);
+}
 
-    return frame;
+uint32_t get_free_frame_count_occupancy_table()
+{
+    return buddy_free_frame_count(&frame_zone);
 }
 
 void free_page_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index)
 {
+    //Une section est supprimée en entier de la table de niveau 1.
+    if ((page_table[first_level_index] & FIRST_LEVEL_TYPE_MASK) == FIRST_LEVEL_SECTION)
+    {
+        uint32_t first_frame = (page_table[first_level_index] & 0xFFF00000) / PAGE_SIZE;
+        page_table[first_level_index] = 0;
+        clean_data_cache_range(&page_table[first_level_index], sizeof(uint32_t));
+        for (uint32_t frame = first_frame;frame < first_frame + SECOND_LVL_TT_COUNT;frame++)
+        {
+            set_frame_occupancy_table(frame, 0);
+        }
+        return;
+    }
+
     uint32_t* second_level_table = second_level_page_table(page_table, first_level_index);
     if (second_level_table != FORBIDDEN_ADDRESS)
     {
         //On explore la table de niveau 2 a la recherche de la page.
-        if (second_level_table[second_level_index] != 0)
+        uint32_t descriptor = second_level_table[second_level_index];
+        //Une grande page est supprimée de ses 16 entrées.
+        uint32_t first_index = second_level_index;
+        uint32_t entry_nb = 1;
+        if (IS_LARGE_PAGE_DESCRIPTOR(descriptor))
         {
-            //On supprime l'entrée dans la table de niveau 2.
-            uint32_t frame = (second_level_table[second_level_index] & 0xFFFFF000) / PAGE_SIZE;
-            second_level_table[second_level_index] = 0;
-            //On précise que la frame n'est plus occupée par cette table.
-            set_frame_occupancy_table(frame, 0);
+            first_index = second_level_index - second_level_index % LARGE_PAGE_ENTRY_NB;
+            entry_nb = LARGE_PAGE_ENTRY_NB;
+        }
+        if (descriptor != 0)
+        {
+            for (uint32_t index = first_index;index < first_index + entry_nb;index++)
+            {
+                //On supprime l'entrée dans la table de niveau 2.
+                second_level_table[index] = 0;
+                //On précise que la frame n'est plus occupée par cette table.
+                //Une page réservée n'avait pas encore de frame.
+                if (IS_MAPPED_DESCRIPTOR(descriptor))
+                {
+                    release_frame_page_table(page_table, descriptor_frame(descriptor, index));
+                }
+                else if (IS_SWAPPED_DESCRIPTOR(descriptor))
+                {
+                    swap_free_slot(SWAPPED_DESCRIPTOR_SLOT(descriptor));
+                }
+            }
+            clean_data_cache_range(&second_level_table[first_index], entry_nb * sizeof(uint32_t));
         }
     }
 }
 
 uint32_t* create_page_table()
 {
-	//On alloue la table de niveau 1.
-	uint32_t* table_niveau1 = (uint32_t*)kAlloc_aligned(FIRST_LVL_TT_SIZE, FIRST_LVL_INDEX_SIZE + 2);
-	//On invalide toutes les entrees de la table de niveau 1.
-	for (int i = 0;i < FIRST_LVL_TT_COUNT;i++)
+	//On alloue la table de niveau 1 dans les pages du tas noyau, qui sont projetees
+	//a l'identique et alignees sur leur taille.
+	uint32_t* table_niveau1 = (uint32_t*)kAlloc_pages(FIRST_LEVEL_TABLE_ORDER);
+	if (table_niveau1 == FORBIDDEN_ADDRESS)
 	{
-		table_niveau1[i] = 0;
+		return FORBIDDEN_ADDRESS;
 	}
+	first_level_table_count++;
+	//On invalide toutes les entrees de la table de niveau 1.
+	memset(table_niveau1, 0, FIRST_LVL_TT_SIZE);
+	clean_data_cache_range(table_niveau1, FIRST_LVL_TT_SIZE);
 	return table_niveau1;
 }
 
 void free_page_table(uint32_t* page_table)
 {
-    //On libère les pages de niveau 2.
-    for (uint32_t first_level_index = 0;first_level_index < FIRST_LVL_TT_COUNT;first_level_index++)
+    //On libère les pages de niveau 2 de l'espace utilisateur.
+    //Celles du noyau ne sont que dans sa table, projetee par TTBR0, qui n'est jamais liberee.
+    for (uint32_t first_level_index = USER_FIRST_LVL_INDEX;first_level_index < FIRST_LVL_TT_COUNT;first_level_index++)
     {
         uint32_t* second_level_table = second_level_page_table(page_table, first_level_index);
         if (second_level_table != FORBIDDEN_ADDRESS)
         {
-            free_second_level_page_table(second_level_table);
+            free_second_level_page_table(page_table, second_level_table);
         }
     }
 
-	kFree((void*)(page_table), FIRST_LVL_TT_SIZE);
+    kFree_pages((void*)(page_table), FIRST_LEVEL_TABLE_ORDER);
+    first_level_table_count--;
 }
 
-void add_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t frame_address, uint32_t frame_flags)
+uint32_t* second_level_page_table_or_create(uint32_t* page_table, uint32_t first_level_index)
 {
 	uint32_t* second_level_table;
 	//On vérifie si la table de niveau 2 correspondante est allouée.
@@ -229,13 +421,141 @@ void add_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint
 	{
 		//On alloue une table de niveau 2.
 		second_level_table = create_second_level_page_table();
+		if (second_level_table == NULL)
+		{
+			return NULL;
+		}
 		//On fait le lien entre la table de niveau 1 et cette table de niveau 1.
-		page_table[first_level_index] = (uint32_t)second_level_table | FIRST_LEVEL_FLAGS;
+		if (first_level_index >= USER_FIRST_LVL_INDEX)
+		{
+			page_table[first_level_index] = (uint32_t)second_level_table | FIRST_LEVEL_USER_FLAGS;
+		}
+		else
+		{
+			page_table[first_level_index] = (uint32_t)second_level_table | FIRST_LEVEL_FLAGS;
+		}
+		clean_data_cache_range(&page_table[first_level_index], sizeof(uint32_t));
+	}
+	return second_level_table;
+}
+
+int add_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t frame_address, uint32_t frame_flags)
+{
+	//Le compteur de projections de la frame est plein : on refuse la projection.
+	if (get_frame_occupancy_table(frame_address / PAGE_SIZE) >= UINT16_MAX)
+	{
+		return 0;
+	}
+	uint32_t* second_level_table = second_level_page_table_or_create(page_table, first_level_index);
+	if (second_level_table == NULL)
+	{
+		return 0;
 	}
 	//On ajoute l'entrée à la table de niveau 2.
 	second_level_table[second_level_index] = frame_address | frame_flags;
+	clean_data_cache_range(&second_level_table[second_level_index], sizeof(uint32_t));
 	//On note la frame comme occupée.
     set_frame_occupancy_table(frame_address / PAGE_SIZE, 1);
+    FrameDescriptor* descriptor = get_frame_descriptor(frame_address / PAGE_SIZE);
+    if (descriptor != NULL && !(descriptor->flags & FRAME_KERNEL))
+    {
+        //La premiere table qui projette la frame en est le proprietaire.
+        if (descriptor->owner == NULL)
+        {
+            descriptor->owner = page_table;
+            descriptor->owner_page = first_level_index * SECOND_LVL_TT_COUNT + second_level_index;
+        }
+        //Une frame projetée peut être modifiée.
+        descriptor->flags &= ~FRAME_ZEROED;
+    }
+    return 1;
+}
+
+void add_range_page_table(uint32_t* page_table, uint32_t address, uint32_t frame_address, uint32_t size, uint32_t frame_flags)
+{
+	uint32_t end = address + size;
+	while (address < end)
+	{
+		uint32_t first_level_index = address / SECTION_SIZE;
+		uint32_t second_level_index = (address % SECTION_SIZE) / PAGE_SIZE;
+		uint32_t step;
+
+		if (address % SECTION_SIZE == 0 && frame_address % SECTION_SIZE == 0 && end - address >= SECTION_SIZE)
+		{
+			//Une section, directement dans la table de niveau 1.
+			page_table[first_level_index] = frame_address | section_flags(frame_flags);
+			clean_data_cache_range(&page_table[first_level_index], sizeof(uint32_t));
+			step = SECTION_SIZE;
+		}
+		else if (address % LARGE_PAGE_SIZE == 0 && frame_address % LARGE_PAGE_SIZE == 0 && end - address >= LARGE_PAGE_SIZE)
+		{
+			//Une grande page, répétée dans 16 entrées de la table de niveau 2.
+			uint32_t* second_level_table = second_level_page_table_or_create(page_table, first_level_index);
+			//La table du noyau est construite au démarrage : sans elle, le noyau ne peut pas continuer.
+			if (second_level_table == NULL)
+			{
+				PANIC();
+			}
+			for (uint32_t index = second_level_index;index < second_level_index + LARGE_PAGE_ENTRY_NB;index++)
+			{
+				second_level_table[index] = frame_address | large_page_flags(frame_flags);
+			}
+			clean_data_cache_range(&second_level_table[second_level_index], LARGE_PAGE_ENTRY_NB * sizeof(uint32_t));
+			step = LARGE_PAGE_SIZE;
+		}
+		else
+		{
+			//Une page de 4ko, qui note elle-même sa frame.
+			if (!add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, frame_flags))
+			{
+				PANIC();
+			}
+			address += PAGE_SIZE;
+			frame_address += PAGE_SIZE;
+			continue;
+		}
+		//On note les frames de la section ou de la grande page comme occupées.
+		for (uint32_t frame = frame_address / PAGE_SIZE;frame < (frame_address + step) / PAGE_SIZE;frame++)
+		{
+			set_frame_occupancy_table(frame, 1);
+		}
+		address += step;
+		frame_address += step;
+	}
+}
+
+int reserve_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t frame_flags)
+{
+	uint32_t* second_level_table = second_level_page_table_or_create(page_table, first_level_index);
+	if (second_level_table == NULL)
+	{
+		return 0;
+	}
+	//Les deux bits de poids faible a 0 provoquent une erreur de traduction,
+	//le reste des flags sert a projeter la page plus tard.
+	second_level_table[second_level_index] = frame_flags & ~0x3;
+	clean_data_cache_range(&second_level_table[second_level_index], sizeof(uint32_t));
+	return 1;
+}
+
+uint32_t get_entry_page_table(const uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index)
+{
+    uint32_t* second_level_table = second_level_page_table(page_table, first_level_index);
+    if (second_level_table == FORBIDDEN_ADDRESS)
+    {
+        return 0;
+    }
+    return second_level_table[second_level_index];
+}
+
+void set_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t descriptor)
+{
+    uint32_t* second_level_table = second_level_page_table(page_table, first_level_index);
+    if (second_level_table != FORBIDDEN_ADDRESS)
+    {
+        second_level_table[second_level_index] = descriptor;
+        clean_data_cache_range(&second_level_table[second_level_index], sizeof(uint32_t));
+    }
 }
 
 uint32_t find_free_pages_page_table(const uint32_t* page_table, uint32_t page_nb, uint32_t start_page, int direction)
@@ -309,7 +629,15 @@ uint32_t vmem_translate(uint32_t va, uint32_t* page_table)
     
     if(page_table == NULL)
     {
-        __asm("mrc p15,0,%[tb],c2,c0,0": [tb] "=r"(table_base));
+        //Le noyau est traduit par TTBR0, l'espace utilisateur par TTBR1.
+        if (va < USER_SPACE_START)
+        {
+            __asm("mrc p15,0,%[tb],c2,c0,0": [tb] "=r"(table_base));
+        }
+        else
+        {
+            __asm("mrc p15,0,%[tb],c2,c0,1": [tb] "=r"(table_base));
+        }
     }
     else
     {
@@ -332,6 +660,11 @@ uint32_t vmem_translate(uint32_t va, uint32_t* page_table)
         return(uint32_t) FORBIDDEN_ADDRESS;
     }
     
+    /*Section*/
+    if((first_level_descriptor & FIRST_LEVEL_TYPE_MASK) == FIRST_LEVEL_SECTION) {
+        return (first_level_descriptor & 0xFFF00000) | (va & 0x000FFFFF);
+    }
+    
     /*Second level descriptor*/
     second_level_table = first_level_descriptor & 0xFFFFFC00;
     second_level_descriptor_address = (uint32_t*) (second_level_table | (second_level_index << 2));
@@ -342,7 +675,11 @@ uint32_t vmem_translate(uint32_t va, uint32_t* page_table)
         return (uint32_t) FORBIDDEN_ADDRESS;
     }
     
-    /*Physical address*/
-    pa = (second_level_descriptor & 0xFFFFF000) | page_index;
+    /*Physical address, large page or small page*/
+    if(IS_LARGE_PAGE_DESCRIPTOR(second_level_descriptor)) {
+        pa = (second_level_descriptor & 0xFFFF0000) | (va & 0x0000FFFF);
+    } else {
+        pa = (second_level_descriptor & 0xFFFFF000) | page_index;
+    }
     return pa;
 }
\ No newline at end of file
@@ -4,37 +4,141 @@
 #include <inttypes.h>
 
 #define FIRST_LEVEL_FLAGS 0x1
+//Les tables de niveau 2 de l'espace utilisateur sont dans le domaine USER_DOMAIN,
+//dont les droits d'acces sont verifies par la MMU.
+#define USER_DOMAIN 1
+#define FIRST_LEVEL_USER_FLAGS (FIRST_LEVEL_FLAGS | (USER_DOMAIN << 5))
+
+//Une page est projetée sur une frame si les deux bits de poids faible de son descripteur ne sont pas nuls.
+//Une entrée non nulle dont ces deux bits sont nuls est une page réservée : elle n'a pas
+//encore de frame, la MMU lève une erreur de traduction au premier accès.
+#define IS_MAPPED_DESCRIPTOR(descriptor) (((descriptor) & 0x3) != 0)
+#define IS_RESERVED_DESCRIPTOR(descriptor) ((descriptor) != 0 && ((descriptor) & 0xFFFFF003) == 0)
+//Une page évincée dans le swap (swap.c) n'a plus de frame : son entrée garde ses flags,
+//et le numéro de son emplacement dans le swap, plus 1, à la place de l'adresse de la frame.
+#define SWAPPED_DESCRIPTOR(slot, flags) ((((slot) + 1) << 12) | ((flags) & 0xFFC))
+#define IS_SWAPPED_DESCRIPTOR(descriptor) (!IS_MAPPED_DESCRIPTOR(descriptor) && ((descriptor) & 0xFFFFF000) != 0)
+#define SWAPPED_DESCRIPTOR_SLOT(descriptor) (((descriptor) >> 12) - 1)
+
+//Une entrée de niveau 1 pointe sur une table de niveau 2 (01) ou projette une section de 1Mo (10).
+#define FIRST_LEVEL_TYPE_MASK 0x3
+#define FIRST_LEVEL_SECTION 0x2
+#define SECTION_SIZE 0x100000
+//Une grande page de 64ko (01) est répétée dans 16 entrées consécutives d'une table de niveau 2.
+#define LARGE_PAGE_SIZE 0x10000
+#define LARGE_PAGE_ENTRY_NB 16
+#define IS_LARGE_PAGE_DESCRIPTOR(descriptor) (((descriptor) & 0x3) == 0x1)
+
+//Flags d'une frame.
+//Projetée a l'identique par la table du noyau : noyau, tas noyau ou framebuffer.
+//Ses projections ne sont pas comptées.
+#define FRAME_KERNEL 0x1
+//Ne doit être ni déplacée ni évincée.
+#define FRAME_PINNED 0x2
+//Remplie de 0 et projetée nulle part.
+#define FRAME_ZEROED 0x4
+//Partagée en copie sur écriture par fork.
+#define FRAME_COW 0x8
+//Dans un bloc de frames consécutives, pour un tampon DMA.
+#define FRAME_DMA 0x10
+//Le champ checksum est la somme du contenu au dernier passage du scanner de merge.c.
+#define FRAME_CHECKSUM 0x20
+//Partagée en copie sur écriture par le scanner de merge.c, entre des pages identiques.
+#define FRAME_MERGED 0x40
+
+//-----------------------------------------------------------------Types
+/**
+ * Le descripteur d'une frame de la ram.
+ * Les flags sont remis a 0 quand la frame est rendue a l'allocateur.
+ */
+struct FrameDescriptor
+{
+	//Le nombre de projections de la frame dans les tables des pages.
+	uint16_t refcount;
+	uint16_t flags;
+	//La table des pages qui l'a projetée la première, une indication pour retrouver son propriétaire.
+	//Elle est oubliée quand cette table retire sa projection.
+	const uint32_t* owner;
+	//La page qui projette la frame dans la table owner.
+	uint32_t owner_page;
+	//Valide si FRAME_CHECKSUM est mis.
+	uint32_t checksum;
+};
+typedef struct FrameDescriptor FrameDescriptor;
 
 /**
- * Initialise la table d'occupation des frames.
- * @param size Le nombre de frame gérées par la table d'occupation. 
+ * Initialise la table des frames et les allocateurs buddy :
+ * les frames au-dessus du tas noyau, hors framebuffer, sont libres.
+ * Les autres sont marquées FRAME_KERNEL.
+ * @param size Le nombre de frames de la ram, décrites par la table.
  */
 void init_frame_occupancy_table(uint32_t size);
 
 /**
- * Libère la table d'occupation des frames.
+ * Libère la table des frames.
  */
 void free_frame_occupancy_table();
 
 /**
- * Retourne l'état d'une frame.
+ * Retourne le nombre de projections d'une frame.
+ * Une frame du noyau ou hors de la ram n'est pas comptée : 0 est retourné.
  * @param frame Le numéro de la frame.
  */
 uint32_t get_frame_occupancy_table(uint32_t frame);
 
+/**
+ * Ajoute ou retire une projection d'une frame.
+ * Quand sa derniere projection est retiree, la frame est rendue a l'allocateur.
+ * Une frame deja projetee UINT16_MAX fois ne peut pas l'etre une fois de plus (voir add_entry_page_table) :
+ * le noyau s'arrete plutot que de perdre le compte.
+ * @param frame Le numéro de la frame.
+ * @param state 1 pour ajouter une projection, 0 pour en retirer une.
+ */
+void set_frame_occupancy_table(uint32_t frame, uint32_t state);
+
+/**
+ * Retourne le descripteur d'une frame, NULL si elle est hors de la ram.
+ * @param frame Le numéro de la frame.
+ */
+FrameDescriptor* get_frame_descriptor(uint32_t frame);
+
 /**
  * Retourne le numero d'une frame libre.
  * Si aucune frame n'est libre, retourne UINT32_MAX.
+ * La frame est rendue a l'allocateur quand sa derniere projection est supprimée.
  */
 uint32_t find_free_frame_occupancy_table();
 
+/**
+ * Alloue 2^order frames physiquement consecutives, pour un tampon DMA par exemple.
+ * Si aucun bloc n'est assez grand, retourne UINT32_MAX.
+ * Quand order n'est pas nul, les frames sont marquées FRAME_DMA et FRAME_PINNED.
+ * @param order L'ordre du bloc.
+ * @return La premiere frame du bloc, alignee sur 2^order frames.
+ */
+uint32_t find_free_frames_occupancy_table(uint32_t order);
+
+/**
+ * Rend a l'allocateur un bloc de frames qui n'est projeté dans aucune table.
+ * @param frame La premiere frame du bloc.
+ * @param order L'ordre du bloc.
+ */
+void release_frames_occupancy_table(uint32_t frame, uint32_t order);
+
+/**
+ * Retourne le nombre de frames libres.
+ */
+uint32_t get_free_frame_count_occupancy_table();
+
 /**
  * Crée une table de page vide.
+ * @return La table, ou FORBIDDEN_ADDRESS si le tas noyau est plein.
  */
 uint32_t* create_page_table();
 
 /**
- * Libère une table de page.
+ * Libère la table des pages d'un processus et ses tables de niveau 2,
+ * qui ne couvrent que l'espace utilisateur.
  */
 void free_page_table(uint32_t* page_table);
 
@@ -45,8 +149,56 @@ void free_page_table(uint32_t* page_table);
  * @param second_index L'index de niveau 2 de la page dans la table des pages.
  * @param frame_address L'adresse de debut de la frame.
  * @param frame_flags Les flags à appliquer à la frame.
+ * @return 1 si l'entrée a été ajoutée, 0 si la table de niveau 2 n'a pas pu être créée
+ * ou si la frame est déjà projetée UINT16_MAX fois.
+ * Une nouvelle frame dont la table de niveau 2 existe déjà est toujours ajoutée.
+ */
+int add_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t frame_address, uint32_t frame_flags);
+
+/**
+ * Projette une plage d'adresses sur des frames consécutives, avec les plus grands descripteurs possibles :
+ * une section quand l'adresse, la frame et la taille restante le permettent (alignées sur 1Mo),
+ * sinon une grande page de 64ko dans les mêmes conditions, sinon des pages de 4ko.
+ * Chaque frame de la plage est notée occupée, comme avec add_entry_page_table.
+ * @param page_table La table des pages dans laquelle ajouter la plage.
+ * @param address L'adresse virtuelle de début de la plage, alignée sur une page.
+ * @param frame_address L'adresse de la première frame.
+ * @param size La taille de la plage, multiple de la taille d'une page.
+ * @param frame_flags Les flags d'une page de 4ko, convertis pour les sections et les grandes pages.
+ */
+void add_range_page_table(uint32_t* page_table, uint32_t address, uint32_t frame_address, uint32_t size, uint32_t frame_flags);
+
+/**
+ * Réserve une page dans une table des pages, sans lui donner de frame.
+ * Les flags sont gardés dans l'entrée pour projeter la page lors du premier accès.
+ * Une page évincée dans le swap est écrite de la même façon, avec SWAPPED_DESCRIPTOR.
+ * @param page_table La table des pages dans laquelle réserver la page.
+ * @param first_index L'index de niveau 1 de la page dans la table des pages.
+ * @param second_index L'index de niveau 2 de la page dans la table des pages.
+ * @param frame_flags Les flags à appliquer à la frame quand elle sera allouée.
+ * @return 1 si la page a été réservée, 0 si la table de niveau 2 n'a pas pu être créée.
+ * Une entrée dont la table de niveau 2 existe déjà est toujours réservée.
+ */
+int reserve_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t frame_flags);
+
+/**
+ * Retourne le descripteur d'une page, 0 si la page n'est ni projetée ni réservée.
+ * Une page d'une section n'a pas de descripteur de niveau 2 : 0 est aussi retourné.
+ * @param page_table La table des pages dans laquelle lire l'entrée.
+ * @param first_index L'index de niveau 1 de la page dans la table des pages.
+ * @param second_index L'index de niveau 2 de la page dans la table des pages.
+ */
+uint32_t get_entry_page_table(const uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index);
+
+/**
+ * Remplace le descripteur d'une page déjà projetée, sans changer l'occupation des frames.
+ * La TLB doit être invalidée par l'appelant.
+ * @param page_table La table des pages dans laquelle modifier l'entrée.
+ * @param first_index L'index de niveau 1 de la page dans la table des pages.
+ * @param second_index L'index de niveau 2 de la page dans la table des pages.
+ * @param descriptor Le nouveau descripteur, adresse de la frame et flags.
  */
-void add_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t frame_address, uint32_t frame_flags);
+void set_entry_page_table(uint32_t* page_table, uint32_t first_level_index, uint32_t second_level_index, uint32_t descriptor);
 
 /**
  * Trouve page_nb pages libres consecutives dans une table des pages.
@@ -61,6 +213,8 @@ uint32_t find_free_pages_page_table(const uint32_t* page_table, uint32_t page_nb
 
 /**
  * Libère une page dans une table des pages.
+ * Une page d'une section ou d'une grande page libère toute la section ou la grande page.
+ * Une page évincée rend son emplacement dans le swap.
  * @param page_table La table des pages dans laquelle supprimer la page.
  * @param first_index L'index de niveau 1 de la page dans la table des pages.
  * @param second_index L'index de niveau 2 de la page dans la table des pages.
@@ -1,38 +1,82 @@
 #include "sched.h"
 #include "kheap.h"
+#include "slab.h"
 #include "hw.h"
 #include "asm_tools.h"
 #include "syscall.h"
 #include "vmem.h"
 #include "page_table.h"
 #include "util.h"
+#include "division.h"
+#include "config.h"
+#include "dma.h"
+#include "merge.h"
 
 //----------------------------------------------------Variables globales
 
-struct pcb_s *current_process;
 struct pcb_s kmain_process;
+//Le processus courant. Les handlers d'exception y sauvegardent le contexte
+//avant meme sched_init, c'est pourquoi il pointe deja sur kmain_process.
+struct pcb_s *current_process = &kmain_process;
 uint32_t total_weight;
 
+//Deux ensembles de files de processus prets.
+//Un processus qui a eu son tour passe des files actives aux files expirees.
+//Quand les files actives sont vides, on echange les deux : chaque processus
+//passe donc une fois par tour, avec un temps proportionnel a son poids.
+RunQueue run_queues[2];
+RunQueue* active_run_queue = &run_queues[0];
+RunQueue* expired_run_queue = &run_queues[1];
+//Les processus en attente.
+ProcessQueue blocked_queue;
+//Les processus termines dont la PCB n'a pas encore ete liberee.
+ProcessQueue zombie_queue;
+//Les PCB, alignees sur une ligne de cache.
+SlabCache pcb_cache = SLAB_CACHE(sizeof(struct pcb_s), 32, 0);
+
 //------------------------------------------------------Fonction privées
 
 //Lance le processus courant.
 void start_current_process();
 //Choisit le prochain processus a executer et on fait pointer current_process dessus.
+//Si aucun processus n'est pret, le noyau s'arrete : un processus en attente ne reprend jamais.
 void elect();
 //Impose le prochain processus a executer.
 void change_process(struct pcb_s* next_process);
-//Sauvegarde le contexte a partir des valeurs des registres presents dans la pile.
-//Sauvegarde aussi la valeur des registres lr et sp du mode user.
-//Le contexte est sauvegardé dans le current_process.
-void save_context(int* pile);
-//Restaure le contexte dans la pile a partir des valeurs presents dans le current_process.
-//Restaure aussi les valeurs des registres lr et sp du mode user.
-void restore_context(int* pile);
+//Ajoute un processus a la fin d'une file.
+void process_queue_push(ProcessQueue* queue, struct pcb_s* process);
+//Retire un processus de la file dans laquelle il se trouve.
+void process_queue_remove(struct pcb_s* process);
+//Ajoute un processus pret dans la file de son poids.
+void run_queue_push(RunQueue* run_queue, struct pcb_s* process);
+//Retire et retourne le processus pret de plus grand poids, 0 s'il n'y en a pas.
+struct pcb_s* run_queue_pop(RunQueue* run_queue);
+//Indique si aucun processus n'est pret, dans les files actives comme dans les files expirees.
+int run_queues_empty();
+//Retire un processus de sa file et le met en attente dans une file d'attente.
+void block_process(struct pcb_s* process, ProcessQueue* wait_queue);
+//Retire un processus de la file des processus bloques et le rend pret.
+void wake_process(struct pcb_s* process);
 //Convertit une niceness en poids.
 uint32_t niceness_to_weight(int niceness);
 //Convertit le poids d'un processus en temps d'execution.
 uint32_t weight_to_timeslice(uint32_t weight);
+//Reserve la premiere page de la zone du break, pour l'etat de malloc, et place le break apres.
+void init_process_break(struct pcb_s* process);
+//Alloue la PCB, la table des pages et les zones d'un nouveau processus.
+//Les zones sont copiees de clone_vmas si ce n'est pas 0. Retourne 0 si le tas noyau est plein.
+struct pcb_s* alloc_process(const VmaSet* clone_vmas);
+//Libere la PCB, la table des pages et les zones d'un processus qui n'a jamais ete execute.
+void discard_process(struct pcb_s* process);
+//Donne un nouveau pere aux enfants d'un processus, dans une file et dans les files d'attente de ses processus.
+void reparent_children(ProcessQueue* queue, struct pcb_s* parent, struct pcb_s* new_parent);
+
 
+//Les decalages sont recopies en dur dans context.s.
+_Static_assert(PCB_OFFSET_SP == 52, "PCB_OFFSET_SP doit correspondre a context.s");
+_Static_assert(PCB_OFFSET_LR_USER == 56, "PCB_OFFSET_LR_USER doit correspondre a context.s");
+_Static_assert(PCB_OFFSET_LR_SVC == 60, "PCB_OFFSET_LR_SVC doit correspondre a context.s");
+_Static_assert(PCB_OFFSET_CPSR == 64, "PCB_OFFSET_CPSR doit correspondre a context.s");
 
 //-----------------------------------------------------------Réalisation
 
@@ -44,17 +88,27 @@ void sched_init()
 		timer_init();
 	#endif
 	//Initialisation du kmain_process.
-	//On fait pointer son son next_process sur lui meme
-	//car il est le seul processus a etre execute.
-	kmain_process.previous_process = &kmain_process;
-	kmain_process.next_process = &kmain_process;
+	//Il est le processus courant, il n'est donc dans aucune file.
+	kmain_process.previous_process = 0;
+	kmain_process.next_process = 0;
+	kmain_process.queue = 0;
 	kmain_process.parent_process = 0;
+	kmain_process.wait_queue.head = 0;
+	kmain_process.wait_queue.tail = 0;
+	kmain_process.wait_queue.count = 0;
+	kmain_process.waiting_any_child = 0;
+	kmain_process.child_count = 0;
+	kmain_process.page_fault_count = 0;
+	kmain_process.cow_fault_count = 0;
 	//On initialise l'etat du processus dans la PCB.
 	kmain_process.state = RUNNING;
 	//Initialisation de la table des pages du processus.
 	kmain_process.page_table = init_process_translation_table();
 	//On passe sur la table des pages de kmain
-	load_page_table(kmain_process.page_table);
+	kmain_process.asid = 0;
+	kmain_process.vmas = vma_create();
+	load_page_table(kmain_process.page_table, vmem_asid(&kmain_process.asid));
+	init_process_break(&kmain_process);
 	//On initialise le code de retour.
 	kmain_process.returnCode = -1;
 	//On initialise la priorité du processus kmain.
@@ -66,17 +120,136 @@ void sched_init()
     set_next_tick(weight_to_timeslice(current_process->weight));
 }
 
+void process_queue_push(ProcessQueue* queue, struct pcb_s* process)
+{
+	process->queue = queue;
+	process->next_process = 0;
+	process->previous_process = queue->tail;
+	if (queue->tail != 0)
+	{
+		queue->tail->next_process = process;
+	}
+	else
+	{
+		queue->head = process;
+	}
+	queue->tail = process;
+	queue->count++;
+}
+
+void process_queue_remove(struct pcb_s* process)
+{
+	ProcessQueue* queue = process->queue;
+	//Le processus n'est dans aucune file.
+	if (queue == 0)
+	{
+		return;
+	}
+	//Si la file est un niveau des files de processus prets et qu'elle se vide, on met le bitmap a jour.
+	for (uint32_t r = 0;r < 2;r++)
+	{
+		RunQueue* run_queue = &run_queues[r];
+		if (queue >= run_queue->levels && queue < run_queue->levels + WEIGHT_LEVEL_NB && queue->count == 1)
+		{
+			uint32_t level = queue - run_queue->levels;
+			run_queue->bitmap[level / 32] &= ~(1u << (level % 32));
+		}
+	}
+	//On retire le processus de la file.
+	if (process->previous_process != 0)
+	{
+		process->previous_process->next_process = process->next_process;
+	}
+	else
+	{
+		queue->head = process->next_process;
+	}
+	if (process->next_process != 0)
+	{
+		process->next_process->previous_process = process->previous_process;
+	}
+	else
+	{
+		queue->tail = process->previous_process;
+	}
+	queue->count--;
+	process->queue = 0;
+	process->previous_process = 0;
+	process->next_process = 0;
+}
+
+void run_queue_push(RunQueue* run_queue, struct pcb_s* process)
+{
+	uint32_t level = process->weight;
+	process_queue_push(&run_queue->levels[level], process);
+	run_queue->bitmap[level / 32] |= 1u << (level % 32);
+}
+
+struct pcb_s* run_queue_pop(RunQueue* run_queue)
+{
+	//On cherche le mot le plus haut du bitmap qui n'est pas vide.
+	for (int32_t word = WEIGHT_BITMAP_SIZE - 1;word >= 0;word--)
+	{
+		if (run_queue->bitmap[word] != 0)
+		{
+			//Le bit de poids fort donne le niveau non vide de plus grand poids.
+			uint32_t level = word * 32 + 31 - __builtin_clz(run_queue->bitmap[word]);
+			struct pcb_s* process = run_queue->levels[level].head;
+			process_queue_remove(process);
+			return process;
+		}
+	}
+	return 0;
+}
+
+int run_queues_empty()
+{
+	for (uint32_t word = 0;word < WEIGHT_BITMAP_SIZE;word++)
+	{
+		if (active_run_queue->bitmap[word] != 0 || expired_run_queue->bitmap[word] != 0)
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void block_process(struct pcb_s* process, ProcessQueue* wait_queue)
+{
+	process_queue_remove(process);
+	process->state = WAITING;
+	process_queue_push(wait_queue, process);
+}
+
+void wake_process(struct pcb_s* process)
+{
+	process_queue_remove(process);
+	process->state = READY;
+	//Le processus reveille s'execute dans ce tour ci.
+	run_queue_push(active_run_queue, process);
+}
+
 void elect()
 {
-	//On cherche le prochain processus qui est READY.
-	struct pcb_s* next_process = current_process->next_process;
-	//On fait attention a ne pas faire un tour entier de la liste circulaire des processus.
-	while (next_process->state != READY && next_process != current_process)
+	struct pcb_s* next_process;
+	//Le processus courant a eu son tour : il passe dans les files expirees.
+	if (current_process->state == RUNNING)
 	{
-		next_process = next_process->next_process;
+		current_process->state = READY;
+		run_queue_push(expired_run_queue, current_process);
 	}
-	//Si on a trouve un processus READY qui n'est pas le processus courant.
-	if (next_process != current_process)
+	//On prend le processus pret de plus grand poids dans les files actives.
+	next_process = run_queue_pop(active_run_queue);
+	if (next_process == 0)
+	{
+		//Tous les processus ont eu leur tour, on commence un nouveau tour.
+		RunQueue* run_queue = active_run_queue;
+		active_run_queue = expired_run_queue;
+		expired_run_queue = run_queue;
+		next_process = run_queue_pop(active_run_queue);
+	}
+	//Si on a trouve un processus READY.
+	if (next_process != 0)
 	{
 		//On passe au processus suivant.
 		change_process(next_process);
@@ -87,7 +260,13 @@ void elect()
 		//On arrete le noyau.
 		terminate_kernel();
 	}
-	//On ne change rien, on continue a executer le processus courant, car aucun autre processus n'est pret.
+	else
+	{
+		//Le processus courant, s'il etait pret, a ete repris dans les files expirees :
+		//il attend donc un autre processus, et plus aucun processus ne peut le reveiller.
+		//Il ne doit pas reprendre, son appel systeme n'est pas termine.
+		PANIC();
+	}
 }
 
 void change_process(struct pcb_s* next_process)
@@ -96,8 +275,16 @@ void change_process(struct pcb_s* next_process)
 	if (current_process->state == RUNNING)
 	{
 		current_process->state = READY;
+		run_queue_push(expired_run_queue, current_process);
+	}
+	//Le nouveau processus courant n'est plus dans aucune file.
+	process_queue_remove(next_process);
+	//On passe sur l'espace utilisateur du nouveau processus.
+	//Le noyau reste projete par TTBR0, il n'y a rien a faire si le processus ne change pas.
+	if (next_process != current_process)
+	{
+		load_page_table(next_process->page_table, vmem_asid(&next_process->asid));
 	}
-	//Le nouveau processus a executer est celui qui suit le processus courant.
 	current_process = next_process;
 	//On met le nouveau processus courant dans l'etat RUNNING.
 	current_process->state = RUNNING;
@@ -108,65 +295,177 @@ void change_process(struct pcb_s* next_process)
 void yieldto(int* pile)
 {
 	struct pcb_s* dest = (struct pcb_s*)pile[1];
-	//On sauvegarde le contexte d'execution.
-	save_context(pile);
-	//On passe au processus suivant.
+	//On passe au processus dest.
 	change_process(dest);
-	//On restaure le contexte d'execution.
-	restore_context(pile);
 }
 
 void yield(int* pile)
 {
-	//On sauvegarde le contexte d'execution.
-	save_context(pile);
+	//Si aucun autre processus n'est pret, le processeur n'a rien d'autre a faire :
+	//on remplit la reserve de frames nulles, et on cherche parmi les pages de tous les processus
+	//celles identiques a des pages deja examinees. Sinon le travail serait compte au processus
+	//qui rend la main, et retarderait le processus suivant.
+	if (run_queues_empty())
+	{
+		vmem_refill_zeroed_frames(ZEROED_FRAMES_PER_YIELD);
+		merge_scan(MERGE_PAGES_PER_YIELD);
+	}
 	//On passe au processus suivant.
 	elect();
-	//On restaure le contexte d'execution.
-	restore_context(pile);
 }
 
 void exit_process(int* pile)
 {
-	//On sauvegarde le contexte d'execution.
-	save_context(pile);
+	struct pcb_s* exited_process;
+	struct pcb_s* parent;
+	int reaped = 0;
 	//On retire le weight du processus du total_weight.
     total_weight -= current_process->weight;
-	//On marque le current_process comme termine.
-	//La PCB reste dans la liste circulaire dans l'etat TERMINATED.
-	//Grace a un autre appel systeme on pourra recuperer son status et liberer la pcb.
 	//On marque le processus comme TERMINATED.
 	current_process->state = TERMINATED;
 	//On enregistre son code retour.
 	current_process->returnCode = pile[1];
 	//On libere la pile de ce processus.
-	vmem_free(current_process->page_table, current_process->debut_sp - PROCESS_STACK_SIZE, PROCESS_STACK_SIZE);
+	//La page de garde est liberee avec la pile.
+	vmem_free(current_process->page_table, current_process->vmas, current_process->debut_sp - current_process->stack_size - PAGE_SIZE, current_process->stack_size + PAGE_SIZE);
 	//On libère le tas de ce processus.
-	heap_free_all(current_process->heap, current_process->page_table);
+	heap_free_all(current_process->heap, current_process->page_table, current_process->vmas);
 	//On libère toute la mémoire de ce processus.
+	//La MMU ne doit plus parcourir sa table une fois qu'elle est libérée.
+	load_kernel_page_table();
+	merge_forget(current_process->page_table);
 	free_page_table(current_process->page_table);
+	vma_destroy(current_process->vmas);
+	//On reveille les processus qui attendent ce processus.
+	//Le code retour leur est rendu dans R0, comme valeur de retour de leur appel systeme.
+	while (current_process->wait_queue.head != 0)
+	{
+		struct pcb_s* waiting_process = current_process->wait_queue.head;
+		waiting_process->registers[0] = current_process->returnCode;
+		wake_process(waiting_process);
+		reaped = 1;
+	}
+	//Les enfants du processus sont adoptes par kmain, qui peut les attendre avec sys_wait_any :
+	//plus aucune PCB ne pointe sur celle du processus, qui peut etre liberee.
+	//Les processus vivants sont tous dans une file, ou dans la file d'attente d'un autre processus.
+	struct pcb_s* new_parent = current_process != &kmain_process ? &kmain_process : 0;
+	for (uint32_t r = 0;r < 2;r++)
+	{
+		for (uint32_t level = 0;level < WEIGHT_LEVEL_NB;level++)
+		{
+			reparent_children(&run_queues[r].levels[level], current_process, new_parent);
+		}
+	}
+	reparent_children(&blocked_queue, current_process, new_parent);
+	reparent_children(&zombie_queue, current_process, new_parent);
+	current_process->child_count = 0;
+	//Si le pere attend n'importe lequel de ses enfants, on le reveille.
+	//Le pere est vivant : a sa terminaison, ses enfants ont ete adoptes.
+	parent = current_process->parent_process;
+	if (!reaped && parent != 0 && parent->state == WAITING && parent->waiting_any_child)
+	{
+		parent->registers[0] = (uint32_t)current_process;
+		parent->registers[1] = current_process->returnCode;
+		parent->waiting_any_child = 0;
+		wake_process(parent);
+		reaped = 1;
+	}
+	//Si personne ne l'attend, la PCB reste dans la file des zombies dans l'etat TERMINATED.
+	//Grace a un appel a sys_wait on pourra recuperer son status et liberer la pcb.
+	if (!reaped)
+	{
+		process_queue_push(&zombie_queue, current_process);
+	}
 	//On passe au process suivant.
+	exited_process = current_process;
 	elect();
-	//On restaure le contexte d'execution.
-	restore_context(pile);
+	//Le code retour a ete transmis, on libere la PCB.
+	if (reaped && current_process != exited_process)
+	{
+		free_process(exited_process);
+	}
 }
 
-struct pcb_s* create_process(func_t* entry, int32_t niceness)
+void wait_process(int* pile)
 {
-	//Allocation dynamique d'un struct pcb_s pour le nouveau processus.
-	struct pcb_s* process_pcb = (struct pcb_s*)kAlloc(sizeof(struct pcb_s));
+	struct pcb_s* process = (struct pcb_s*)pile[1];
+	//Si le processus est deja termine, on recupere son code retour tout de suite.
+	if (process->state == TERMINATED)
+	{
+		pile[0] = process->returnCode;
+		free_process(process);
+		return;
+	}
+	//Sinon on s'endort dans la file d'attente du processus.
+	//exit_process nous reveillera avec le code retour dans R0.
+	block_process(current_process, &process->wait_queue);
+	elect();
+}
+
+void wait_any_process(int* pile)
+{
+	//On cherche un enfant deja termine.
+	for (struct pcb_s* zombie = zombie_queue.head;zombie != 0;zombie = zombie->next_process)
+	{
+		if (zombie->parent_process == current_process)
+		{
+			pile[0] = (int)zombie;
+			pile[1] = zombie->returnCode;
+			free_process(zombie);
+			return;
+		}
+	}
+	//Sans enfant, il n'y a rien a attendre.
+	if (current_process->child_count == 0)
+	{
+		pile[0] = 0;
+		pile[1] = -1;
+		return;
+	}
+	//On s'endort jusqu'a ce qu'un enfant se termine.
+	current_process->waiting_any_child = 1;
+	block_process(current_process, &blocked_queue);
+	elect();
+}
+
+struct pcb_s* create_process(func_t* entry, int32_t niceness, uint32_t stack_size)
+{
+	//Allocation dynamique d'un struct pcb_s, de la table des pages et des zones du nouveau processus.
+	struct pcb_s* process_pcb = alloc_process(0);
+	if (process_pcb == 0)
+	{
+		return 0;
+	}
+	//Les registres du nouveau processus ne sont pas initialises.
+	for (uint32_t i = 0;i < 13;i++)
+	{
+		process_pcb->registers[i] = 0;
+	}
 	//Initialisation de lr au debut de la fonction
 	process_pcb->lr_user = entry;
 	process_pcb->lr_svc = (func_t*)&start_current_process;
-	//Initialisation de la table des pages du processus.
-	process_pcb->page_table = init_process_translation_table();
-	//Initialisation de la pile du processus : 12ko.
-	//La pile du processus est alloué dans le tas qui grossit vers les adresse hautes.
+	process_pcb->asid = 0;
+	//Initialisation de la pile du processus, d'au moins une page.
+	//Seule sa page du haut est reservee, elle grandit ensuite au fil des erreurs de pages.
 	//La pile grandira vers le bas, donc il faut mettre le pointeur de pile en haut de la zone allouée.
-	process_pcb->debut_sp = vmem_alloc_for_userland(process_pcb->page_table, PROCESS_STACK_SIZE, UINT32_MAX, DOWN) + PROCESS_STACK_SIZE;
+	//La taille est bornee a PROCESS_STACK_LIMIT.
+	if (stack_size == 0 || stack_size > PROCESS_STACK_LIMIT)
+	{
+		stack_size = stack_size == 0 ? 1 : PROCESS_STACK_LIMIT;
+	}
+	process_pcb->stack_size = aligned_value(stack_size, 12);
+	uint8_t* stack = vmem_alloc_stack(process_pcb->page_table, process_pcb->vmas, process_pcb->stack_size);
+	if (stack == NULL)
+	{
+		//Rien n'a encore ete projete : on libere la table, les zones et la PCB.
+		discard_process(process_pcb);
+		return 0;
+	}
+	process_pcb->debut_sp = stack + process_pcb->stack_size;
 	process_pcb->sp = process_pcb->debut_sp;
 	//On initialise le tas.
-	process_pcb->heap = heap_init(0);
+	process_pcb->heap = heap_init(process_pcb->page_table, process_pcb->vmas, (void*)USER_SPACE_START);
+	init_process_break(process_pcb);
 	//Par defaut le CPSR est 0x60000150
 	process_pcb->cpsr = 0x60000150;
 	//Par defaut le processus est dans l'état READY.
@@ -178,21 +477,38 @@ struct pcb_s* create_process(func_t* entry, int32_t niceness)
     total_weight += process_pcb->weight;
     //On definit le parent de ce processus.
     process_pcb->parent_process = current_process;
-	//On insere la PCB dans la liste circulaire du round-robin, juste apres current_process.
-	process_pcb->next_process = current_process->next_process;
-	process_pcb->previous_process = current_process;
-	current_process->next_process->previous_process = process_pcb;
-	current_process->next_process = process_pcb;
+    current_process->child_count++;
+    //Personne n'attend encore ce processus, et il n'a pas d'enfant.
+    process_pcb->wait_queue.head = 0;
+    process_pcb->wait_queue.tail = 0;
+    process_pcb->wait_queue.count = 0;
+    process_pcb->waiting_any_child = 0;
+    process_pcb->child_count = 0;
+    process_pcb->page_fault_count = 0;
+    process_pcb->cow_fault_count = 0;
+	//On insere la PCB dans les files actives, il s'executera dans ce tour ci.
+	run_queue_push(active_run_queue, process_pcb);
 	//On retourne la pcb initialisee.
 	return process_pcb;
 }
 
 struct pcb_s* fork_current_process(int* pile)
 {
-	//On sauvegarde le contexte du processus courant.
-	save_context(pile);
-	//Allocation dynamique d'un struct pcb_s pour le nouveau processus.
-	struct pcb_s* child_pcb = (struct pcb_s*)kAlloc(sizeof(struct pcb_s));
+	//Le contexte du processus courant est deja sauvegarde dans sa PCB.
+	//Allocation dynamique d'un struct pcb_s, de la table des pages et des zones de l'enfant.
+	struct pcb_s* child_pcb = alloc_process(current_process->vmas);
+	if (child_pcb == 0)
+	{
+		return FORK_FAILED;
+	}
+	//L'enfant partage la pile et le tas du pere en copie sur ecriture.
+	//Ses tables de niveau 2 sont creees pendant le partage : en cas d'echec,
+	//liberer sa table rend les frames et les emplacements du swap deja partages.
+	if (!vmem_fork_userland(child_pcb->page_table, current_process->page_table))
+	{
+		discard_process(child_pcb);
+		return FORK_FAILED;
+	}
 	//On copie la pcb du processus courant dans celle de l'enfant.
 	for (uint32_t i = 0;i < 13;i++)
 	{
@@ -201,6 +517,7 @@ struct pcb_s* fork_current_process(int* pile)
 	child_pcb->lr_user = current_process->lr_user;
 	child_pcb->lr_svc = current_process->lr_svc;
 	child_pcb->debut_sp = current_process->debut_sp;
+	child_pcb->stack_size = current_process->stack_size;
 	child_pcb->cpsr = current_process->cpsr;
 	child_pcb->weight = current_process->weight;
 	//On initialise d'autres champs.
@@ -208,37 +525,22 @@ struct pcb_s* fork_current_process(int* pile)
 	child_pcb->returnCode = -1;
 	total_weight += child_pcb->weight;
 	child_pcb->parent_process = current_process;
-	child_pcb->page_table = init_process_translation_table();
-	//On insere la PCB dans la liste circulaire du round-robin, juste apres current_process.
-	child_pcb->next_process = current_process->next_process;
-	child_pcb->previous_process = current_process;
-	current_process->next_process->previous_process = child_pcb;
-	current_process->next_process = child_pcb;
-	//On alloue une pile.
-	child_pcb->debut_sp = vmem_alloc_for_userland(child_pcb->page_table, PROCESS_STACK_SIZE, UINT32_MAX, DOWN) + PROCESS_STACK_SIZE;
+	current_process->child_count++;
+	child_pcb->wait_queue.head = 0;
+	child_pcb->wait_queue.tail = 0;
+	child_pcb->wait_queue.count = 0;
+	child_pcb->waiting_any_child = 0;
+	child_pcb->child_count = 0;
+	child_pcb->page_fault_count = 0;
+	child_pcb->cow_fault_count = 0;
+	child_pcb->asid = 0;
+	//L'enfant reprend la pile et le tas du pere.
 	child_pcb->sp = current_process->sp;
-	//On copie le contenu de la pile.
-	uint32_t stack_first_page = ((uint32_t)child_pcb->debut_sp - PROCESS_STACK_SIZE)/PAGE_SIZE;
-	uint32_t stack_page_size = PROCESS_STACK_SIZE / PAGE_SIZE;
-	for (uint32_t page = 0;page < stack_page_size;page++)
-	{
-		uint32_t address = (stack_first_page + page)*PAGE_SIZE;
-		//On regarde le numero de frame pour chaque processus.
-		uint32_t frame_current_process = vmem_translate(address, current_process->page_table) / PAGE_SIZE;
-		uint32_t frame_child_process = vmem_translate(address, child_pcb->page_table) / PAGE_SIZE;
-		//On copie le contenu d'une frame dans l'autre.
-		vmem_copy_frame(frame_child_process, frame_current_process);
-	}
-
-	//On alloue le tas.
-	uint32_t h_size = heap_size(current_process->heap);
-	uint32_t h_address = (uint32_t)current_process->heap->address;
-	if (h_size > 0)
-	{
-		vmem_alloc_for_userland(child_pcb->page_table, h_size, h_address, UP);
-	}
-
-	//TODO: Copier les frames du tas, puis copier les MemoryBlock.
+	child_pcb->brk = current_process->brk;
+	//Les blocs du tas sont decrits dans ses pages : le fils a deja sa copie.
+	child_pcb->heap = current_process->heap;
+	//On insere la PCB dans les files actives, il s'executera dans ce tour ci.
+	run_queue_push(active_run_queue, child_pcb);
 
 	//Pour le processus enfant, on retourne 0 comme pcb.
 	child_pcb->registers[0] = 0;
@@ -254,101 +556,70 @@ void __attribute__((naked)) start_current_process()
 	__asm volatile("b sys_exit");
 }
 
-void free_process(struct pcb_s* process)
+struct pcb_s* alloc_process(const VmaSet* clone_vmas)
 {
-	//On supprime la PCB de la liste circulaire.
-	process->next_process->previous_process = process->previous_process;
-	process->previous_process->next_process = process->next_process;
-	
-	//On libere la pcb de ce processus.
-	kFree((void*)(process), sizeof(struct pcb_s));
+	struct pcb_s* process = (struct pcb_s*)slab_alloc(&pcb_cache);
+	if (process == FORBIDDEN_ADDRESS)
+	{
+		return 0;
+	}
+	//Initialisation de la table des pages et des zones du processus.
+	process->page_table = init_process_translation_table();
+	process->vmas = clone_vmas != 0 ? vma_clone(clone_vmas) : vma_create();
+	if (process->page_table == FORBIDDEN_ADDRESS || process->vmas == FORBIDDEN_ADDRESS)
+	{
+		discard_process(process);
+		return 0;
+	}
+	return process;
 }
 
-void save_context(int* pile)
+void discard_process(struct pcb_s* process)
 {
-	int i;
-	//--------------------------------------------------------Sauvegarde
-	//On sauvegarde les registres de la pile courante dans current_process.
-	for (i = 0;i < 13;i++)
-	{
-		current_process->registers[i] = pile[i];
-	}
-	//On sauvegarde le registre lr_svc
-	current_process->lr_svc = (func_t*)pile[13];
-	//On sauvegarde les registres lr_user et sp_user.
-	//Pour acceder au lr_user et au sp_user depuis le mode SVC, on doit passer en mode system.
-	//On met une bonne fois pour toute l'adresse de current_process dans R0.
-	__asm("mov r1, %0" : : "r"(current_process));
-	//On passe en mode SYSTEM.
-	__asm("cps 0x1f");
-	//On sauvegarde le lr_user du processus courant.
-	__asm("str lr, [r1, %0]" : : "I"(PCB_OFFSET_LR_USER) : "r1");
-	//On sauvegarde le sp du processus courant.
-	__asm("str sp, [r1, %0]" : : "I"(PCB_OFFSET_SP) : "r1");
-	//Pour on revient en mode SVC.
-	__asm("cps 0x13");
-	//On sauvegarde le SPSR.
-	__asm("mrs r2, spsr");
-	__asm("str r2, [r1, %0]" : : "I"(PCB_OFFSET_CPSR) : "r1");
+	if (process->page_table != FORBIDDEN_ADDRESS)
+	{
+		free_page_table(process->page_table);
+	}
+	if (process->vmas != FORBIDDEN_ADDRESS)
+	{
+		vma_destroy(process->vmas);
+	}
+	slab_free(&pcb_cache, process);
 }
 
-void restore_context(int* pile)
+void free_process(struct pcb_s* process)
 {
-	int i;
-	//------------------------------------------------------Restauration
-	//On ecrase la pile de swi_handler par la pile du nouveau processus.
-	for (i = 0;i < 13;i++)
-	{
-		pile[i] = current_process->registers[i];
-	}
-	//On restaure le registre lr_svc
-	pile[13] = (int)current_process->lr_svc;
-	//On restaure les registres lr_user et sp_user.
-	//Pour acceder au lr_user et au sp_user depuis le mode SVC, on doit passer en mode system.
-	//On met une bonne fois pour toute l'adresse de current_process dans R0.
-	__asm("mov r0, %0" : : "r"(current_process));
-	//On passe en mode SYSTEM.
-	__asm("cps 0x1f");
-	//On restaure le lr_user.
-	__asm("ldr	lr, [r0, %0]" : : "I"(PCB_OFFSET_LR_USER) : "r0");
-	//On restaure le sp du processus destination.
-	__asm("ldr	sp, [r0, %0]" : : "I"(PCB_OFFSET_SP) : "r0");
-	//On revient en mode SVC.
-	__asm("cps 0x13");
-	//On restaure le SPSR.
-	__asm("ldr r2, [r0, %0]" : : "I"(PCB_OFFSET_CPSR) : "r0");
-	__asm("msr spsr, r2");
+	//On retire la PCB de sa file.
+	process_queue_remove(process);
+	//Le pere a un enfant de moins. Il est vivant : s'il s'est termine, le processus a ete adopte.
+	if (process->parent_process != 0)
+	{
+		process->parent_process->child_count--;
+	}
+
+	//On libere la pcb de ce processus.
+	slab_free(&pcb_cache, process);
 }
 
-void __attribute__((naked)) irq_handler()
+void irq_handler_C(int* pile)
 {
-	int* pile;
-	DISABLE_IRQ();
-	//Sauvegarde du contexte d'execution.
-	__asm("stmfd sp!, {r0-r12, lr}");
-	//Memorisation du sommet de pile pour lecture des parametres.
-	__asm("mov %0, sp" : "=r"(pile));
-	
-	//On passe sur la table de traduction du noyau.
-	load_kernel_page_table();
-	
-	//On retire 4 au lr pour eviter de sauter une instruction au retour.
-	pile[13] -= 4;
-	//On passe en mode SVC pour le changement de contexte.
-	__asm("cps 0x13");
-	//On change le processus en cours d'execution.
-	yield(pile);
-	//On revient en mode IRQ.
-	__asm("cps 0x12");
-	
-	//On repasse sur la table des pages du processus suivant.
-	load_page_table(current_process->page_table);
-	
-	//On rearme le timer.
-	ENABLE_TIMER_IRQ();
-	
-	//Restauration du contexte d'execution et retour .
-	__asm("ldmfd sp!, {r0-r12, pc}^");
+	//Les fins de transfert DMA ne changent pas de processus.
+	if (Get32(IRQ_PENDING_1) & DMA_IRQ_MASK)
+	{
+		dma_irq_handler();
+	}
+	if (Get32(CS) & TIMER_MATCH_1)
+	{
+		//On change le processus en cours d'execution.
+		elect();
+		//On rearme le timer.
+		ENABLE_TIMER_IRQ();
+	}
+}
+
+struct pcb_s* get_current_process()
+{
+	return current_process;
 }
 
 uint32_t* get_current_process_page_table()
@@ -356,19 +627,56 @@ uint32_t* get_current_process_page_table()
 	return current_process->page_table;
 }
 
-MemoryBlock* get_current_process_heap()
+void reparent_children(ProcessQueue* queue, struct pcb_s* parent, struct pcb_s* new_parent)
+{
+	for (struct pcb_s* process = queue->head;process != 0;process = process->next_process)
+	{
+		if (process->parent_process == parent)
+		{
+			process->parent_process = new_parent;
+			if (new_parent != 0)
+			{
+				new_parent->child_count++;
+			}
+		}
+		//Les processus qui attendent celui-ci ne sont dans aucune autre file.
+		reparent_children(&process->wait_queue, parent, new_parent);
+	}
+}
+
+void init_process_break(struct pcb_s* process)
+{
+	vmem_alloc_for_userland(process->page_table, process->vmas, PAGE_SIZE, USER_BREAK_START, UP, VMA_BREAK);
+	process->brk = (uint8_t*)(USER_BREAK_START + PAGE_SIZE);
+}
+
+Heap* get_current_process_heap()
 {
 	return current_process->heap;
 }
 
+VmaSet* get_current_process_vmas()
+{
+	return current_process->vmas;
+}
+
 uint32_t niceness_to_weight(int niceness)
 {
+    //On borne la niceness pour que le poids ait un niveau dans les files.
+    if (niceness < MIN_NICENESS)
+    {
+        niceness = MIN_NICENESS;
+    }
+    else if (niceness > MAX_NICENESS)
+    {
+        niceness = MAX_NICENESS;
+    }
     return (21-niceness);
 }
 
 uint32_t weight_to_timeslice(uint32_t weight)
 {
-    uint32_t time = (uint32_t)divide((weight * TIME_SLICE),total_weight);
+    uint32_t time = udiv32(weight * TIME_SLICE, total_weight, NULL);
     if (time == 0)
     {
 		time = 1;
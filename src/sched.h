@@ -4,20 +4,35 @@
 #include <inttypes.h>
 #include "vmem.h"
 #include "heap.h"
+#include "vma.h"
 
-//La taille de la stack allouée aux processus en octets.
-#define PROCESS_STACK_SIZE 3*PAGE_SIZE
+//La taille maximale de la pile des processus, en octets.
+//Les pages de la pile ne sont reservees qu'a leur premier acces.
+#define PROCESS_STACK_LIMIT (16 * PAGE_SIZE)
 
 //La période pendant laquelle tous les processus seront exécutés.
 #define TIME_SLICE 256
 
+//Les bornes de la niceness. Le poids d'un processus est compris entre 1 et 41.
+#define MIN_NICENESS -20
+#define MAX_NICENESS 20
+//Le nombre de niveaux de poids dans les files des processus prets.
+#define WEIGHT_LEVEL_NB (MAX_NICENESS - MIN_NICENESS + 2)
+//Le nombre de mots de 32 bits du bitmap des niveaux non vides.
+#define WEIGHT_BITMAP_SIZE ((WEIGHT_LEVEL_NB + 31) / 32)
+
 //Des constantes pour acceder aux cases memoires de struct pcb_s.
-#define PCB_OFFSET_LR_USER sizeof(((struct pcb_s *)0)->registers)
+//Elles sont recopiees dans context.s, qui sauvegarde le contexte directement dans la PCB.
+//sp et lr_user se suivent pour etre sauvegardes par un seul stm.
+#define PCB_OFFSET_SP sizeof(((struct pcb_s *)0)->registers)
+#define PCB_OFFSET_LR_USER PCB_OFFSET_SP + sizeof(((struct pcb_s *)0)->sp)
 #define PCB_OFFSET_LR_SVC PCB_OFFSET_LR_USER + sizeof(((struct pcb_s *)0)->lr_user)
-#define PCB_OFFSET_SP PCB_OFFSET_LR_SVC + sizeof(((struct pcb_s *)0)->lr_svc)
-#define PCB_OFFSET_CPSR PCB_OFFSET_SP + sizeof(((struct pcb_s *)0)->sp)
+#define PCB_OFFSET_CPSR PCB_OFFSET_LR_SVC + sizeof(((struct pcb_s *)0)->lr_svc)
 #define PCB_OFFSET_PAGE_TABLE PCB_OFFSET_CPSR + sizeof(((struct pcb_s *)0)->cpsr)
 
+//Le retour de sys_fork quand l'enfant n'a pas pu etre cree.
+#define FORK_FAILED ((struct pcb_s*)-1)
+
 #define EXIT_SUCCESS 0
 #define EXIT_FAILURE 1
 
@@ -30,25 +45,51 @@ enum ProcessState
 };
 typedef enum ProcessState ProcessState;
 
+//Une file doublement chainée de PCB, reliées par previous_process et next_process.
+struct ProcessQueue
+{
+	struct pcb_s* head;
+	struct pcb_s* tail;
+	uint32_t count;
+};
+typedef struct ProcessQueue ProcessQueue;
+
+//Les processus prets, une file par poids.
+//Un bit est a 1 dans le bitmap si la file du poids correspondant n'est pas vide.
+struct RunQueue
+{
+	uint32_t bitmap[WEIGHT_BITMAP_SIZE];
+	ProcessQueue levels[WEIGHT_LEVEL_NB];
+};
+typedef struct RunQueue RunQueue;
+
 struct pcb_s
 {
 	//Un tableau contenant les registres du contexte.
 	//Les cases 0 a 12 contiennent les registres R0-R12.
 	uint32_t registers[13];
+	//Le pointeur de pile du mode user.
+	void* sp;
 	//Le contenu du registre lr du mode user.
 	func_t* lr_user;
-	//Le lr_svc
+	//L'adresse de retour vers le processus (lr du mode de l'exception).
 	func_t* lr_svc;
-	//Le pointeur de pile.
-	void* sp;
 	//Le registre CPSR.
 	uint32_t cpsr;
 	//Pointeur vers la table des pages du processus.
 	uint32_t* page_table;
+	//L'ASID du processus et sa generation (voir vmem_asid), 0 si aucun n'a encore ete attribue.
+	uint32_t asid;
 	//Le debut de la pile.
 	void* debut_sp;
+	//La taille maximale de la pile, sans sa page de garde.
+	uint32_t stack_size;
+	//Les zones de l'espace utilisateur du processus : pile, tas, break et projections.
+	VmaSet* vmas;
 	//Le tas du processus;
-	MemoryBlock* heap;
+	Heap* heap;
+	//La fin de la zone du break, deplacee par sys_sbrk.
+	uint8_t* brk;
 	//L'état du processus.
 	ProcessState state;
 	//Le code retour du processus.
@@ -57,32 +98,62 @@ struct pcb_s
 	uint32_t weight;
 	//Le père du processus.
 	struct pcb_s* parent_process;
-	//Le processus precedent dans l'ordre du round robin.
+	//Le processus precedent dans la file ou se trouve le processus.
 	struct pcb_s* previous_process;
-	//Le processus suivant dans l'ordre du round robin.
+	//Le processus suivant dans la file ou se trouve le processus.
 	struct pcb_s* next_process;
+	//La file dans laquelle se trouve le processus, 0 pour le processus courant.
+	ProcessQueue* queue;
+	//Les processus qui attendent la terminaison de ce processus.
+	ProcessQueue wait_queue;
+	//1 si le processus attend la terminaison de n'importe lequel de ses enfants.
+	int waiting_any_child;
+	//Le nombre d'enfants dont la PCB n'a pas encore ete liberee.
+	uint32_t child_count;
+	//Le nombre de pages projetees au premier acces, et de pages copiees a la premiere ecriture.
+	uint32_t page_fault_count;
+	uint32_t cow_fault_count;
 };
 
 //---------------------------------------------------Fonctions publiques
 
 void sched_init();
-//Sauvegarde/Restaure le contexte et passe au processus dest.
+//Les fonctions qui prennent pile en parametre sont appelees depuis un handler d'exception.
+//pile pointe sur les registres du processus appelant, deja sauvegardes dans sa PCB par context.s.
+//Elles changent de contexte en changeant current_process, dont le contexte est restaure au retour.
+
+//Passe au processus dest.
 void yieldto(int* pile);
-//Sauvegarde/Restaure le contexte et passe au processus suivant.
+//Passe au processus suivant.
 void yield(int* pile);
 //Termine le processus et et passe au processus suivant.
+//Reveille les processus qui attendent sa terminaison.
 void exit_process(int* pile);
+//Endort le processus courant jusqu'a la terminaison du processus passe en R1.
+//Retourne son code retour dans R0 et libere sa PCB.
+void wait_process(int* pile);
+//Endort le processus courant jusqu'a la terminaison d'un de ses enfants.
+//Retourne la PCB (liberee) de l'enfant dans R0 et son code retour dans R1.
+//S'il n'a pas d'enfant, retourne 0 immediatement.
+void wait_any_process(int* pile);
 //Cree et alloue la memoire pour un nouveau processus.
-struct pcb_s* create_process(func_t* entry, int32_t niceness);
-//Sauvegarde le contexte du processus courant. Puis le Fork.
+//Sa pile peut grandir jusqu'a stack_size octets, arrondis a la page et bornes a PROCESS_STACK_LIMIT.
+//Retourne 0 si sa pile n'a pas pu etre allouee ou si le tas noyau est plein.
+struct pcb_s* create_process(func_t* entry, int32_t niceness, uint32_t stack_size);
+//Fork le processus courant. Retourne FORK_FAILED si le tas noyau est plein :
+//0 est ce que recoit l'enfant.
 struct pcb_s* fork_current_process(int* pile);
-//Libere la PCB d'un processus et le retire de la liste circulaire.
+//Libere la PCB d'un processus et le retire de sa file.
 void free_process(struct pcb_s* process);
-//Handler d'interruption du timer.
-void irq_handler();
+//Handler d'interruption du timer et des canaux DMA, appele par irq_handler (context.s).
+void irq_handler_C(int* pile);
+//Retourne le processus courant.
+struct pcb_s* get_current_process();
 //Retourne la table des pages du processus courant.
 uint32_t* get_current_process_page_table();
 //Retourne le tas du processus courant.
-MemoryBlock* get_current_process_heap();
+Heap* get_current_process_heap();
+//Retourne les zones de l'espace utilisateur du processus courant.
+VmaSet* get_current_process_vmas();
 
 #endif
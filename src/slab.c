@@ -0,0 +1,151 @@
+#include "slab.h"
+#include "config.h"
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Ajoute un slab en tete d'une liste.
+ */
+void slab_list_push(Slab** list, Slab* slab);
+
+/**
+ * Retire un slab d'une liste.
+ */
+void slab_list_remove(Slab** list, Slab* slab);
+
+/**
+ * Alloue les pages d'un nouveau slab et chaine ses objets libres.
+ * Retourne FORBIDDEN_ADDRESS si le tas noyau est plein.
+ */
+Slab* slab_create(SlabCache* cache);
+
+
+void slab_list_push(Slab** list, Slab* slab)
+{
+	slab->previous = NULL;
+	slab->next = *list;
+	if (*list != NULL)
+	{
+		(*list)->previous = slab;
+	}
+	*list = slab;
+}
+
+void slab_list_remove(Slab** list, Slab* slab)
+{
+	if (slab->previous != NULL)
+	{
+		slab->previous->next = slab->next;
+	}
+	else
+	{
+		*list = slab->next;
+	}
+	if (slab->next != NULL)
+	{
+		slab->next->previous = slab->previous;
+	}
+}
+
+Slab* slab_create(SlabCache* cache)
+{
+	Slab* slab = (Slab*)kAlloc_pages(cache->slab_order);
+	if (slab == FORBIDDEN_ADDRESS)
+	{
+		return FORBIDDEN_ADDRESS;
+	}
+	slab->used = 0;
+	//On chaine les objets dans l'ordre des adresses.
+	uint8_t* object = (uint8_t*)slab + cache->first_offset;
+	slab->free_object = object;
+	for (uint32_t i = 1;i < cache->objects_per_slab;i++)
+	{
+		*(void**)object = object + cache->object_size;
+		object += cache->object_size;
+	}
+	*(void**)object = NULL;
+	cache->slab_count++;
+	return slab;
+}
+
+//----------------------------------------------------------Realisations
+void* slab_alloc(SlabCache* cache)
+{
+	Slab* slab = cache->partial;
+	//Sans slab partiel, on reprend un slab vide ou on en cree un.
+	if (slab == NULL)
+	{
+		slab = cache->empty;
+		if (slab != NULL)
+		{
+			slab_list_remove(&cache->empty, slab);
+			cache->empty_slab_count--;
+		}
+		else
+		{
+			slab = slab_create(cache);
+			if (slab == FORBIDDEN_ADDRESS)
+			{
+				return FORBIDDEN_ADDRESS;
+			}
+		}
+		slab_list_push(&cache->partial, slab);
+	}
+
+	void* object = slab->free_object;
+	slab->free_object = *(void**)object;
+	slab->used++;
+	if (slab->used == cache->objects_per_slab)
+	{
+		slab_list_remove(&cache->partial, slab);
+		slab_list_push(&cache->full, slab);
+	}
+
+	cache->object_count++;
+	if (cache->object_count > cache->object_count_max)
+	{
+		cache->object_count_max = cache->object_count;
+	}
+	return object;
+}
+
+void slab_free(SlabCache* cache, void* object)
+{
+	//Le slab est aligne sur sa taille.
+	Slab* slab = (Slab*)((uint32_t)object & ~((KHEAP_PAGE_SIZE << cache->slab_order) - 1));
+
+	if (slab->used == cache->objects_per_slab)
+	{
+		slab_list_remove(&cache->full, slab);
+		slab_list_push(&cache->partial, slab);
+	}
+	*(void**)object = slab->free_object;
+	slab->free_object = object;
+	slab->used--;
+	cache->object_count--;
+
+	if (slab->used == 0)
+	{
+		slab_list_remove(&cache->partial, slab);
+		if (cache->empty_slab_count < SLAB_EMPTY_MAX)
+		{
+			//On garde un slab vide pour ne pas rendre et reprendre des pages a chaque allocation.
+			slab_list_push(&cache->empty, slab);
+			cache->empty_slab_count++;
+		}
+		else
+		{
+			kFree_pages((uint8_t*)slab, cache->slab_order);
+			cache->slab_count--;
+		}
+	}
+}
+
+uint32_t slab_cache_object_count(const SlabCache* cache)
+{
+	return cache->object_count;
+}
+
+uint32_t slab_cache_capacity(const SlabCache* cache)
+{
+	return cache->slab_count * cache->objects_per_slab;
+}
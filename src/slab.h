@@ -0,0 +1,91 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <inttypes.h>
+#include "kheap.h"
+
+//Un cache garde au plus ce nombre de slabs vides avant de rendre leurs pages.
+#define SLAB_EMPTY_MAX 1
+
+//Arrondit une taille au multiple superieur d'un alignement, puissance de 2.
+#define SLAB_ROUND(size, alignment) (((size) + (alignment) - 1) & ~((alignment) - 1))
+
+//-----------------------------------------------------------------Types
+/**
+ * Un slab : 2^order pages du tas noyau, alignees sur leur taille, decoupees
+ * en objets de meme taille. L'en-tete est au debut du slab, on le retrouve
+ * a partir de l'adresse d'un objet en masquant les bits de poids faible.
+ */
+struct Slab
+{
+	struct Slab* previous;
+	struct Slab* next;
+	//Les objets libres du slab, chaines par leur premier mot.
+	void* free_object;
+	//Le nombre d'objets alloues dans le slab.
+	uint32_t used;
+};
+typedef struct Slab Slab;
+
+/**
+ * Un cache d'objets d'une meme taille. Les slabs sont dans trois listes,
+ * selon qu'ils sont pleins, partiellement occupes ou vides.
+ */
+struct SlabCache
+{
+	uint32_t object_size;
+	uint32_t slab_order;
+	//Decalage du premier objet dans le slab, apres l'en-tete.
+	uint32_t first_offset;
+	uint32_t objects_per_slab;
+	Slab* partial;
+	Slab* full;
+	Slab* empty;
+	//Statistiques d'occupation.
+	uint32_t slab_count;
+	uint32_t empty_slab_count;
+	uint32_t object_count;
+	uint32_t object_count_max;
+};
+typedef struct SlabCache SlabCache;
+
+/**
+ * Initialiseur d'un cache, calcule a la compilation.
+ * @param size La taille des objets.
+ * @param alignment L'alignement des objets, une puissance de 2 d'au moins 4 octets.
+ * @param order L'ordre des slabs, en pages.
+ */
+#define SLAB_CACHE(size, alignment, order) { \
+	.object_size = SLAB_ROUND(size, alignment), \
+	.slab_order = (order), \
+	.first_offset = SLAB_ROUND(sizeof(Slab), alignment), \
+	.objects_per_slab = ((KHEAP_PAGE_SIZE << (order)) - SLAB_ROUND(sizeof(Slab), alignment)) / SLAB_ROUND(size, alignment), \
+}
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Alloue un objet dans un cache, en O(1).
+ * Le contenu de l'objet n'est pas initialise.
+ * @param cache Le cache dans lequel allouer l'objet.
+ * @return L'adresse de l'objet, ou FORBIDDEN_ADDRESS si le tas noyau est plein.
+ */
+void* slab_alloc(SlabCache* cache);
+
+/**
+ * Libere un objet alloue par slab_alloc, en O(1).
+ * @param cache Le cache de l'objet.
+ * @param object L'adresse de l'objet.
+ */
+void slab_free(SlabCache* cache, void* object);
+
+/**
+ * Retourne le nombre d'objets alloues dans un cache.
+ */
+uint32_t slab_cache_object_count(const SlabCache* cache);
+
+/**
+ * Retourne le nombre d'objets que peuvent contenir les slabs d'un cache.
+ */
+uint32_t slab_cache_capacity(const SlabCache* cache);
+
+#endif
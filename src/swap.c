@@ -0,0 +1,250 @@
+#include "swap.h"
+#include "emmc.h"
+#include "vmem.h"
+#include "page_table.h"
+#include "kheap.h"
+#include "memory.h"
+#include "config.h"
+
+//Une page occupe des blocs consecutifs de la carte.
+#define SWAP_BLOCKS_PER_PAGE (PAGE_SIZE / EMMC_BLOCK_SIZE)
+
+//----------------------------------------------------Variables globales
+
+//Le premier bloc de la partition de swap, et son nombre d'emplacements d'une page.
+//Sans partition de swap, il n'y a aucun emplacement.
+uint32_t swap_first_block;
+uint32_t swap_slot_count = 0;
+//Pour chaque emplacement, le nombre de pages qui le tiennent, 0 s'il est libre.
+uint16_t* swap_slot_users;
+uint32_t swap_used_slot_count;
+//Les emplacements sont pris a la suite : les pages evincees ensemble sont ecrites
+//dans des blocs consecutifs de la carte.
+uint32_t swap_next_slot;
+//La frame sous l'aiguille de l'horloge.
+uint32_t swap_clock_hand;
+
+uint32_t swap_scanned_count = 0;
+uint32_t swap_evicted_count = 0;
+uint32_t swap_in_count = 0;
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Lit un entier de 32 bits petit-boutiste, a une adresse qui peut ne pas etre alignee.
+ */
+uint32_t swap_read_le32(const uint8_t* bytes);
+
+/**
+ * Prend un emplacement libre, tenu par une page.
+ * @return L'emplacement, UINT32_MAX si le swap est plein.
+ */
+uint32_t swap_alloc_slot();
+
+/**
+ * Indique si une frame peut etre evincee : elle n'est projetee qu'une fois,
+ * dans l'espace utilisateur de sa table proprietaire, par une page de 4ko.
+ */
+int swap_evictable(uint32_t frame);
+
+/**
+ * Ecrit le contenu d'une frame dans un emplacement.
+ * @return 1 si la page est ecrite, 0 en cas d'erreur de la carte.
+ */
+int swap_out(uint32_t slot, uint32_t frame);
+
+//----------------------------------------------------------Realisations
+uint32_t swap_read_le32(const uint8_t* bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+int swap_init()
+{
+	swap_slot_count = 0;
+	if (!emmc_init())
+	{
+		return 0;
+	}
+
+	uint8_t* sector = kAlloc(EMMC_BLOCK_SIZE);
+	if (sector == FORBIDDEN_ADDRESS)
+	{
+		return 0;
+	}
+	//Les entrees de la table des partitions ne sont pas alignees sur 4 octets.
+	uint32_t first_block = 0;
+	uint32_t block_count = 0;
+	if (emmc_read(0, 1, sector) && sector[MBR_SIGNATURE] == 0x55 && sector[MBR_SIGNATURE + 1] == 0xAA)
+	{
+		for (uint32_t i = 0;i < MBR_PARTITION_COUNT && block_count == 0;i++)
+		{
+			const uint8_t* entry = sector + MBR_PARTITION_TABLE + i * MBR_PARTITION_ENTRY_SIZE;
+			if (entry[4] == SWAP_PARTITION_TYPE)
+			{
+				first_block = swap_read_le32(entry + 8);
+				block_count = swap_read_le32(entry + 12);
+			}
+		}
+	}
+	kFree(sector, EMMC_BLOCK_SIZE);
+
+	uint32_t slot_count = block_count / SWAP_BLOCKS_PER_PAGE;
+	if (slot_count > SWAP_SLOT_MAX)
+	{
+		slot_count = SWAP_SLOT_MAX;
+	}
+	if (slot_count == 0)
+	{
+		return 0;
+	}
+	swap_slot_users = (uint16_t*)kAlloc(slot_count * sizeof(uint16_t));
+	if (swap_slot_users == FORBIDDEN_ADDRESS)
+	{
+		return 0;
+	}
+	memset(swap_slot_users, 0, slot_count * sizeof(uint16_t));
+
+	swap_first_block = first_block;
+	swap_slot_count = slot_count;
+	swap_used_slot_count = 0;
+	swap_next_slot = 0;
+	swap_clock_hand = 0;
+	return 1;
+}
+
+uint32_t swap_alloc_slot()
+{
+	if (swap_used_slot_count >= swap_slot_count)
+	{
+		return UINT32_MAX;
+	}
+	for (uint32_t i = 0;i < swap_slot_count;i++)
+	{
+		uint32_t slot = swap_next_slot;
+		swap_next_slot = slot + 1 < swap_slot_count ? slot + 1 : 0;
+		if (swap_slot_users[slot] == 0)
+		{
+			swap_slot_users[slot] = 1;
+			swap_used_slot_count++;
+			return slot;
+		}
+	}
+	return UINT32_MAX;
+}
+
+int swap_share_slot(uint32_t slot)
+{
+	if (swap_slot_users[slot] == UINT16_MAX)
+	{
+		return 0;
+	}
+	swap_slot_users[slot]++;
+	return 1;
+}
+
+void swap_free_slot(uint32_t slot)
+{
+	if (swap_slot_users[slot] > 0)
+	{
+		swap_slot_users[slot]--;
+		if (swap_slot_users[slot] == 0)
+		{
+			swap_used_slot_count--;
+		}
+	}
+}
+
+int swap_evictable(uint32_t frame)
+{
+	const FrameDescriptor* descriptor = get_frame_descriptor(frame);
+
+	//Une frame libre, du noyau, epinglee, de la reserve de frames nulles ou partagee reste en memoire.
+	//Sans proprietaire, la page qui projette la frame n'est pas connue.
+	if (descriptor == NULL || descriptor->refcount != 1 || descriptor->owner == NULL
+		|| (descriptor->flags & (FRAME_KERNEL | FRAME_PINNED | FRAME_DMA | FRAME_ZEROED))
+		|| descriptor->owner_page < USER_SPACE_START / PAGE_SIZE)
+	{
+		return 0;
+	}
+	uint32_t first_level_index = descriptor->owner_page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = descriptor->owner_page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t entry = get_entry_page_table(descriptor->owner, first_level_index, second_level_index);
+
+	return IS_MAPPED_DESCRIPTOR(entry) && !IS_LARGE_PAGE_DESCRIPTOR(entry) && entry / PAGE_SIZE == frame;
+}
+
+int swap_out(uint32_t slot, uint32_t frame)
+{
+	//La frame est encore projetee par son processus : sa projection temporaire ne la libere pas.
+	uint8_t* page = vmem_map_frame(frame);
+	int written = emmc_write(swap_first_block + slot * SWAP_BLOCKS_PER_PAGE, SWAP_BLOCKS_PER_PAGE, page);
+	vmem_unmap_frame(page);
+	return written;
+}
+
+int swap_in(uint32_t slot, uint32_t frame)
+{
+	uint8_t* page = vmem_map_frame(frame);
+	int read = emmc_read(swap_first_block + slot * SWAP_BLOCKS_PER_PAGE, SWAP_BLOCKS_PER_PAGE, page);
+	vmem_unmap_frame(page);
+	if (read)
+	{
+		swap_free_slot(slot);
+		swap_in_count++;
+	}
+	return read;
+}
+
+uint32_t swap_reclaim(uint32_t frame_nb)
+{
+	uint32_t released = 0;
+
+	//Deux tours d'aiguille au plus : au premier, toutes les pages ont pu n'etre que vieillies.
+	for (uint32_t step = 0;step < 2 * FRAME_OCCUPANCY_TT_SIZE && released < frame_nb && swap_slot_count > 0;step++)
+	{
+		uint32_t frame = swap_clock_hand;
+		swap_clock_hand = frame + 1 < FRAME_OCCUPANCY_TT_SIZE ? frame + 1 : 0;
+		if (!swap_evictable(frame))
+		{
+			continue;
+		}
+		FrameDescriptor* descriptor = get_frame_descriptor(frame);
+		uint32_t* page_table = (uint32_t*)descriptor->owner;
+		uint32_t page = descriptor->owner_page;
+
+		swap_scanned_count++;
+		//Seconde chance : une page accedee depuis le dernier passage est seulement vieillie.
+		//Elle sera evincee au prochain passage si elle n'a pas ete accedee d'ici la.
+		if (vmem_age_page(page_table, page))
+		{
+			continue;
+		}
+		uint32_t slot = swap_alloc_slot();
+		if (slot == UINT32_MAX)
+		{
+			break;
+		}
+		if (!swap_out(slot, frame))
+		{
+			swap_free_slot(slot);
+			break;
+		}
+		if (!vmem_evict_page(page_table, page, slot))
+		{
+			swap_free_slot(slot);
+			continue;
+		}
+		swap_evicted_count++;
+		released++;
+	}
+	return released;
+}
+
+void swap_get_stats(SwapStats* stats)
+{
+	stats->scanned_pages = swap_scanned_count;
+	stats->evicted_pages = swap_evicted_count;
+	stats->swapped_in_pages = swap_in_count;
+	stats->used_slots = swap_used_slot_count;
+	stats->slot_count = swap_slot_count;
+}
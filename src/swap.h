@@ -0,0 +1,78 @@
+#ifndef SWAP_H
+#define SWAP_H
+
+#include <inttypes.h>
+
+//Le type des partitions de swap dans la table des partitions (MBR) de la carte SD.
+#define SWAP_PARTITION_TYPE 0x82
+//La table des partitions est dans le premier bloc de la carte, terminee par une signature.
+#define MBR_PARTITION_TABLE 446
+#define MBR_PARTITION_ENTRY_SIZE 16
+#define MBR_PARTITION_COUNT 4
+#define MBR_SIGNATURE 510
+
+//-----------------------------------------------------------------Types
+/**
+ * Les compteurs de la recuperation des frames.
+ */
+struct SwapStats
+{
+	//Les pages examinees par l'horloge, celles qui ont ete evincees dans le swap,
+	//et celles qui ont ete relues a leur acces suivant.
+	uint32_t scanned_pages;
+	uint32_t evicted_pages;
+	uint32_t swapped_in_pages;
+	//Les emplacements occupes, et la taille du swap en pages.
+	uint32_t used_slots;
+	uint32_t slot_count;
+};
+typedef struct SwapStats SwapStats;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Identifie la carte SD et cherche sa premiere partition de swap.
+ * Sans carte ou sans partition de swap, aucune page n'est evincee.
+ * @return 1 si le swap est utilisable, 0 sinon.
+ */
+int swap_init();
+
+/**
+ * Evince des pages de l'espace utilisateur dans le swap, pour rendre leurs frames a l'allocateur.
+ * Les frames sont parcourues par une horloge : une page accedee depuis le passage precedent
+ * de l'aiguille a une seconde chance, son bit d'acces est efface (voir vmem_age_page).
+ * Une page qui n'a pas ete accedee est ecrite dans le swap et sa frame est liberee.
+ * Seules les frames projetees une seule fois, par leur table proprietaire, sont evincees.
+ * @param frame_nb Le nombre de frames a liberer.
+ * @return Le nombre de frames liberees, 0 si le swap est plein ou inutilisable.
+ */
+uint32_t swap_reclaim(uint32_t frame_nb);
+
+/**
+ * Lit une page evincee dans une frame. Si la lecture reussit, la page ne tient plus
+ * son emplacement, qui est libere quand plus aucune page ne le tient.
+ * La frame doit deja etre comptee projetee : elle est projetee temporairement dans le noyau.
+ * @param slot L'emplacement de la page, donne par SWAPPED_DESCRIPTOR_SLOT.
+ * @param frame La frame a remplir.
+ * @return 1 si la page est lue, 0 en cas d'erreur de la carte.
+ */
+int swap_in(uint32_t slot, uint32_t frame);
+
+/**
+ * Ajoute une page qui tient un emplacement, pour fork : le pere et le fils
+ * relisent chacun la page a leur premier acces.
+ * @return 1 si l'emplacement est partage, 0 s'il est deja tenu par UINT16_MAX pages.
+ */
+int swap_share_slot(uint32_t slot);
+
+/**
+ * Retire une page qui tient un emplacement, quand la page est liberee.
+ * L'emplacement est libere quand plus aucune page ne le tient.
+ */
+void swap_free_slot(uint32_t slot);
+
+/**
+ * Remplit les compteurs de la recuperation des frames.
+ */
+void swap_get_stats(SwapStats* stats);
+
+#endif
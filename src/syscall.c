@@ -21,13 +21,24 @@ enum SysCalls
 	SYS_PROCESS_RETURN_CODE,
 	SYS_MALLOC,
 	SYS_FREE,
-	SYS_FORK
+	SYS_FORK,
+	SYS_WAIT,
+	SYS_WAIT_ANY,
+	SYS_PROCESS_PAGE_FAULTS,
+	SYS_SBRK,
+	SYS_MMAP,
+	SYS_MUNMAP,
+	SYS_MADVISE,
+	SYS_CALL_NB
 };
 
+//Un appel systeme cote noyau. pile pointe sur les registres sauvegardes du processus appelant.
+typedef void(syscall_t) (int* pile);
+
 //------------------------------------------------------Fonction privées
-void swi_handler();
-void do_sys_reboot();
-void do_sys_nop();
+void swi_handler_C(int* pile);
+void do_sys_reboot(int* pile);
+void do_sys_nop(int* pile);
 void do_sys_settime(int* pile);
 void do_sys_gettime(int* pile);
 void do_sys_free_process(int* pile);
@@ -37,267 +48,285 @@ void do_sys_process_return_code(int* pile);
 void do_sys_malloc(int* pile);
 void do_sys_free(int* pile);
 void do_sys_fork(int* pile);
+void do_sys_process_page_faults(int* pile);
+void do_sys_sbrk(int* pile);
+void do_sys_mmap(int* pile);
+void do_sys_munmap(int* pile);
+void do_sys_madvise(int* pile);
+
+//La table des appels systemes, indexee par le numero passe dans R0.
+static syscall_t* const syscall_table[SYS_CALL_NB] =
+{
+	[SYS_REBOOT] = do_sys_reboot,
+	[SYS_NOP] = do_sys_nop,
+	[SYS_SET_TIME] = do_sys_settime,
+	[SYS_GET_TIME] = do_sys_gettime,
+	[SYS_YIELD_TO] = yieldto,
+	[SYS_YIELD] = yield,
+	[SYS_EXIT] = exit_process,
+	[SYS_FREE_PROCESS] = do_sys_free_process,
+	[SYS_CREATE_PROCESS] = do_sys_create_process,
+	[SYS_PROCESS_STATE] = do_sys_process_state,
+	[SYS_PROCESS_RETURN_CODE] = do_sys_process_return_code,
+	[SYS_MALLOC] = do_sys_malloc,
+	[SYS_FREE] = do_sys_free,
+	[SYS_FORK] = do_sys_fork,
+	[SYS_WAIT] = wait_process,
+	[SYS_WAIT_ANY] = wait_any_process,
+	[SYS_PROCESS_PAGE_FAULTS] = do_sys_process_page_faults,
+	[SYS_SBRK] = do_sys_sbrk,
+	[SYS_MMAP] = do_sys_mmap,
+	[SYS_MUNMAP] = do_sys_munmap,
+	[SYS_MADVISE] = do_sys_madvise
+};
 
 //-----------------------------------------------------------Réalisation
 
+//Les parametres sont passes au noyau par des variables registres.
+//Le compilateur sait ainsi quels registres l'appel systeme lit et modifie,
+//ce qui permet de compiler avec optimisation.
+//Le noyau restaure tous les registres sauf ceux qui portent un resultat.
+
 void sys_reboot()
 {
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_REBOOT));
+	register uint32_t r0 __asm("r0") = SYS_REBOOT;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0) : "memory");
 }
 
 void sys_nop()
 {
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_NOP));
+	register uint32_t r0 __asm("r0") = SYS_NOP;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0) : "memory");
 }
 
 void sys_settime(uint64_t date_ms)
 {
-	//On met les parametres dans les registres.
-	//Un uint64_t occupe deux registres. On met date_ms dans R1 et R2.
-	__asm("mov r2,r1" : : : "r0");
-	__asm("mov r1,r0" : : : "r2");
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_SET_TIME) : "r1", "r2");
-	
+	register uint32_t r0 __asm("r0") = SYS_SET_TIME;
+	//Un uint64_t occupe deux registres. On met date_ms dans R1 et R2.
+	register uint32_t r1 __asm("r1") = (uint32_t)date_ms;
+	register uint32_t r2 __asm("r2") = (uint32_t)(date_ms >> 32);
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0), "r"(r1), "r"(r2) : "memory");
 }
 
 uint64_t sys_gettime()
 {
-	uint32_t date_lowbits, date_highbits;
 	uint64_t date_ms;
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_GET_TIME));
+	register uint32_t r0 __asm("r0") = SYS_GET_TIME;
+	register uint32_t r1 __asm("r1");
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	//On recupère le résultat de l'appel système depuis les registres R0 et R1.
-	__asm("mov %0, r0" : "=r"(date_lowbits) : : "r1");
-	__asm("mov %0, r1" : "=r"(date_highbits));
+	//Le résultat de l'appel système est dans les registres R0 et R1.
+	__asm volatile("swi #0" : "+r"(r0), "=r"(r1) : : "memory");
 	//On transforme les deux entiers de 32bits en un entier de 64 bits.
-	date_ms = date_highbits;
+	date_ms = r1;
 	date_ms = date_ms << 32;
-	date_ms += date_lowbits;
+	date_ms += r0;
 
 	return date_ms;
 }
 
 void sys_yieldto(struct pcb_s* dest)
 {
-	//On met le parametre dans le registre R1.
-	__asm("mov r1,r0");
-	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_YIELD_TO) : "r1");
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_YIELD_TO;
+	register struct pcb_s* r1 __asm("r1") = dest;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0), "r"(r1) : "memory");
 }
 
 void sys_yield()
 {
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_YIELD));
+	register uint32_t r0 __asm("r0") = SYS_YIELD;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0) : "memory");
 }
 
 void sys_exit(int status)
 {
-	//On met le parametre dans le registre R1.
-	__asm("mov r1,r0");
-	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_EXIT) : "r1");
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_EXIT;
+	register int r1 __asm("r1") = status;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0), "r"(r1) : "memory");
 }
 
 int sys_wait(struct pcb_s* dest)
 {
-	int status = -1;
-	//Tant que le code de retour est -1, le processus n'est pas termine.
-	while(sys_process_state(dest) != TERMINATED)
-	{
-		//On laisse notre tour, le temps d'attendre 
-		sys_yield();
-	}
-	//On retient le code de retour du processus.
-	status = sys_process_return_code(dest);
-	//On supprime proprement la memoire du processus.
-	//On met le parametre dans le registre R1.
-	__asm("mov r1, %0" : : "r"(dest));
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register int r0 __asm("r0") = SYS_WAIT;
+	register struct pcb_s* r1 __asm("r1") = dest;
+	//On fait une interruption logicielle.
+	//Le noyau nous endort jusqu'a la terminaison du processus, puis libere sa PCB.
+	//Le code retour du processus est dans R0.
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
+
+	return r0;
+}
+
+struct pcb_s* sys_wait_any(int* status)
+{
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_FREE_PROCESS) : "r1");
+	register uint32_t r0 __asm("r0") = SYS_WAIT_ANY;
+	register int r1 __asm("r1");
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	
-	return status;
+	//L'enfant termine est dans R0 et son code retour dans R1.
+	__asm volatile("swi #0" : "+r"(r0), "=r"(r1) : : "memory");
+
+	if (status != NULL)
+	{
+		*status = r1;
+	}
+	return (struct pcb_s*)r0;
 }
 
-struct pcb_s* sys_create_process(func_t* entry, int32_t niceness)
+struct pcb_s* sys_create_process(func_t* entry, int32_t niceness, uint32_t stack_size)
 {
-	struct pcb_s* process;
-	//Les parametres sont dans les registres R1 et R2.
-	__asm("mov r1, %0" : : "r"(entry));
-	__asm("mov r2, %0" : : "r"(niceness) : "r1");
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_CREATE_PROCESS) : "r1", "r2");
+	register uint32_t r0 __asm("r0") = SYS_CREATE_PROCESS;
+	//Les parametres sont dans les registres R1, R2 et R3.
+	register func_t* r1 __asm("r1") = entry;
+	register int32_t r2 __asm("r2") = niceness;
+	register uint32_t r3 __asm("r3") = stack_size;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	//On recupère le résultat de l'appel système depuis le registre R0.
-	__asm("mov %0, r0" : "=r"(process));
+	//La PCB du processus créé est dans R0.
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1), "r"(r2), "r"(r3) : "memory");
 
-	return process;
+	return (struct pcb_s*)r0;
 }
 
 ProcessState sys_process_state(struct pcb_s* process)
 {
-	ProcessState state;
-	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_PROCESS_STATE));
-	//Le parametre est dans le registre R1.
-	__asm("mov r1, %0" : : "r"(process) : "r0");
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_PROCESS_STATE;
+	register struct pcb_s* r1 __asm("r1") = process;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	//On recupère le résultat de l'appel système depuis le registre R0.
-	__asm("mov %0, r0" : "=r"(state));
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
 
-	return state;
+	return (ProcessState)r0;
 }
 
 int sys_process_return_code(struct pcb_s* process)
 {
-	int returnCode;
-	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_PROCESS_RETURN_CODE));
-	//Le parametre est dans le registre R1.
-	__asm("mov r1, %0" : : "r"(process) : "r0");
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register int r0 __asm("r0") = SYS_PROCESS_RETURN_CODE;
+	register struct pcb_s* r1 __asm("r1") = process;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	//On recupère le résultat de l'appel système depuis le registre R0.
-	__asm("mov %0, r0" : "=r"(returnCode));
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
 
-	return returnCode;
+	return r0;
+}
+
+uint32_t sys_process_page_faults(struct pcb_s* process)
+{
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_PROCESS_PAGE_FAULTS;
+	register struct pcb_s* r1 __asm("r1") = process;
+	//On fait une interruption logicielle.
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
+
+	return r0;
 }
 
 void* sys_malloc(uint32_t size)
 {
-	void* address;
-	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_MALLOC));
-	//Le parametre est dans le registre R1.
-	__asm("mov r1, %0" : : "r"(size) : "r0");
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_MALLOC;
+	register uint32_t r1 __asm("r1") = size;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	//On recupère le résultat de l'appel système depuis le registre R0.
-	__asm("mov %0, r0" : "=r"(address));
+	//L'adresse du bloc alloué est dans R0.
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
 
-	return address;
+	return (void*)r0;
 }
 
 void sys_free(void* address)
 {
-	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_FREE));
-	//Le parametre est dans le registre R1.
-	__asm("mov r1, %0" : : "r"(address) : "r0");
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_FREE;
+	register void* r1 __asm("r1") = address;
+	//On fait une interruption logicielle.
+	__asm volatile("swi #0" : : "r"(r0), "r"(r1) : "memory");
+}
+
+void* sys_sbrk(int32_t increment)
+{
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_SBRK;
+	register int32_t r1 __asm("r1") = increment;
+	//On fait une interruption logicielle.
+	//L'ancien break est dans R0.
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
+
+	return (void*)r0;
+}
+
+void* sys_mmap(uint32_t size)
+{
+	//On donne le numero d'appel système dans R0 et le parametre dans R1.
+	register uint32_t r0 __asm("r0") = SYS_MMAP;
+	register uint32_t r1 __asm("r1") = size;
+	//On fait une interruption logicielle.
+	//L'adresse des pages est dans R0.
+	__asm volatile("swi #0" : "+r"(r0) : "r"(r1) : "memory");
+
+	return (void*)r0;
+}
+
+void sys_munmap(void* address, uint32_t size)
+{
+	//On donne le numero d'appel système dans R0 et les parametres dans R1 et R2.
+	register uint32_t r0 __asm("r0") = SYS_MUNMAP;
+	register void* r1 __asm("r1") = address;
+	register uint32_t r2 __asm("r2") = size;
+	//On fait une interruption logicielle.
+	__asm volatile("swi #0" : : "r"(r0), "r"(r1), "r"(r2) : "memory");
+}
+
+void sys_madvise(void* address, uint32_t size)
+{
+	//On donne le numero d'appel système dans R0 et les parametres dans R1 et R2.
+	register uint32_t r0 __asm("r0") = SYS_MADVISE;
+	register void* r1 __asm("r1") = address;
+	register uint32_t r2 __asm("r2") = size;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
+	__asm volatile("swi #0" : : "r"(r0), "r"(r1), "r"(r2) : "memory");
 }
 
 struct pcb_s* sys_fork()
 {
-	struct pcb_s* process;
 	//On donne le numero d'appel système dans R0.
-	__asm("mov r0, %0" : : "I"(SYS_FORK));
+	register uint32_t r0 __asm("r0") = SYS_FORK;
 	//On fait une interruption logicielle.
-	__asm("swi #0");
-	//On recupère le résultat de l'appel système depuis le registre R0.
-	__asm("mov %0, r0" : "=r"(process));
-
-	return process;
-}
-
-void __attribute__((naked)) swi_handler()
-{
-	int numeroAppelSysteme;
-	int* pile;
-	//On desactive les interruptions pour ne pas être interrompu.
-	DISABLE_IRQ();
-	//Sauvegarde du contexte d'execution.
-	__asm("stmfd sp!, {r0-r12, lr}");
-	//Memorisation du sommet de pile pour lecture des parametres.
-	__asm("mov %0, sp" : "=r"(pile) : : "r0");
-	//Lecture du numero d'appel systeme dans R0.
-	__asm("mov %0, r0" : "=r"(numeroAppelSysteme) : : "r0");
-	
-	//On passe sur la table de traduction du noyau.
-	load_kernel_page_table();
-	
-	switch(numeroAppelSysteme)
+	//Le pere recoit la PCB de l'enfant dans R0, ou FORK_FAILED, l'enfant recoit 0.
+	__asm volatile("swi #0" : "+r"(r0) : : "memory");
+
+	return (struct pcb_s*)r0;
+}
+
+void swi_handler_C(int* pile)
+{
+	//swi_handler (context.s) a deja sauvegarde les registres du processus dans sa PCB
+	//et est passe sur la table des pages du noyau.
+	//Le numero d'appel systeme est dans R0.
+	uint32_t numeroAppelSysteme = (uint32_t)pile[0];
+
+	if (numeroAppelSysteme >= SYS_CALL_NB)
 	{
-		case SYS_REBOOT:
-			do_sys_reboot();
-			break;
-		case SYS_NOP:
-			do_sys_nop();
-			break;
-		case SYS_SET_TIME:
-			do_sys_settime(pile);
-			break;
-		case SYS_GET_TIME:
-			do_sys_gettime(pile);
-			break;
-		case SYS_YIELD_TO:
-			yieldto(pile);
-			break;
-		case SYS_YIELD:
-			yield(pile);
-			break;
-		case SYS_EXIT:
-			exit_process(pile);
-			break;
-		case SYS_FREE_PROCESS:
-			do_sys_free_process(pile);
-			break;
-		case SYS_CREATE_PROCESS:
-			do_sys_create_process(pile);
-			break;
-		case SYS_PROCESS_STATE:
-			do_sys_process_state(pile);
-			break;
-		case SYS_PROCESS_RETURN_CODE:
-			do_sys_process_return_code(pile);
-			break;
-		case SYS_MALLOC:
-			do_sys_malloc(pile);
-			break;
-		case SYS_FREE:
-			do_sys_free(pile);
-			break;
-		case SYS_FORK:
-			do_sys_fork(pile);
-			break;
-		default:
-			//L'appel système demande n'est pas connu.
-			PANIC();
-			break;
+		//L'appel système demande n'est pas connu.
+		PANIC();
 	}
-	//On repasse sur la table des pages du processus.
-	load_page_table(get_current_process_page_table());
-	
-	//On reactive les interruptions.
-	ENABLE_IRQ();
-	
-	//Restauration du contexte d'execution et retour .
-	__asm("ldmfd sp!, {r0-r12, pc}^");
+	syscall_table[numeroAppelSysteme](pile);
+	//Au retour, swi_handler restaure le contexte de current_process, qui a pu changer.
 }
 
-void do_sys_reboot()
+void do_sys_reboot(int* pile)
 {
 	#if RPI
 		Set32(PM_WDOG, PM_PASSWORD | 1);
@@ -308,14 +337,14 @@ void do_sys_reboot()
 	#endif
 }
 
-void do_sys_nop()
+void do_sys_nop(int* pile)
 {
 	//Ne fait rien.
 }
 
 void do_sys_settime(int* pile)
 {
-	//on recupere la date dans la pile de swi_handler.
+	//on recupere la date dans les registres R1 et R2.
 	uint32_t date_lowbits = pile[1];
     uint32_t date_highbits = pile[2];
     uint64_t date_ms = date_highbits;
@@ -331,8 +360,8 @@ void do_sys_gettime(int* pile)
 	//On recupère la date depuis la librairie hw.
 	uint64_t date_ms = get_date_ms();
 	//On separe la date en deux entiers de 32bits.
-	//On met les bits de poids faibles dans la pile de swi_handler dans la case de R0.
-	//On met les bits de poids forts dans la pile de swi_handler dans la case de R1.
+	//On met les bits de poids faibles dans la case de R0.
+	//On met les bits de poids forts dans la case de R1.
 	pile[0] = date_ms & (0x0FFFFFFFF);
 	pile[1] = date_ms >> 32;
 }
@@ -346,11 +375,13 @@ void do_sys_create_process(int* pile)
 {
 	func_t* entry;
 	int32_t niceness;
+	uint32_t stack_size;
 	struct pcb_s* process;
 	//On recupere les arguments depuis la pile.
 	entry = (func_t*)pile[1];
 	niceness = (int32_t)pile[2];
-	process = create_process(entry, niceness);
+	stack_size = (uint32_t)pile[3];
+	process = create_process(entry, niceness, stack_size);
 	//On retourne la PCB par le registre R0 de la pile.
 	pile[0] = (int)process;
 }
@@ -369,15 +400,22 @@ void do_sys_process_return_code(int* pile)
 	pile[0] = (int)process->returnCode;
 }
 
+void do_sys_process_page_faults(int* pile)
+{
+	struct pcb_s* process = (struct pcb_s*)pile[1];
+	//On retourne le nombre de pages projetees a la demande par le registre R0 de la pile.
+	pile[0] = (int)process->page_fault_count;
+}
+
 void do_sys_malloc(int* pile)
 {
 	uint8_t* address;
 	uint32_t size = (uint32_t)pile[1];
 	//On recupère le tas et la table des pages du processus courant.
-	MemoryBlock* process_heap = get_current_process_heap();
+	Heap* process_heap = get_current_process_heap();
 	uint32_t* process_page_table = get_current_process_page_table();
 	//On alloue le bloc pour le processus courant.
-	address = heap_alloc(process_heap, process_page_table, size);
+	address = heap_alloc(process_heap, process_page_table, get_current_process_vmas(), size);
 	//On retourne l'adresse du bloc alloué.
 	pile[0] = (int)address;
 }
@@ -385,10 +423,11 @@ void do_sys_malloc(int* pile)
 void do_sys_free(int* pile)
 {
 	void* address = (void*)pile[1];
-	//On recupère le tas du processus courant.
-	MemoryBlock* process_heap = get_current_process_heap();
+	//On recupère le tas et la table des pages du processus courant.
+	Heap* process_heap = get_current_process_heap();
+	uint32_t* process_page_table = get_current_process_page_table();
 	//On libère ce bloc.
-	heap_free(process_heap, address);
+	heap_free(process_heap, process_page_table, get_current_process_vmas(), address);
 }
 
 void do_sys_fork(int* pile)
@@ -396,4 +435,74 @@ void do_sys_fork(int* pile)
 	struct pcb_s* child = fork_current_process(pile);
 	//On retourne l'adresse de la pcb de l'enfant.
 	pile[0] = (int)child;
-}
\ No newline at end of file
+}
+
+void do_sys_sbrk(int* pile)
+{
+	struct pcb_s* process = get_current_process();
+	uint8_t* old_break = process->brk;
+	uint8_t* new_break = old_break + pile[1];
+	//Les pages projetees vont jusqu'a la page qui contient le break.
+	uint32_t old_end = aligned_value((uint32_t)old_break, 12);
+	uint32_t new_end = aligned_value((uint32_t)new_break, 12);
+
+	//La premiere page de la zone est celle de l'etat de malloc.
+	if ((uint32_t)new_break < USER_BREAK_START + PAGE_SIZE || (uint32_t)new_break > USER_BREAK_END)
+	{
+		pile[0] = -1;
+		return;
+	}
+	if (new_end > old_end)
+	{
+		//Les pages sont seulement reservees, elles seront projetees au premier acces.
+		uint8_t* pages = vmem_alloc_for_userland(process->page_table, process->vmas, new_end - old_end, old_end, UP, VMA_BREAK);
+		if (pages != (uint8_t*)old_end)
+		{
+			if (pages != NULL)
+			{
+				vmem_free(process->page_table, process->vmas, pages, new_end - old_end);
+			}
+			pile[0] = -1;
+			return;
+		}
+	}
+	else if (new_end < old_end)
+	{
+		vmem_free(process->page_table, process->vmas, (uint8_t*)new_end, old_end - new_end);
+	}
+	process->brk = new_break;
+	//On retourne l'ancien break.
+	pile[0] = (int)old_break;
+}
+
+void do_sys_mmap(int* pile)
+{
+	uint32_t size = (uint32_t)pile[1];
+	//On reserve les pages au-dessus de USER_MMAP_START, sous la pile.
+	pile[0] = (int)vmem_alloc_for_userland(get_current_process_page_table(), get_current_process_vmas(), size, USER_MMAP_START, UP, VMA_MMAP);
+}
+
+void do_sys_munmap(int* pile)
+{
+	uint8_t* address = (uint8_t*)pile[1];
+	uint32_t size = (uint32_t)pile[2];
+	//Seules les projections de sys_mmap peuvent etre liberees : la plage doit etre
+	//entierement dans une zone VMA_MMAP, la pile qui est au-dessus ne peut pas etre touchee.
+	Vma* area = vma_find(get_current_process_vmas(), (uint32_t)address);
+	if (area != NULL && area->kind == VMA_MMAP && size > 0 && size <= UINT32_MAX - (uint32_t)address
+		&& ((uint32_t)address + size - 1) / PAGE_SIZE < area->end_page)
+	{
+		vmem_free(get_current_process_page_table(), get_current_process_vmas(), address, size);
+	}
+}
+
+void do_sys_madvise(int* pile)
+{
+	uint8_t* address = (uint8_t*)pile[1];
+	uint32_t size = (uint32_t)pile[2];
+	//Les pages restent reservees, seules leurs frames sont rendues.
+	if ((uint32_t)address >= USER_SPACE_START && size > 0)
+	{
+		vmem_release(get_current_process_page_table(), address, size);
+	}
+}
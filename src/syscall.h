@@ -13,11 +13,23 @@ void sys_yieldto(struct pcb_s* dest);
 void sys_yield();
 void sys_exit(int status);
 int sys_wait(struct pcb_s* dest);
-struct pcb_s* sys_create_process(func_t* entry, int32_t niceness);
+struct pcb_s* sys_wait_any(int* status);
+struct pcb_s* sys_create_process(func_t* entry, int32_t niceness, uint32_t stack_size);
 ProcessState sys_process_state(struct pcb_s* process);
 int sys_process_return_code(struct pcb_s* process);
+uint32_t sys_process_page_faults(struct pcb_s* process);
 void* sys_malloc(uint32_t size);
 void sys_free(void* address);
+//Cree une copie du processus. Le pere recoit la PCB de l'enfant, l'enfant recoit 0,
+//et le pere recoit FORK_FAILED si l'enfant n'a pas pu etre cree.
 struct pcb_s* sys_fork();
+//Deplace le break du processus de increment octets et retourne l'ancien, (void*)-1 en cas d'erreur.
+void* sys_sbrk(int32_t increment);
+//Reserve des pages, projetees au premier acces. Retourne NULL si elles ne peuvent pas etre trouvees.
+void* sys_mmap(uint32_t size);
+//Libere des pages reservees par sys_mmap.
+void sys_munmap(void* address, uint32_t size);
+//Rend les frames des pages entieres de la zone. Elles sont remplies de 0 a leur prochain acces.
+void sys_madvise(void* address, uint32_t size);
 
 #endif
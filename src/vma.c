@@ -0,0 +1,269 @@
+#include "vma.h"
+#include "vmem.h"
+#include "slab.h"
+#include "config.h"
+
+//La premiere page de l'espace utilisateur, et la page qui suit la derniere page.
+#define VMA_FIRST_PAGE (USER_SPACE_START / PAGE_SIZE)
+#define VMA_END_PAGE ((UINT32_MAX / PAGE_SIZE) + 1)
+
+//----------------------------------------------------Variables globales
+
+//Les ensembles de zones des processus.
+SlabCache vma_cache = SLAB_CACHE(sizeof(VmaSet), 4, 0);
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Retourne l'index de la premiere zone qui finit apres une page, par dichotomie.
+ * C'est la zone qui contient la page, ou la premiere zone au-dessus.
+ * Retourne set->count si toutes les zones finissent avant la page.
+ */
+uint32_t vma_lower_bound(const VmaSet* set, uint32_t page);
+
+/**
+ * Decale les zones a partir d'un index, d'une case vers la fin ou vers le debut.
+ */
+void vma_shift_up(VmaSet* set, uint32_t index);
+void vma_shift_down(VmaSet* set, uint32_t index);
+
+/**
+ * Indique si deux zones contigues peuvent etre fusionnees.
+ */
+int vma_mergeable(const Vma* area, VmaKind kind, uint32_t page_flags);
+
+//----------------------------------------------------------Realisations
+uint32_t vma_lower_bound(const VmaSet* set, uint32_t page)
+{
+	uint32_t low = 0;
+	uint32_t high = set->count;
+
+	while (low < high)
+	{
+		uint32_t middle = (low + high) / 2;
+		if (set->areas[middle].end_page <= page)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+void vma_shift_up(VmaSet* set, uint32_t index)
+{
+	for (uint32_t i = set->count;i > index;i--)
+	{
+		set->areas[i] = set->areas[i - 1];
+	}
+	set->count++;
+}
+
+void vma_shift_down(VmaSet* set, uint32_t index)
+{
+	for (uint32_t i = index;i + 1 < set->count;i++)
+	{
+		set->areas[i] = set->areas[i + 1];
+	}
+	set->count--;
+}
+
+int vma_mergeable(const Vma* area, VmaKind kind, uint32_t page_flags)
+{
+	return area->kind == kind && area->page_flags == page_flags;
+}
+
+VmaSet* vma_create()
+{
+	VmaSet* set = (VmaSet*)slab_alloc(&vma_cache);
+	if (set != FORBIDDEN_ADDRESS)
+	{
+		set->count = 0;
+	}
+	return set;
+}
+
+VmaSet* vma_clone(const VmaSet* source)
+{
+	VmaSet* set = (VmaSet*)slab_alloc(&vma_cache);
+	if (set != FORBIDDEN_ADDRESS)
+	{
+		set->count = source->count;
+		for (uint32_t i = 0;i < source->count;i++)
+		{
+			set->areas[i] = source->areas[i];
+		}
+	}
+	return set;
+}
+
+void vma_destroy(VmaSet* set)
+{
+	slab_free(&vma_cache, set);
+}
+
+Vma* vma_find(VmaSet* set, uint32_t address)
+{
+	uint32_t page = address / PAGE_SIZE;
+	uint32_t index = vma_lower_bound(set, page);
+
+	if (index < set->count && set->areas[index].first_page <= page)
+	{
+		return &set->areas[index];
+	}
+	return NULL;
+}
+
+uint32_t vma_find_free(const VmaSet* set, uint32_t page_nb, uint32_t address, int direction)
+{
+	if (page_nb == 0 || page_nb > VMA_END_PAGE - VMA_FIRST_PAGE)
+	{
+		return UINT32_MAX;
+	}
+
+	if (direction >= 0)
+	{
+		//On part de la page de l'adresse, et on saute de zone en zone vers le haut.
+		uint32_t start = address / PAGE_SIZE;
+		if (start < VMA_FIRST_PAGE)
+		{
+			start = VMA_FIRST_PAGE;
+		}
+		uint32_t index = vma_lower_bound(set, start);
+		while (1)
+		{
+			//Le trou va de start au debut de la zone suivante.
+			uint32_t gap_end = VMA_END_PAGE;
+			if (index < set->count)
+			{
+				gap_end = set->areas[index].first_page;
+			}
+			if (gap_end >= start && gap_end - start >= page_nb)
+			{
+				return start;
+			}
+			if (index == set->count)
+			{
+				return UINT32_MAX;
+			}
+			start = set->areas[index].end_page;
+			index++;
+		}
+	}
+	else
+	{
+		//Les pages doivent finir au plus a la page de l'adresse, on saute de zone en zone vers le bas.
+		uint32_t limit = address / PAGE_SIZE + 1;
+		int32_t index = vma_lower_bound(set, limit - 1);
+		if (index == (int32_t)set->count || set->areas[index].first_page >= limit)
+		{
+			index--;
+		}
+		while (1)
+		{
+			//Le trou va de la fin de la zone precedente a limit.
+			uint32_t gap_start = VMA_FIRST_PAGE;
+			if (index >= 0 && set->areas[index].end_page > VMA_FIRST_PAGE)
+			{
+				gap_start = set->areas[index].end_page;
+			}
+			if (limit >= gap_start && limit - gap_start >= page_nb)
+			{
+				return limit - page_nb;
+			}
+			if (index < 0)
+			{
+				return UINT32_MAX;
+			}
+			if (set->areas[index].first_page < limit)
+			{
+				limit = set->areas[index].first_page;
+			}
+			index--;
+		}
+	}
+}
+
+int vma_insert(VmaSet* set, uint32_t first_page, uint32_t page_nb, VmaKind kind, uint32_t page_flags)
+{
+	uint32_t end_page = first_page + page_nb;
+	//La zone se place avant la premiere zone qui finit apres elle.
+	uint32_t index = vma_lower_bound(set, first_page);
+	int merge_previous = index > 0
+		&& set->areas[index - 1].end_page == first_page
+		&& vma_mergeable(&set->areas[index - 1], kind, page_flags);
+	int merge_next = index < set->count
+		&& set->areas[index].first_page == end_page
+		&& vma_mergeable(&set->areas[index], kind, page_flags);
+
+	if (merge_previous && merge_next)
+	{
+		set->areas[index - 1].end_page = set->areas[index].end_page;
+		vma_shift_down(set, index);
+	}
+	else if (merge_previous)
+	{
+		set->areas[index - 1].end_page = end_page;
+	}
+	else if (merge_next)
+	{
+		set->areas[index].first_page = first_page;
+	}
+	else
+	{
+		if (set->count == VMA_MAX)
+		{
+			return 0;
+		}
+		vma_shift_up(set, index);
+		set->areas[index].first_page = first_page;
+		set->areas[index].end_page = end_page;
+		set->areas[index].kind = kind;
+		set->areas[index].page_flags = page_flags;
+	}
+
+	return 1;
+}
+
+int vma_remove(VmaSet* set, uint32_t first_page, uint32_t page_nb)
+{
+	uint32_t end_page = first_page + page_nb;
+	uint32_t index = vma_lower_bound(set, first_page);
+
+	while (index < set->count && set->areas[index].first_page < end_page)
+	{
+		Vma* area = &set->areas[index];
+		if (area->first_page < first_page && area->end_page > end_page)
+		{
+			//Les pages sont au milieu de la zone : on la coupe en deux.
+			if (set->count == VMA_MAX)
+			{
+				return 0;
+			}
+			vma_shift_up(set, index + 1);
+			set->areas[index + 1] = *area;
+			set->areas[index + 1].first_page = end_page;
+			area->end_page = first_page;
+			return 1;
+		}
+		else if (area->first_page < first_page)
+		{
+			area->end_page = first_page;
+			index++;
+		}
+		else if (area->end_page > end_page)
+		{
+			area->first_page = end_page;
+			index++;
+		}
+		else
+		{
+			vma_shift_down(set, index);
+		}
+	}
+
+	return 1;
+}
@@ -0,0 +1,102 @@
+#ifndef VMA_H
+#define VMA_H
+
+#include <inttypes.h>
+
+//Le nombre maximal de zones d'un processus.
+//Les zones voisines de meme nature sont fusionnees, il en faut peu.
+#define VMA_MAX 63
+
+//-----------------------------------------------------------------Types
+//La nature d'une zone de l'espace utilisateur.
+//Une page de garde est sous chaque pile : elle n'est jamais projetee.
+enum VmaKind
+{
+    VMA_STACK, VMA_GUARD, VMA_HEAP, VMA_BREAK, VMA_MMAP
+};
+typedef enum VmaKind VmaKind;
+
+/**
+ * Une zone de pages consecutives de l'espace utilisateur.
+ * Les bornes sont en numeros de page pour que la derniere page de l'espace
+ * d'adressage ait une fin representable.
+ */
+struct Vma
+{
+	//La premiere page de la zone et la page qui suit sa derniere page.
+	uint32_t first_page;
+	uint32_t end_page;
+	VmaKind kind;
+	//Les flags des descripteurs de niveau 2 des pages de la zone.
+	uint32_t page_flags;
+};
+typedef struct Vma Vma;
+
+/**
+ * Les zones d'un processus, triees par adresse et sans chevauchement.
+ * Toute page reservee ou projetee de l'espace utilisateur est dans une zone :
+ * les recherches de pages libres et le classement d'une adresse fautive se font
+ * par dichotomie sur les zones, sans parcourir la table des pages.
+ */
+struct VmaSet
+{
+	uint32_t count;
+	Vma areas[VMA_MAX];
+};
+typedef struct VmaSet VmaSet;
+
+//---------------------------------------------------Fonctions publiques
+/**
+ * Alloue un ensemble de zones vide.
+ * @return L'ensemble, ou FORBIDDEN_ADDRESS si le tas noyau est plein.
+ */
+VmaSet* vma_create();
+
+/**
+ * Alloue une copie d'un ensemble de zones, pour fork.
+ * @param source L'ensemble a copier.
+ * @return La copie, ou FORBIDDEN_ADDRESS si le tas noyau est plein.
+ */
+VmaSet* vma_clone(const VmaSet* source);
+
+/**
+ * Libere un ensemble de zones. Les pages ne sont pas touchees.
+ */
+void vma_destroy(VmaSet* set);
+
+/**
+ * Retrouve la zone qui contient une adresse, en O(log n).
+ * @param set Les zones du processus.
+ * @param address L'adresse cherchee.
+ * @return La zone, NULL si l'adresse n'est dans aucune zone.
+ */
+Vma* vma_find(VmaSet* set, uint32_t address);
+
+/**
+ * Recherche page_nb pages consecutives hors de toute zone, dans l'espace utilisateur.
+ * La premiere zone concernee est trouvee en O(log n), puis seuls les trous entre
+ * les zones suivantes sont examines.
+ * @param set Les zones du processus.
+ * @param page_nb Le nombre de pages.
+ * @param address Vers le haut, l'adresse a partir de laquelle chercher.
+ * Vers le bas, l'adresse que les pages ne doivent pas depasser.
+ * @param direction UP pour les pages les plus basses possible, DOWN pour les plus hautes.
+ * @return La premiere page trouvee, UINT32_MAX s'il n'y a pas assez de pages libres.
+ */
+uint32_t vma_find_free(const VmaSet* set, uint32_t page_nb, uint32_t address, int direction);
+
+/**
+ * Ajoute une zone, qui ne doit chevaucher aucune autre zone.
+ * Elle est fusionnee avec ses voisines contigues de meme nature et de memes flags.
+ * @return 1 si la zone est ajoutee, 0 si l'ensemble est plein.
+ */
+int vma_insert(VmaSet* set, uint32_t first_page, uint32_t page_nb, VmaKind kind, uint32_t page_flags);
+
+/**
+ * Retire des pages des zones qui les contiennent. Une zone peut etre coupee en deux.
+ * @return 1 si les pages sont retirees, 0 si l'ensemble est plein et qu'une zone
+ * ne peut pas etre coupee : elle est alors gardee entiere.
+ */
+int vma_remove(VmaSet* set, uint32_t first_page, uint32_t page_nb);
+
+#endif
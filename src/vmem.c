@@ -6,19 +6,143 @@
 #include "util.h"
 #include "syscall.h"
 #include "fb.h"
+#include "config.h"
+#include "memory.h"
+#include "dma.h"
+#include "swap.h"
+
+//Bits du registre de controle : cache de donnees (C), prediction de branchement (Z) et cache d'instructions (I).
+#define CONTROL_CACHES ((1 << 2) | (1 << 11) | (1 << 12))
+
+//Bit FA (Force AP) du registre de controle : AP[0] devient le bit d'acces des pages.
+#define CONTROL_FORCE_AP (1 << 29)
+
+//Au-dela de ce nombre de pages, vmem_free invalide la TLB par ASID plutot que page par page.
+#define TLB_INVALIDATE_BY_PAGE_MAX 16
+//Le nombre de parcours de vmem_touch quand le swap evince des pages pendant le parcours.
+#define TOUCH_ATTEMPTS 4
 
 //La table des pages du noyau.
 uint32_t* mmu_table_base;
 
+//Les frames remplies de 0 a l'avance, marquees FRAME_ZEROED.
+//La reserve garde une projection sur chacune pour qu'elle ne retourne pas a l'allocateur.
+uint32_t zeroed_frames[ZEROED_POOL_SIZE];
+uint32_t zeroed_frame_count;
+//Le nombre de frames prises dans la reserve, et remplies de 0 pendant une erreur de page.
+uint32_t zeroed_hit_count;
+uint32_t zeroed_miss_count;
+//Le nombre d'appels a l'horloge du swap, faute de frame libre.
+uint32_t reclaim_count;
+
+//La table des pages chargee dans TTBR1 et l'ASID correspondant.
+const uint32_t* loaded_page_table;
+uint32_t loaded_asid;
+
+//La generation courante des ASID, dans les bits au-dessus de ASID_BITS.
+uint32_t asid_generation = ASID_COUNT;
+//Le prochain ASID a attribuer dans cette generation.
+uint32_t next_asid = 1;
+
+//Decodage du registre DFSR : le type de l'erreur et le sens de l'acces.
+#define DFSR_STATUS(dfsr) (((dfsr) & 0xF) | (((dfsr) >> 6) & 0x10))
+#define DFSR_WRITE (1 << 11)
+//Erreur de traduction sur une section (pas de table de niveau 2),
+//erreur de traduction et erreur de permission sur une page de 4ko.
+#define FAULT_TRANSLATION_SECTION 0x5
+#define FAULT_TRANSLATION_PAGE 0x7
+#define FAULT_PERMISSION_PAGE 0xF
+//Acces a une page dont le bit d'acces est nul.
+#define FAULT_ACCESS_FLAG_PAGE 0x6
+
+//-----------------------------------------------------Fonctions privees
+/**
+ * Traite une ecriture sur une page partagee en copie sur ecriture.
+ * Si la frame n'est plus partagee, la page repasse simplement en ecriture,
+ * sinon elle est copiee dans une nouvelle frame.
+ * @param page_table La table des pages du processus fautif, chargee dans TTBR1.
+ * @param address L'adresse de l'ecriture.
+ * @return 1 si l'erreur a ete traitee, 0 si ce n'est pas une page en copie sur ecriture.
+ */
+int vmem_cow_fault(uint32_t* page_table, uint32_t address);
+
+/**
+ * Traite le premier acces a une page reservee : une frame remplie de 0 lui est donnee.
+ * @param page_table La table des pages du processus fautif, chargee dans TTBR1.
+ * @param address L'adresse de l'acces.
+ * @return 1 si l'erreur a ete traitee, 0 si l'adresse n'est pas reservee ou s'il n'y a plus de frame.
+ */
+int vmem_demand_fault(uint32_t* page_table, uint32_t address);
+
+/**
+ * Traite le premier acces a une page vieillie par l'horloge du swap : son bit d'acces est remis.
+ * @param page_table La table des pages du processus fautif, chargee dans TTBR1.
+ * @param address L'adresse de l'acces.
+ * @return 1 si l'erreur a ete traitee, 0 si l'adresse n'est pas projetee.
+ */
+int vmem_access_fault(uint32_t* page_table, uint32_t address);
+
+/**
+ * Traite l'acces a une page evincee : elle est relue du swap dans une nouvelle frame.
+ * @param page_table La table des pages du processus fautif, chargee dans TTBR1.
+ * @param address L'adresse de l'acces.
+ * @return 1 si l'erreur a ete traitee, 0 si la page n'est pas dans le swap,
+ * s'il n'y a plus de frame ou si la carte n'a pas pu la relire.
+ */
+int vmem_swap_fault(uint32_t* page_table, uint32_t address);
+
+/**
+ * Traite un acces a une page de la zone de pile qui n'est pas encore reservee :
+ * la pile grandit, la page est reservee avec les flags de la zone puis projetee.
+ * @param page_table La table des pages du processus fautif, chargee dans TTBR1.
+ * @param area La zone de pile qui contient l'adresse.
+ * @param address L'adresse fautive.
+ * @return 1 si la page est projetee, 0 sinon.
+ */
+int vmem_stack_fault(uint32_t* page_table, const Vma* area, uint32_t address);
+
+/**
+ * Prend une frame dans la reserve des frames remplies de 0.
+ * La frame garde la projection de la reserve, a retirer une fois la frame projetee.
+ * @return La frame, UINT32_MAX si la reserve est vide.
+ */
+uint32_t vmem_take_zeroed_frame();
+
+/**
+ * Retourne le numero d'une frame libre, pour une page de l'espace utilisateur.
+ * Si l'allocateur est vide, des pages peu utilisees sont evincees dans le swap.
+ * @return La frame, UINT32_MAX s'il n'y a plus de frame et que rien ne peut etre evince.
+ */
+uint32_t vmem_find_free_frame();
+
+/**
+ * Prepare une page de l'espace utilisateur a un acces du noyau, pour vmem_touch.
+ * @return 1 si la page est accessible, 0 sinon.
+ */
+int vmem_touch_page(uint32_t* page_table, uint32_t page, int write);
+
+/**
+ * Retire de la TLB les traductions d'une plage de pages dont les descripteurs ont change.
+ * Le cache de donnees est etiquete physiquement : les lignes des frames liberees restent
+ * valides pour leur prochaine projection. Le controleur DMA, qui ne passe pas par le cache,
+ * le vide lui-meme avant chaque transfert (voir dma.c).
+ * @param page_table La table des pages qui contenait les pages.
+ * @param first_page La premiere page de la plage.
+ * @param page_nb Le nombre de pages de la plage.
+ */
+void vmem_invalidate_pages(uint32_t* page_table, uint32_t first_page, uint32_t page_nb);
+
 void start_mmu_C()
 {
 	register uint32_t control;
-	__asm("mcr p15, 0, %[zero], c1, c0, 0" : : [zero] "r"(0)); // Disable cache 
-	__asm("mcr p15, 0, r0, c7, c7, 0 "); // Invalidate cache ( data and instructions )
-	__asm("mcr p15, 0, r0, c8, c7, 0 "); // Invalidate TLB entries 
+	__asm volatile("mcr p15, 0, %[zero], c1, c0, 0" : : [zero] "r"(0)); // Disable cache
+	__asm volatile("mcr p15, 0, %[zero], c7, c7, 0" : : [zero] "r"(0)); // Invalidate cache ( data and instructions )
+	__asm volatile("mcr p15, 0, %[zero], c7, c5, 6" : : [zero] "r"(0)); // Invalidate branch target buffer
+	__asm volatile("mcr p15, 0, %[zero], c8, c7, 0" : : [zero] "r"(0)); // Invalidate TLB entries
 	
-	/* Enable ARMv6 MMU features ( disable sub - page AP ) */
-	control = (1<<23) | (1 << 15) | (1 << 4) | 1;
+	/* Enable ARMv6 MMU features ( disable sub - page AP ), the access bit (Force AP),
+	 * L1 data and instruction caches and branch prediction */
+	control = CONTROL_FORCE_AP | (1<<23) | (1 << 15) | CONTROL_CACHES | (1 << 4) | 1;
 	
 	/* Invalidate the translation lookaside buffer ( TLB ) */
 	__asm volatile("mcr p15, 0, %[data], c8, c7, 0" : : [data] "r" (0));
@@ -31,80 +155,58 @@ void configure_mmu_C()
 { 
 	register uint32_t* pt_addr = mmu_table_base;
 	
-	/* Translation table 0 */
+	/* Translation table 0 : the kernel, below USER_SPACE_START */
 	__asm volatile("mcr p15, 0, %[addr], c2, c0, 0" : : [addr] "r"(pt_addr));
 	
-	/* Translation table 1 */
+	/* Translation table 1 : the current process, nothing mapped until the first process is loaded */
 	__asm volatile("mcr p15, 0, %[addr], c2, c0, 1" : : [addr] "r"(pt_addr));
 	
-	/* Use translation table 0 for everything */
-	__asm volatile("mcr p15, 0, %[n], c2, c0, 2" : : [n] "r"(0));
+	/* Use translation table 1 above USER_SPACE_START */
+	__asm volatile("mcr p15, 0, %[n], c2, c0, 2" : : [n] "r"(TTBCR_N));
 	
 	/* Set Domain 0 ACL to " Manager ", not enforcing memory permissions
-	 * Every mapped section/page is in domain 0 */
-	__asm volatile("mcr p15, 0, %[r], c3, c0, 0" : : [r] "r" (0x3));
+	 * Every kernel section/page is in domain 0.
+	 * User pages are in USER_DOMAIN, a " Client " domain : permissions are
+	 * checked, so that copy-on-write pages fault on write */
+	__asm volatile("mcr p15, 0, %[r], c3, c0, 0" : : [r] "r" (0x3 | (0x1 << (2 * USER_DOMAIN))));
 }
 
 /*
  * Cette fonction initialise la table des pages de sorte à ce que les adresse
  * virtuelle située entre 0x0 et __kernel_heap_end__ renvoient vers les mêmes
  * adresses physique.
- * Dans cet intervalle, il y a 16 777 215 adresses. Une page contient 4096
- * adresses. On doit initialiser 4096 pages réparties dans 16 tables de niveau 2
- * et une table de niveau 1.
+ * Cet intervalle fait 16Mo, aligné sur 1Mo : il est projeté par 16 sections,
+ * sans table de niveau 2, et n'occupe que 16 entrées de la TLB au lieu de 4096.
  * Le même comportement est fait pour l'espace mémoire des devices. entre les
  * adresses DEVICE_SPACE_START et DEVICE_SPACE_END.
+ * Le framebuffer n'est en général pas aligné sur 1Mo : add_range_page_table
+ * utilise des grandes pages de 64ko et des sections là où il l'est.
  */
 uint32_t* init_kern_translation_table()
 {
 	uint32_t* page_table;
 
-	const uint32_t SECOND_LVL_TT_KERNEL_NB = ((uint32_t)&__kernel_heap_end__ + 1) / (SECOND_LVL_TT_COUNT*PAGE_SIZE);
-	const uint32_t SECOND_LVL_TT_DEVICES_START = DEVICE_SPACE_START / (SECOND_LVL_TT_COUNT*PAGE_SIZE);
-	const uint32_t SECOND_LVL_TT_DEVICES_END = (DEVICE_SPACE_END + 1) / (SECOND_LVL_TT_COUNT*PAGE_SIZE);
+	const uint32_t KERNEL_SIZE = (uint32_t)&__kernel_heap_end__ + 1;
 	const uint32_t FRAMEBUFFER_FIRST_FRAME = getAddressFB() / PAGE_SIZE;
 	const uint32_t FRAMEBUFFER_LAST_FRAME = (getAddressFB() + getSizeFB()) / PAGE_SIZE;
-	const uint32_t SECOND_LEVEL_FLAGS = 0x52;
-	const uint32_t SECOND_LEVEL_DEVICE_FLAGS = 0x17;
 
 	//On crée la table des pages du noyau.
 	page_table = create_page_table();
 
 	//On fait correspondre les adresses logiques du noyau aux adresses physiques pour la mémoire du noyau.
-	for (uint32_t first_level_index = 0;first_level_index < SECOND_LVL_TT_KERNEL_NB;first_level_index++)
-	{
-		//On initialise les entrées de cette table.
-		for (int second_level_index = 0;second_level_index < SECOND_LVL_TT_COUNT;second_level_index++)
-		{
-			//On calcule le debut de la frame en fonction des index de niveau 1 et de niveau 2 pour avoir les mêmes adresses logiques et physiques.
-			uint32_t frame_address = first_level_index*SECOND_LVL_TT_COUNT*PAGE_SIZE + second_level_index*PAGE_SIZE;
-			//On ajoute cette frame à la table des pages.
-			add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_FLAGS);
-		}
-	}
-	
-	//On fait correspondre les adresses logiques et physiques du framebuffer de l'écran.
-	for (uint32_t frame = FRAMEBUFFER_FIRST_FRAME;frame <= FRAMEBUFFER_LAST_FRAME;frame++)
+	add_range_page_table(page_table, 0, 0, KERNEL_SIZE, SECOND_LEVEL_FLAGS);
+
+	//On fait correspondre les adresses logiques et physiques du framebuffer de l'écran,
+	//hors cache pour que le GPU voie les pixels.
+	//Sans framebuffer, ses pages tomberaient dans les sections du noyau.
+	if (getSizeFB() > 0 && getAddressFB() >= KERNEL_SIZE)
 	{
-		uint32_t first_level_index = frame / SECOND_LVL_TT_COUNT;
-        uint32_t second_level_index = frame - first_level_index * SECOND_LVL_TT_COUNT;
-        uint32_t frame_address = frame*PAGE_SIZE;
-        //On ajoute cette frame à la table des pages.
-		add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_FLAGS);
+		add_range_page_table(page_table, FRAMEBUFFER_FIRST_FRAME * PAGE_SIZE, FRAMEBUFFER_FIRST_FRAME * PAGE_SIZE,
+			(FRAMEBUFFER_LAST_FRAME + 1 - FRAMEBUFFER_FIRST_FRAME) * PAGE_SIZE, SECOND_LEVEL_FRAMEBUFFER_FLAGS);
 	}
 
 	//On fait correspondre les adresses logiques du noyau aux adresses physiques pour la partie mémoire des devices.
-	for (uint32_t first_level_index = SECOND_LVL_TT_DEVICES_START;first_level_index < SECOND_LVL_TT_DEVICES_END;first_level_index++)
-	{
-		//On initialise les entrées de cette table.
-		for (int second_level_index = 0;second_level_index < SECOND_LVL_TT_COUNT;second_level_index++)
-		{
-			//On calcule le debut de la frame en fonction des index de niveau 1 et de niveau 2 pour avoir les mêmes adresses logiques et physiques.
-			uint32_t frame_address = first_level_index*SECOND_LVL_TT_COUNT*PAGE_SIZE + second_level_index*PAGE_SIZE;
-			//On ajoute cette frame à la table des pages.
-			add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_DEVICE_FLAGS);
-		}
-	}
+	add_range_page_table(page_table, DEVICE_SPACE_START, DEVICE_SPACE_START, DEVICE_SPACE_END + 1 - DEVICE_SPACE_START, SECOND_LEVEL_DEVICE_FLAGS);
 
 	return page_table;
 }
@@ -116,168 +218,622 @@ void vmem_init()
 	configure_mmu_C();	
 	start_mmu_C();
 	timer_init();
+	dma_init();
+	//Sans carte SD ou sans partition de swap, aucune page n'est evincee.
+	swap_init();
 	ENABLE_AB();
+	//La reserve est pleine au demarrage.
+	vmem_refill_zeroed_frames(ZEROED_POOL_SIZE);
 }
 
 /**
  * Initialise une table de niveau 1 pour un processus.
- * Celle-ci correspond a la table du noyau pour les adresses de l'espace noyau et les adresses des devices.
+ * Seules les entrees au-dessus de USER_SPACE_START sont utilisees par la MMU :
+ * le noyau, le framebuffer et les devices sont projetes une seule fois par TTBR0.
  */
 uint32_t* init_process_translation_table()
 {
-	//Le nombre de frame pour mapper le noyau jusqu'au debut du tas du noyau.
-	const uint32_t KERNEL_FRAME_NB = ((uint32_t)&__kernel_heap_start__ + 1) / PAGE_SIZE;
-	const uint32_t SECOND_LVL_TT_DEVICES_START = DEVICE_SPACE_START / (SECOND_LVL_TT_COUNT*PAGE_SIZE);
-	const uint32_t SECOND_LVL_TT_DEVICES_END = (DEVICE_SPACE_END + 1) / (SECOND_LVL_TT_COUNT*PAGE_SIZE);
-	const uint32_t FRAMEBUFFER_FIRST_FRAME = getAddressFB() / PAGE_SIZE;
-	const uint32_t FRAMEBUFFER_LAST_FRAME = (getAddressFB() + getSizeFB()) / PAGE_SIZE;
-	const uint32_t SECOND_LEVEL_FLAGS = 0x52;
-	const uint32_t SECOND_LEVEL_DEVICE_FLAGS = 0x17;
+	//On crée la table des pages du processus, vide.
+	return create_page_table();
+}
 
-	//On crée la table des pages du processus.
-	uint32_t* page_table = create_page_table();
-	
-	//On fait correspondre les adresses logiques et physiques du noyau.
-	for (int frame = 0;frame < KERNEL_FRAME_NB;frame++)
+void load_kernel_page_table()
+{
+	//La table du noyau ne projette rien au-dessus de USER_SPACE_START : l'ASID 0 suffit.
+	load_page_table(mmu_table_base, 0);
+}
+
+void load_page_table(const uint32_t* table, uint32_t asid)
+{
+	//Les descripteurs sont nettoyes du cache a l'ecriture (page_table.c),
+	//on attend seulement que le write buffer les ait ecrits en memoire.
+	__asm volatile("mcr p15, 0, %[zero], c7, c10, 4" : : [zero] "r"(0) : "memory");
+	//On passe par l'ASID 0, que n'a aucun processus, le temps de changer de table :
+	//une traduction de la nouvelle table ne peut pas etre marquee par l'ancien ASID.
+	__asm volatile("mcr p15, 0, %[zero], c13, c0, 1" : : [zero] "r"(0) : "memory");
+	__asm volatile("mcr p15, 0, %[zero], c7, c5, 4" : : [zero] "r"(0) : "memory");
+	//On fait pointer la MMU sur la table des pages de ce processus.
+	//Le noyau (TTBR0) ne change jamais.
+	__asm volatile("mcr p15, 0, %[table], c2, c0, 1" : : [table] "r"(table) : "memory");
+	__asm volatile("mcr p15, 0, %[asid], c13, c0, 1" : : [asid] "r"(asid & ASID_MASK) : "memory");
+	//La prediction de branchement travaille sur les adresses virtuelles.
+	__asm volatile("mcr p15, 0, %[zero], c7, c5, 6" : : [zero] "r"(0) : "memory");
+	__asm volatile("mcr p15, 0, %[zero], c7, c5, 4" : : [zero] "r"(0) : "memory");
+	//Les caches sont etiquetes physiquement, il n'y a pas besoin de les vider.
+	//Les entrees de la TLB des autres processus restent valides, marquees par leur ASID.
+	loaded_page_table = table;
+	loaded_asid = asid & ASID_MASK;
+}
+
+uint32_t vmem_asid(uint32_t* context)
+{
+	//L'ASID est encore valide s'il a ete attribue dans la generation courante.
+	if ((*context & ~ASID_MASK) != asid_generation)
 	{
-		//On retrouve pour la frame, les index de niveau 1 et de niveau 2.
-		uint32_t first_level_index = frame / SECOND_LVL_TT_COUNT;
-		uint32_t second_level_index = frame - first_level_index * SECOND_LVL_TT_COUNT;
-		uint32_t frame_address = frame * PAGE_SIZE;
+		if (next_asid >= ASID_COUNT)
+		{
+			//Tous les ASID ont ete distribues : on commence une nouvelle generation.
+			//Les processus de l'ancienne recevront un nouvel ASID a leur prochain chargement.
+			asid_generation += ASID_COUNT;
+			//La generation 0 est reservee aux processus sans ASID.
+			if (asid_generation == 0)
+			{
+				asid_generation = ASID_COUNT;
+			}
+			next_asid = 1;
+			//Les anciens ASID vont etre reutilises, leurs entrees doivent disparaitre.
+			INVALIDATE_TLB();
+		}
+		*context = asid_generation | next_asid;
+		next_asid++;
+	}
+	return *context & ASID_MASK;
+}
+
+void vmem_set_caches(int enabled)
+{
+	uint32_t control;
 
-		add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_FLAGS);
+	__asm volatile("mrc p15, 0, %[control], c1, c0, 0" : [control] "=r"(control));
+	if (enabled)
+	{
+		//On part de caches propres avant de les activer.
+		__asm volatile("mcr p15, 0, %[zero], c7, c7, 0" : : [zero] "r"(0)); // Invalidate cache ( data and instructions )
+		__asm volatile("mcr p15, 0, %[zero], c7, c5, 6" : : [zero] "r"(0)); // Invalidate branch target buffer
+		control |= CONTROL_CACHES;
+		__asm volatile("mcr p15, 0, %[control], c1, c0, 0" : : [control] "r"(control) : "memory");
 	}
-	
-	//On fait correspondre les adresses logiques et physiques du framebuffer de l'écran.
-	for (uint32_t frame = FRAMEBUFFER_FIRST_FRAME;frame <= FRAMEBUFFER_LAST_FRAME;frame++)
+	else
 	{
-		uint32_t first_level_index = frame / SECOND_LVL_TT_COUNT;
-        uint32_t second_level_index = frame - first_level_index * SECOND_LVL_TT_COUNT;
-        uint32_t frame_address = frame*PAGE_SIZE;
-        //On ajoute cette frame à la table des pages.
-		add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_FLAGS);
+		//Les lignes modifiees doivent etre en memoire avant de couper le cache.
+		control &= ~CONTROL_CACHES;
+		clean_invalidate_data_cache();
+		__asm volatile("mcr p15, 0, %[control], c1, c0, 0" : : [control] "r"(control) : "memory");
+		invalidate_instruction_cache();
 	}
-	
-	//On fait correspondre les adresses logiques du noyau aux adresses physiques pour la partie mémoire des devices.
-	for (uint32_t first_level_index = SECOND_LVL_TT_DEVICES_START;first_level_index < SECOND_LVL_TT_DEVICES_END;first_level_index++)
+}
+
+uint8_t* vmem_alloc_for_userland(uint32_t* page_table, VmaSet* vmas, uint32_t size, uint32_t address, int direction, VmaKind kind)
+{
+	//On calcule le nombre de pages nécéssaires.
+	uint32_t page_nb = ((size - 1) / PAGE_SIZE) + 1;
+
+	//On recherche une plage de pages libres consécutives entre les zones du processus,
+	//qui sont toutes au-dessus de USER_SPACE_START.
+	uint32_t free_pages = vma_find_free(vmas, page_nb, address, direction);
+	if (free_pages == UINT32_MAX || !vma_insert(vmas, free_pages, page_nb, kind, SECOND_LEVEL_USER_FLAGS))
+	{
+		return NULL;
+	}
+	//On reserve les pages, sans frame : elles seront projetees au premier acces (voir vmem_demand_fault).
+	for (uint32_t page = free_pages;page < free_pages + page_nb;page++)
+	{
+		//On retrouve pour la page, les index de niveau 1 et de niveau 2.
+	    uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	    uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+
+	    if (!reserve_entry_page_table(page_table, first_level_index, second_level_index, SECOND_LEVEL_USER_FLAGS))
+	    {
+	        //Une table de niveau 2 n'a pas pu etre creee : on defait les pages deja reservees.
+	        vmem_free(page_table, vmas, (uint8_t*)(free_pages * PAGE_SIZE), page_nb * PAGE_SIZE);
+	        return NULL;
+	    }
+	}
+
+	//On retourne l'adresse de la page basse.
+	return (uint8_t*)(free_pages * PAGE_SIZE);
+}
+
+uint8_t* vmem_alloc_stack(uint32_t* page_table, VmaSet* vmas, uint32_t size)
+{
+	uint32_t page_nb = ((size - 1) / PAGE_SIZE) + 1;
+
+	//La page de garde est juste sous la zone de pile.
+	uint32_t guard_page = vma_find_free(vmas, page_nb + 1, UINT32_MAX, DOWN);
+	if (guard_page == UINT32_MAX || !vma_insert(vmas, guard_page, 1, VMA_GUARD, 0))
 	{
-		//On initialise les entrées de cette table.
-		for (int second_level_index = 0;second_level_index < SECOND_LVL_TT_COUNT;second_level_index++)
+		return NULL;
+	}
+	if (!vma_insert(vmas, guard_page + 1, page_nb, VMA_STACK, SECOND_LEVEL_USER_FLAGS))
+	{
+		vma_remove(vmas, guard_page, 1);
+		return NULL;
+	}
+	//Seule la page du haut, ou commence la pile, est reservee.
+	uint32_t top_page = guard_page + page_nb;
+	uint32_t first_level_index = top_page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = top_page - first_level_index * SECOND_LVL_TT_COUNT;
+	if (!reserve_entry_page_table(page_table, first_level_index, second_level_index, SECOND_LEVEL_USER_FLAGS))
+	{
+		vma_remove(vmas, guard_page, page_nb + 1);
+		return NULL;
+	}
+
+	return (uint8_t*)((guard_page + 1) * PAGE_SIZE);
+}
+
+uint8_t* vmem_map_frame(uint32_t frame)
+{
+	const uint32_t LAST_KERNEL_PAGE = ((uint32_t)&__kernel_heap_end__ + 1) / PAGE_SIZE;
+	uint32_t page = find_free_pages_page_table(mmu_table_base, 1, LAST_KERNEL_PAGE, UP);
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+
+	//Les copies et les remises a 0 des frames ne peuvent pas echouer : sans table de niveau 2, le noyau s'arrete.
+	if (!add_entry_page_table(mmu_table_base, first_level_index, second_level_index, frame * PAGE_SIZE, SECOND_LEVEL_FLAGS))
+	{
+		PANIC();
+	}
+	return (uint8_t*)(page * PAGE_SIZE);
+}
+
+void vmem_unmap_frame(uint8_t* address)
+{
+	uint32_t page = (uint32_t)address / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+
+	free_page_page_table(mmu_table_base, first_level_index, second_level_index);
+	//L'entree de la TLB de la page supprimee est globale.
+	invalidate_tlb_entry(address, 0);
+}
+
+void vmem_copy_frame(uint32_t destination_frame, uint32_t source_frame)
+{
+	//Le controleur DMA copie les frames par leurs adresses physiques, sans les projeter.
+	if (dma_copy(destination_frame * PAGE_SIZE, source_frame * PAGE_SIZE, PAGE_SIZE))
+	{
+		return;
+	}
+
+	//Sinon, on ajoute les deux frames à la table des pages du noyau.
+	uint8_t* source = vmem_map_frame(source_frame);
+	uint8_t* destination = vmem_map_frame(destination_frame);
+	//On effectue la copie entre les deux pages.
+	memcpy(destination, source, PAGE_SIZE);
+	//La copie est ecrite en memoire : la frame peut servir a une projection hors cache.
+	clean_data_cache_range(destination, PAGE_SIZE);
+	//On supprime les deux pages.
+	vmem_unmap_frame(source);
+	vmem_unmap_frame(destination);
+}
+
+void vmem_zero_frame(uint32_t frame)
+{
+	//On ajoute la frame à la table des pages du noyau.
+	uint8_t* page = vmem_map_frame(frame);
+	//On remplit la page de 0.
+	memset(page, 0, PAGE_SIZE);
+	clean_data_cache_range(page, PAGE_SIZE);
+	//On supprime la page.
+	vmem_unmap_frame(page);
+}
+
+int vmem_fork_userland(uint32_t* destination, uint32_t* source)
+{
+	int forked = 1;
+	for (uint32_t first_level_index = USER_FIRST_LVL_INDEX;forked && first_level_index < FIRST_LVL_TT_COUNT;first_level_index++)
+	{
+		//On saute d'un coup les tables de niveau 2 absentes.
+		if (source[first_level_index] == 0)
 		{
-			//On calcule le debut de la frame en fonction des index de niveau 1 et de niveau 2 pour avoir les mêmes adresses logiques et physiques.
-			uint32_t frame_address = first_level_index*SECOND_LVL_TT_COUNT*PAGE_SIZE + second_level_index*PAGE_SIZE;
-			//On ajoute cette frame à la table des pages.
-			add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_DEVICE_FLAGS);
+			continue;
+		}
+		for (uint32_t second_level_index = 0;second_level_index < SECOND_LVL_TT_COUNT;second_level_index++)
+		{
+			uint32_t descriptor = get_entry_page_table(source, first_level_index, second_level_index);
+			if (descriptor == 0)
+			{
+				continue;
+			}
+			//Une page reservee n'a pas encore de frame : le fils la reserve aussi.
+			//Une page evincee garde son emplacement dans le swap, tenu par les deux processus.
+			//La premiere entree d'une table de niveau 2 la cree : si elle echoue, rien n'est encore partage.
+			if (IS_RESERVED_DESCRIPTOR(descriptor) || IS_SWAPPED_DESCRIPTOR(descriptor))
+			{
+				if (!reserve_entry_page_table(destination, first_level_index, second_level_index, descriptor))
+				{
+					forked = 0;
+					break;
+				}
+				//L'entree du fils ne doit pas rendre un emplacement qu'il ne tient pas.
+				if (IS_SWAPPED_DESCRIPTOR(descriptor) && !swap_share_slot(SWAPPED_DESCRIPTOR_SLOT(descriptor)))
+				{
+					set_entry_page_table(destination, first_level_index, second_level_index, 0);
+					forked = 0;
+					break;
+				}
+				continue;
+			}
+			//Le fils partage la meme frame, dont le compteur d'occupation augmente.
+			if (!add_entry_page_table(destination, first_level_index, second_level_index,
+				(descriptor & 0xFFFFF000), (descriptor & 0xFFF) | SECOND_LEVEL_READ_ONLY))
+			{
+				forked = 0;
+				break;
+			}
+			//La page passe en lecture seule chez le pere.
+			if ((descriptor & SECOND_LEVEL_READ_ONLY) == 0)
+			{
+				descriptor |= SECOND_LEVEL_READ_ONLY;
+				set_entry_page_table(source, first_level_index, second_level_index, descriptor);
+			}
+			get_frame_descriptor(descriptor / PAGE_SIZE)->flags |= FRAME_COW;
 		}
 	}
-	
-	return page_table;
+
+	//Les traductions en ecriture du pere ne doivent plus etre utilisees,
+	//meme si le partage s'est arrete en cours de route.
+	if (source == loaded_page_table)
+	{
+		invalidate_tlb_asid(loaded_asid);
+	}
+	else
+	{
+		INVALIDATE_TLB();
+	}
+	return forked;
 }
 
-void load_kernel_page_table()
+int vmem_cow_fault(uint32_t* page_table, uint32_t address)
 {
-	load_page_table(mmu_table_base);
+	uint32_t page = address / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	if (address < USER_SPACE_START || !IS_MAPPED_DESCRIPTOR(descriptor) || (descriptor & SECOND_LEVEL_READ_ONLY) == 0)
+	{
+		return 0;
+	}
+
+	uint32_t frame = descriptor / PAGE_SIZE;
+	if (get_frame_occupancy_table(frame) <= 1)
+	{
+		//Les autres processus ont deja copie ou libere la page : elle n'est plus partagee.
+		set_entry_page_table(page_table, first_level_index, second_level_index, descriptor & ~SECOND_LEVEL_READ_ONLY);
+		FrameDescriptor* frame_descriptor = get_frame_descriptor(frame);
+		frame_descriptor->flags &= ~(FRAME_COW | FRAME_MERGED);
+		//Le processus en devient le proprietaire, pour que l'horloge du swap retrouve la page.
+		frame_descriptor->owner = page_table;
+		frame_descriptor->owner_page = page;
+	}
+	else
+	{
+		//On copie la page dans une nouvelle frame, qui n'appartient qu'a ce processus.
+		uint32_t new_frame = vmem_find_free_frame();
+		if (new_frame == UINT32_MAX)
+		{
+			return 0;
+		}
+		//La nouvelle frame est projetee avant la copie : sa projection temporaire
+		//dans la table du noyau ne doit pas la rendre a l'allocateur.
+		//L'ancienne frame reste projetee par les autres processus.
+		free_page_page_table(page_table, first_level_index, second_level_index);
+		add_entry_page_table(page_table, first_level_index, second_level_index, new_frame * PAGE_SIZE, (descriptor & 0xFFF) & ~SECOND_LEVEL_READ_ONLY);
+		vmem_copy_frame(new_frame, frame);
+	}
+	//L'ancienne traduction en lecture seule ne doit plus etre utilisee.
+	invalidate_tlb_entry((void*)(page * PAGE_SIZE), loaded_asid);
+	return 1;
 }
 
-void load_page_table(const uint32_t* table)
+void vmem_protect_page(uint32_t* page_table, uint32_t page)
 {
-	//On fait pointer la MMU sur la table des pages de ce processus.
-	__asm volatile("mov	r0, %0" : : "r"(table));
-	__asm volatile("mcr p15, 0, r0, c2, c0, 0");
-	__asm volatile("mcr p15, 0, r0, c2, c0, 1");
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
 
-	INVALIDATE_TLB();
+	if (IS_MAPPED_DESCRIPTOR(descriptor) && (descriptor & SECOND_LEVEL_READ_ONLY) == 0)
+	{
+		set_entry_page_table(page_table, first_level_index, second_level_index, descriptor | SECOND_LEVEL_READ_ONLY);
+		vmem_invalidate_pages(page_table, page, 1);
+	}
 }
 
-uint8_t* vmem_alloc_for_userland(uint32_t* page_table, uint32_t size, uint32_t address, int direction)
+int vmem_share_frame(uint32_t* page_table, uint32_t page, uint32_t frame)
 {
-	const uint32_t SECOND_LEVEL_FLAGS = 0x52;
-	//On calcule le nombre de pages nécéssaires.
-	uint32_t page_nb = ((size - 1) / PAGE_SIZE) + 1;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+	int released = get_frame_occupancy_table(descriptor / PAGE_SIZE) == 1;
+
+	//L'ancienne frame perd sa projection : elle est rendue a l'allocateur si c'etait la derniere.
+	free_page_page_table(page_table, first_level_index, second_level_index);
+	add_entry_page_table(page_table, first_level_index, second_level_index, frame * PAGE_SIZE, (descriptor & 0xFFF) | SECOND_LEVEL_READ_ONLY);
+	get_frame_descriptor(frame)->flags |= FRAME_COW;
+	vmem_invalidate_pages(page_table, page, 1);
+	return released;
+}
+
+int vmem_age_page(uint32_t* page_table, uint32_t page)
+{
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	if (!IS_MAPPED_DESCRIPTOR(descriptor) || (descriptor & SECOND_LEVEL_ACCESSED) == 0)
+	{
+		return 0;
+	}
+	set_entry_page_table(page_table, first_level_index, second_level_index, descriptor & ~SECOND_LEVEL_ACCESSED);
+	//La traduction gardee dans la TLB ne verifierait plus le bit.
+	vmem_invalidate_pages(page_table, page, 1);
+	return 1;
+}
+
+int vmem_evict_page(uint32_t* page_table, uint32_t page, uint32_t slot)
+{
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
 
-	//On recherche une plage de pages libres consécutives.
-	uint32_t start_page = address / PAGE_SIZE;
-	uint32_t free_pages = find_free_pages_page_table(page_table, page_nb, start_page, direction);
-	//Si on a trouvé les pages libres.
-	if (free_pages < UINT32_MAX)
+	//L'emplacement remplace la frame dans la meme table de niveau 2 : sans elle, la page reste projetee.
+	if (!IS_MAPPED_DESCRIPTOR(descriptor))
 	{
-		//On alloue les pages avec des frames.
-		for (uint32_t page = free_pages;page < free_pages + page_nb;page++)
+		return 0;
+	}
+	//La frame perd sa seule projection et retourne a l'allocateur.
+	free_page_page_table(page_table, first_level_index, second_level_index);
+	//La page n'etait projetee que par ce processus : elle sera relue en ecriture.
+	//La table de niveau 2 existe deja, la reservation ne peut pas echouer.
+	reserve_entry_page_table(page_table, first_level_index, second_level_index,
+		SWAPPED_DESCRIPTOR(slot, descriptor & ~SECOND_LEVEL_READ_ONLY));
+	vmem_invalidate_pages(page_table, page, 1);
+	return 1;
+}
+
+uint32_t vmem_find_free_frame()
+{
+	uint32_t frame = find_free_frame_occupancy_table();
+	while (frame == UINT32_MAX)
+	{
+		//L'horloge peut vieillir ou evincer des pages de tous les processus, y compris le courant.
+		reclaim_count++;
+		if (swap_reclaim(SWAP_RECLAIM_BATCH) == 0)
 		{
-			//On retrouve pour la page, les index de niveau 1 et de niveau 2.
-		    uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
-		    uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
-
-		    //On trouve une frame libre.
-		    uint32_t frame = find_free_frame_occupancy_table();
-		    if (frame != UINT32_MAX)
-		    {
-	    		uint32_t frame_address = frame * PAGE_SIZE;
-	    		//On etablit le lien entre page et frame.
-				add_entry_page_table(page_table, first_level_index, second_level_index, frame_address, SECOND_LEVEL_FLAGS);
-		    }
-		    else
-		    {
-		    	//Il n'y a plus de frame libre.
-		    	///TODO: Libérer correctement la mémoire et retourner un pointeur null.
-		    	PANIC();
-		    }
+			return UINT32_MAX;
 		}
+		frame = find_free_frame_occupancy_table();
 	}
+	return frame;
+}
 
-	//On retourne l'adresse de la page basse.
-	return (uint8_t*)(free_pages * PAGE_SIZE);
+uint32_t vmem_take_zeroed_frame()
+{
+	if (zeroed_frame_count == 0)
+	{
+		return UINT32_MAX;
+	}
+	zeroed_frame_count--;
+	return zeroed_frames[zeroed_frame_count];
 }
 
-void* memcpy(void* destination, const void* source, uint32_t size)
+void vmem_refill_zeroed_frames(uint32_t frame_nb)
 {
-	const uint32_t* copy_source = (const uint32_t*)source;
-	uint32_t* copy_destination = (uint32_t*)destination;
-	//On copie 4 octets par 4.
-	for (uint32_t i = 0;i < size / 4;i++)
+	for (uint32_t i = 0;i < frame_nb && zeroed_frame_count < ZEROED_POOL_SIZE;i++)
 	{
-		copy_destination[i] = copy_source[i];
+		uint32_t frame = find_free_frame_occupancy_table();
+		if (frame == UINT32_MAX)
+		{
+			return;
+		}
+		//La projection de la reserve, qui survit a la projection temporaire de vmem_zero_frame.
+		set_frame_occupancy_table(frame, 1);
+		vmem_zero_frame(frame);
+		FrameDescriptor* descriptor = get_frame_descriptor(frame);
+		descriptor->flags |= FRAME_ZEROED;
+		descriptor->owner = NULL;
+		zeroed_frames[zeroed_frame_count] = frame;
+		zeroed_frame_count++;
 	}
+}
+
+int vmem_demand_fault(uint32_t* page_table, uint32_t address)
+{
+	uint32_t page = address / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
 
-	return destination;
+	if (address < USER_SPACE_START || !IS_RESERVED_DESCRIPTOR(descriptor))
+	{
+		return 0;
+	}
+
+	//Le processus ne doit pas lire les donnees d'un autre processus :
+	//on prend de preference une frame deja remplie de 0.
+	uint32_t frame = vmem_take_zeroed_frame();
+	if (frame != UINT32_MAX)
+	{
+		//Les flags ont ete gardes dans l'entree reservee.
+		add_entry_page_table(page_table, first_level_index, second_level_index, frame * PAGE_SIZE, descriptor | 0x2);
+		//La frame n'appartient plus qu'au processus.
+		set_frame_occupancy_table(frame, 0);
+		zeroed_hit_count++;
+		return 1;
+	}
+
+	frame = vmem_find_free_frame();
+	if (frame == UINT32_MAX)
+	{
+		return 0;
+	}
+	//La frame est projetee avant d'etre remplie, comme dans vmem_cow_fault.
+	add_entry_page_table(page_table, first_level_index, second_level_index, frame * PAGE_SIZE, descriptor | 0x2);
+	vmem_zero_frame(frame);
+	zeroed_miss_count++;
+	//L'erreur de traduction n'est pas gardee dans la TLB : il n'y a rien a invalider.
+	return 1;
 }
 
-void vmem_copy_frame(uint32_t destination_frame, uint32_t source_frame)
+int vmem_access_fault(uint32_t* page_table, uint32_t address)
 {
-	const uint32_t LAST_KERNEL_PAGE = ((uint32_t)&__kernel_heap_end__ + 1) / PAGE_SIZE;
-	const uint32_t SECOND_LEVEL_FLAGS = 0x52;
-	uint32_t source_page;
-	uint32_t source_first_level_index;
-	uint32_t source_second_level_index;
-	uint32_t destination_page;
-	uint32_t destination_first_level_index;
-	uint32_t destination_second_level_index;
-
-	//On ajoute les deux frames à la table des pages du noyau.
-	source_page = find_free_pages_page_table(mmu_table_base, 1, LAST_KERNEL_PAGE, UP);
-	source_first_level_index = source_page / SECOND_LVL_TT_COUNT;
-    source_second_level_index = source_page - source_first_level_index * SECOND_LVL_TT_COUNT;
-	add_entry_page_table(mmu_table_base, source_first_level_index, source_second_level_index, source_frame * PAGE_SIZE, SECOND_LEVEL_FLAGS);
-
-	destination_page = find_free_pages_page_table(mmu_table_base, 1, source_page, UP);
-	destination_first_level_index = destination_page / SECOND_LVL_TT_COUNT;
-    destination_second_level_index = destination_page - destination_first_level_index * SECOND_LVL_TT_COUNT;
-	add_entry_page_table(mmu_table_base, destination_first_level_index, destination_second_level_index, destination_frame * PAGE_SIZE, SECOND_LEVEL_FLAGS);
-	//On effectue la copie entre les deux pages.
-	memcpy((void*)(destination_page * PAGE_SIZE), (void*)(source_page * PAGE_SIZE), PAGE_SIZE);
-	//On supprime les deux pages.
-	free_page_page_table(mmu_table_base, source_first_level_index, source_second_level_index);
-	free_page_page_table(mmu_table_base, destination_first_level_index, destination_second_level_index);
-	//On invalide la TLB car deux pages ont été supprimées.
-	INVALIDATE_TLB();
+	uint32_t page = address / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	if (address < USER_SPACE_START || !IS_MAPPED_DESCRIPTOR(descriptor))
+	{
+		return 0;
+	}
+	set_entry_page_table(page_table, first_level_index, second_level_index, descriptor | SECOND_LEVEL_ACCESSED);
+	vmem_invalidate_pages(page_table, page, 1);
+	return 1;
+}
+
+int vmem_swap_fault(uint32_t* page_table, uint32_t address)
+{
+	uint32_t page = address / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	if (address < USER_SPACE_START || !IS_SWAPPED_DESCRIPTOR(descriptor))
+	{
+		return 0;
+	}
+	uint32_t frame = vmem_find_free_frame();
+	if (frame == UINT32_MAX)
+	{
+		return 0;
+	}
+	//La frame est comptee pendant la lecture, comme dans la reserve des frames nulles :
+	//sa projection temporaire dans le noyau ne la rend pas a l'allocateur.
+	set_frame_occupancy_table(frame, 1);
+	if (!swap_in(SWAPPED_DESCRIPTOR_SLOT(descriptor), frame))
+	{
+		set_frame_occupancy_table(frame, 0);
+		return 0;
+	}
+	//Les flags ont ete gardes dans l'entree, la page vient d'etre accedee.
+	add_entry_page_table(page_table, first_level_index, second_level_index, frame * PAGE_SIZE,
+		(descriptor & 0xFFC) | 0x2 | SECOND_LEVEL_ACCESSED);
+	set_frame_occupancy_table(frame, 0);
+	return 1;
+}
+
+int vmem_stack_fault(uint32_t* page_table, const Vma* area, uint32_t address)
+{
+	uint32_t page = address / PAGE_SIZE;
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+
+	//La nouvelle page peut demander une table de niveau 2 : sans elle, la pile ne grandit pas.
+	if (get_entry_page_table(page_table, first_level_index, second_level_index) == 0
+		&& !reserve_entry_page_table(page_table, first_level_index, second_level_index, area->page_flags))
+	{
+		return 0;
+	}
+	return vmem_demand_fault(page_table, address);
+}
+
+int vmem_touch_page(uint32_t* page_table, uint32_t page, int write)
+{
+	uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+	uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+	uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
+
+	//Une page reservee ou relue du swap est accedee et accessible en ecriture.
+	if (IS_RESERVED_DESCRIPTOR(descriptor))
+	{
+		return vmem_demand_fault(page_table, page * PAGE_SIZE);
+	}
+	if (IS_SWAPPED_DESCRIPTOR(descriptor))
+	{
+		return vmem_swap_fault(page_table, page * PAGE_SIZE);
+	}
+	if (!IS_MAPPED_DESCRIPTOR(descriptor))
+	{
+		return 0;
+	}
+	if ((descriptor & SECOND_LEVEL_ACCESSED) == 0)
+	{
+		vmem_access_fault(page_table, page * PAGE_SIZE);
+	}
+	if (write && (descriptor & SECOND_LEVEL_READ_ONLY))
+	{
+		return vmem_cow_fault(page_table, page * PAGE_SIZE);
+	}
+	return 1;
+}
+
+int vmem_touch(uint32_t* page_table, const void* address, uint32_t size, int write)
+{
+	uint32_t first_page = (uint32_t)address / PAGE_SIZE;
+	uint32_t last_page = ((uint32_t)address + size - 1) / PAGE_SIZE;
+
+	//Une frame prise pour une page a pu vieillir ou evincer une page deja preparee :
+	//le parcours est refait tant que l'horloge du swap a ete appelee pendant le parcours.
+	for (uint32_t attempt = 0;attempt < TOUCH_ATTEMPTS;attempt++)
+	{
+		uint32_t reclaim_before = reclaim_count;
+		for (uint32_t page = first_page;page <= last_page;page++)
+		{
+			if (!vmem_touch_page(page_table, page, write))
+			{
+				return 0;
+			}
+		}
+		if (reclaim_count == reclaim_before)
+		{
+			return 1;
+		}
+	}
+	return 0;
 }
 
-void vmem_free(uint32_t* page_table, uint8_t* address, uint32_t size)
+void vmem_invalidate_pages(uint32_t* page_table, uint32_t first_page, uint32_t page_nb)
+{
+	//Les entrees de la TLB de ces pages sont marquees par l'ASID du processus.
+	//On ne le connait que si sa table est chargee, sinon on vide toute la TLB.
+	if (page_table != loaded_page_table)
+	{
+		INVALIDATE_TLB();
+	}
+	else if (page_nb > TLB_INVALIDATE_BY_PAGE_MAX)
+	{
+		invalidate_tlb_asid(loaded_asid);
+	}
+	else
+	{
+		for (uint32_t page = first_page;page < first_page + page_nb;page++)
+		{
+			invalidate_tlb_entry((void*)(page * PAGE_SIZE), loaded_asid);
+		}
+	}
+}
+
+void vmem_free(uint32_t* page_table, VmaSet* vmas, uint8_t* address, uint32_t size)
 {
 	//On retouve la page de debut en fonction de l'adresse.
 	uint32_t first_page = (uint32_t)address / PAGE_SIZE;
 	//On calcule le nombre de pages nécéssaires.
 	uint32_t page_nb = ((size - 1) / PAGE_SIZE) + 1;
+	//Si la zone ne peut pas etre coupee, elle reste entiere : ses pages liberees
+	//ne sont simplement plus proposees par vma_find_free.
+	vma_remove(vmas, first_page, page_nb);
 	//On desalloue les pages.
 	for (uint32_t page = first_page;page < first_page + page_nb;page++)
 	{
@@ -287,40 +843,116 @@ void vmem_free(uint32_t* page_table, uint8_t* address, uint32_t size)
 
 	    free_page_page_table(page_table, first_level_index, second_level_index);
 	}
+	//La MMU ne doit plus utiliser les anciennes traductions.
+	vmem_invalidate_pages(page_table, first_page, page_nb);
 }
 
-void __attribute__((naked)) data_handler()
+uint32_t vmem_release(uint32_t* page_table, uint8_t* address, uint32_t size)
 {
-	int* pile;
-	uint32_t fault_cause;
-	uint32_t fault_address;
+	//Seules les pages entierement dans la zone sont rendues.
+	uint32_t first_page = ((uint32_t)address + PAGE_SIZE - 1) / PAGE_SIZE;
+	uint32_t end_page = ((uint32_t)address + size) / PAGE_SIZE;
+	uint32_t released = 0;
 
-	DISABLE_IRQ();
-	//Sauvegarde du contexte d'execution.
-	__asm("stmfd sp!, {r0-r12, lr}");
-	//Memorisation du sommet de pile pour lecture des parametres.
-	__asm("mov %0, sp" : "=r"(pile));
+	for (uint32_t page = first_page;page < end_page;page++)
+	{
+		uint32_t first_level_index = page / SECOND_LVL_TT_COUNT;
+		uint32_t second_level_index = page - first_level_index * SECOND_LVL_TT_COUNT;
+		uint32_t descriptor = get_entry_page_table(page_table, first_level_index, second_level_index);
 
-	//On passe sur la table de traduction du noyau.
-	load_kernel_page_table();
+		if (page < USER_SPACE_START / PAGE_SIZE)
+		{
+			continue;
+		}
+		//Le contenu d'une page evincee est oublie : son emplacement dans le swap est rendu.
+		if (IS_SWAPPED_DESCRIPTOR(descriptor))
+		{
+			free_page_page_table(page_table, first_level_index, second_level_index);
+			reserve_entry_page_table(page_table, first_level_index, second_level_index, descriptor & 0xFFC);
+			continue;
+		}
+		//Les pages deja reservees n'ont pas de frame a rendre.
+		if (!IS_MAPPED_DESCRIPTOR(descriptor))
+		{
+			continue;
+		}
+		//La frame n'est plus comptee pour ce processus, les autres la gardent.
+		//La page sera une copie privee a son prochain acces : elle n'est plus en lecture seule.
+		free_page_page_table(page_table, first_level_index, second_level_index);
+		reserve_entry_page_table(page_table, first_level_index, second_level_index,
+			((descriptor & 0xFFF) & ~SECOND_LEVEL_READ_ONLY) | SECOND_LEVEL_ACCESSED);
+		released++;
+	}
+	//Il n'y a rien a invalider si toutes les pages etaient deja reservees.
+	if (released > 0)
+	{
+		vmem_invalidate_pages(page_table, first_page, end_page - first_page);
+	}
+	return released;
+}
 
-	//On lit les informations de l'erreur mémoire.
-	__asm("mrc p15, 0, %0, c5, c0, 0" : "=r"(fault_cause));
-	__asm("mrc p15, 0, %0, c6, c0, 0" : "=r"(fault_address));
+void data_handler_C(int* pile)
+{
+	uint32_t fault_cause;
+	uint32_t fault_address;
 
-	//On passe en mode SVC pour le changement de contexte.
-	__asm("cps 0x13");
-	//On quitte le processus courant.
-	exit_process(pile);
-	//On reviens au précédent mode d'exécution.
-	__asm("cps 0x17");
+	//data_handler (context.s) a deja sauvegarde le contexte dans la PCB.
 
-	//On repasse sur la table des pages du processus suivant.
-	load_page_table(get_current_process_page_table());
+	//On lit les informations de l'erreur mémoire.
+	__asm volatile("mrc p15, 0, %0, c5, c0, 0" : "=r"(fault_cause));
+	__asm volatile("mrc p15, 0, %0, c6, c0, 0" : "=r"(fault_address));
+	//Le noyau ne doit jamais fauter (voir vmem_touch) : SAVE_CONTEXT a deja ecrase
+	//les registres du processus avec ceux du noyau, le processus ne peut pas reprendre.
+	if ((get_current_process()->cpsr & 0x1F) != USER_MODE)
+	{
+		PANIC();
+	}
+	//Une adresse hors des zones du processus est invalide, sans parcourir sa table des pages.
+	//La page de garde d'une pile n'est jamais projetee : la pile a deborde.
+	Vma* area = vma_find(get_current_process()->vmas, fault_address);
+	if (area != NULL && area->kind == VMA_GUARD)
+	{
+		area = NULL;
+	}
 
-	//On reactive le timer.
-	ENABLE_TIMER_IRQ();
+	//La pile grandit d'une page, jusqu'a sa page de garde.
+	if (area != NULL && area->kind == VMA_STACK
+		&& (DFSR_STATUS(fault_cause) == FAULT_TRANSLATION_SECTION || DFSR_STATUS(fault_cause) == FAULT_TRANSLATION_PAGE)
+		&& vmem_stack_fault(get_current_process_page_table(), area, fault_address))
+	{
+		get_current_process()->page_fault_count++;
+		return;
+	}
+	//Un premier acces a une page reservee : on lui donne une frame,
+	//et au retour le processus reexecute l'instruction fautive.
+	if (area != NULL && DFSR_STATUS(fault_cause) == FAULT_TRANSLATION_PAGE
+		&& vmem_demand_fault(get_current_process_page_table(), fault_address))
+	{
+		get_current_process()->page_fault_count++;
+		return;
+	}
+	//Un acces a une page vieillie par l'horloge du swap : elle est marquee accedee.
+	if (area != NULL && DFSR_STATUS(fault_cause) == FAULT_ACCESS_FLAG_PAGE
+		&& vmem_access_fault(get_current_process_page_table(), fault_address))
+	{
+		return;
+	}
+	//Un acces a une page evincee : elle est relue du swap.
+	if (area != NULL && DFSR_STATUS(fault_cause) == FAULT_TRANSLATION_PAGE
+		&& vmem_swap_fault(get_current_process_page_table(), fault_address))
+	{
+		get_current_process()->page_fault_count++;
+		return;
+	}
+	//Une ecriture sur une page partagee par fork : on la copie.
+	if (area != NULL && DFSR_STATUS(fault_cause) == FAULT_PERMISSION_PAGE && (fault_cause & DFSR_WRITE)
+		&& vmem_cow_fault(get_current_process_page_table(), fault_address))
+	{
+		get_current_process()->cow_fault_count++;
+		return;
+	}
 
-	//Restauration du contexte d'execution et retour .
-	__asm("ldmfd sp!, {r0-r12, pc}^");
+	//Sinon l'acces est invalide, on quitte le processus courant.
+	//Au retour, data_handler restaure le contexte du processus suivant.
+	exit_process(pile);
 }
@@ -3,6 +3,7 @@
 
 #include <inttypes.h>
 #include "sched.h"
+#include "vma.h"
 
 //Direction de l'allocation en mémoire.
 #define UP 1
@@ -32,8 +33,54 @@
 //Adresse de fin des devices.
 #define DEVICE_SPACE_END 0x20FFFFFF
 
-//Taille de la table d'occupation des frames.
-#define FRAME_OCCUPANCY_TT_SIZE (DEVICE_SPACE_END + 1) / PAGE_SIZE
+//L'espace d'adressage est coupe en deux par TTBCR.N :
+//TTBR0 projette le noyau, commun a tous les processus, sous USER_SPACE_START,
+//TTBR1 projette l'espace utilisateur du processus courant au-dessus.
+#define TTBCR_N 1
+//Adresse de debut de l'espace utilisateur, 2^(32 - TTBCR_N).
+#define USER_SPACE_START 0x80000000
+//Index de niveau 1 de la premiere table de niveau 2 de l'espace utilisateur.
+#define USER_FIRST_LVL_INDEX (USER_SPACE_START / (SECOND_LVL_TT_COUNT * PAGE_SIZE))
+
+//Zone du break des processus (sys_sbrk), au-dessus du tas gere par le noyau.
+//Sa premiere page est reservee a la creation du processus pour l'etat de malloc (malloc.c).
+#define USER_BREAK_START 0xA0000000
+#define USER_BREAK_END 0xC0000000
+//Les projections de sys_mmap sont cherchees a partir de cette adresse.
+#define USER_MMAP_START 0xC0000000
+
+//Flags des descripteurs de niveau 2 (pages de 4ko, format ARMv6 sans sous-pages).
+//Memoire normale, cache write-back write-allocate (TEX=001, C=1, B=1).
+#define SECOND_LEVEL_FLAGS 0x5E
+//Memoire normale non cachee, les ecritures passent par le write buffer (TEX=001, C=0, B=0).
+#define SECOND_LEVEL_FRAMEBUFFER_FLAGS 0x52
+//Strongly-ordered et non executable (TEX=000, C=0, B=0, XN=1).
+#define SECOND_LEVEL_DEVICE_FLAGS 0x13
+
+//Les pages de l'espace utilisateur ne sont pas globales (nG) : leurs entrees
+//dans la TLB sont marquees par l'ASID du processus.
+#define SECOND_LEVEL_NOT_GLOBAL 0x800
+
+//Lecture et ecriture pour le noyau et les processus (AP=11).
+#define SECOND_LEVEL_AP_USER 0x30
+//Le bit d'acces, AP[0] : le bit FA (Force AP) du registre de controle est mis,
+//les droits ne dependent que de APX et AP[1], et l'acces a une page dont ce bit
+//est nul leve une erreur de bit d'acces. L'horloge du swap l'efface (voir vmem_age_page).
+#define SECOND_LEVEL_ACCESSED 0x10
+//Lecture seule pour tous (APX=1).
+//Les pages utilisateur en lecture seule sont toutes partagees en copie sur ecriture.
+#define SECOND_LEVEL_READ_ONLY 0x200
+//Les flags d'une page de l'espace utilisateur.
+#define SECOND_LEVEL_USER_FLAGS (SECOND_LEVEL_FLAGS | SECOND_LEVEL_AP_USER | SECOND_LEVEL_NOT_GLOBAL)
+
+//Les ASID sont sur 8 bits. L'ASID 0 n'est donne a aucun processus.
+#define ASID_BITS 8
+#define ASID_COUNT (1 << ASID_BITS)
+#define ASID_MASK (ASID_COUNT - 1)
+
+//Taille de la table des frames : une entrée par frame de la ram.
+//Les frames des devices ne sont jamais comptées.
+#define FRAME_OCCUPANCY_TT_SIZE ((RAM_LIMIT + 1) / PAGE_SIZE)
 
 /**
  * Initialise la mémoire virtuelle.
@@ -42,51 +89,196 @@ void vmem_init();
 
 /**
  * Initialise une table des pages pour un processus.
+ * Elle ne contient que l'espace utilisateur : les tables de niveau 2 du noyau,
+ * du framebuffer et des devices sont construites une seule fois dans la table
+ * du noyau, projetee pour tous les processus par TTBR0.
+ * @return La table, ou FORBIDDEN_ADDRESS si le tas noyau est plein.
  */
 uint32_t* init_process_translation_table();
 
 /**
- * Change la table des pages par celle du noyau.
+ * Retire l'espace utilisateur de la MMU.
+ * TTBR1 pointe sur la table du noyau, qui ne projette rien au-dessus de USER_SPACE_START.
  */
 void load_kernel_page_table();
 
 /**
- * Change la table des pages pointée par la MMU.
+ * Change la table des pages de l'espace utilisateur pointée par la MMU (TTBR1).
+ * La TLB n'est pas videe : ses entrees sont separees par ASID.
+ * @param table La table des pages du processus.
+ * @param asid L'ASID du processus, donne par vmem_asid.
+ */
+void load_page_table(const uint32_t* table, uint32_t asid);
+
+/**
+ * Retourne l'ASID d'un processus, en lui en attribuant un nouveau si le sien
+ * date d'une generation precedente.
+ * Quand les ASID sont epuises, on passe a la generation suivante et la TLB est videe.
+ * @param context Le champ asid de la PCB du processus.
+ * @return L'ASID a charger dans CONTEXTIDR.
+ */
+uint32_t vmem_asid(uint32_t* context);
+
+/**
+ * Active ou desactive les caches L1 et la prediction de branchement.
+ * Le cache de donnees est vide en memoire avant d'etre desactive.
+ * @param enabled 1 pour activer les caches, 0 pour les desactiver.
  */
-void load_page_table(const uint32_t* table);
+void vmem_set_caches(int enabled);
 
 /**
- * Alloue des pages en espace utilisateur.
- * 
+ * Alloue des pages en espace utilisateur, au-dessus de USER_SPACE_START.
+ * Les pages libres sont cherchees dans les zones du processus (vma_find_free),
+ * la nouvelle zone y est ajoutee.
+ * Si les pages ne peuvent pas etre trouvées ou reservées, retourne NULL.
+ * @param page_table La table des pages du processus.
+ * @param vmas Les zones du processus.
+ * @param size La taille a allouer, en octets.
+ * @param address L'adresse de depart de la recherche (voir vma_find_free).
+ * @param direction UP ou DOWN.
+ * @param kind La nature de la zone.
  */
-uint8_t* vmem_alloc_for_userland(uint32_t* page_table, uint32_t size, uint32_t address, int direction);
+uint8_t* vmem_alloc_for_userland(uint32_t* page_table, VmaSet* vmas, uint32_t size, uint32_t address, int direction, VmaKind kind);
 
 /**
- * Copie une zone de mémoire dans une autre zone.
- * Attention la copie doit faire au moins 4 octets.
- * @param destination L'adresse de destination.
- * @param source L'adresse source.
- * @param size La taille de la zone mémoire à copier.
- * @return La destination.
+ * Alloue la zone de pile d'un processus, le plus haut possible dans l'espace utilisateur.
+ * La zone est precedee d'une page de garde, et seule sa page du haut est reservee :
+ * les autres pages sont reservees a leur premier acces (voir data_handler_C).
+ * Une pile qui depasse sa taille maximale touche la page de garde, le processus est alors quitte.
+ * @param page_table La table des pages du processus.
+ * @param vmas Les zones du processus.
+ * @param size La taille maximale de la pile, en octets.
+ * @return L'adresse du bas de la zone de pile, au-dessus de la page de garde, NULL si
+ * la zone n'a pas pu etre allouee.
  */
-void* memcpy(void* destination, const void* source, uint32_t size);
+uint8_t* vmem_alloc_stack(uint32_t* page_table, VmaSet* vmas, uint32_t size);
+
+/**
+ * Projette temporairement une frame dans la table du noyau, au-dessus du tas noyau.
+ * La frame doit deja etre projetee ailleurs : vmem_unmap_frame retire une projection,
+ * une frame qui n'en aurait plus serait rendue a l'allocateur.
+ * @return L'adresse de la page projetee.
+ */
+uint8_t* vmem_map_frame(uint32_t frame);
+
+/**
+ * Retire une projection faite par vmem_map_frame.
+ */
+void vmem_unmap_frame(uint8_t* address);
 
 /**
  * Copie le contenu d'une frame dans une autre frame.
+ * La copie passe par le controleur DMA. S'il n'a pas de canal libre, les deux frames
+ * sont projetees temporairement dans la table du noyau et copiees par le processeur :
+ * une frame qui ne serait projetee nulle part ailleurs serait rendue a l'allocateur.
  */
 void vmem_copy_frame(uint32_t destination_frame, uint32_t source_frame);
 
+/**
+ * Remplit une frame de 0.
+ * Comme pour vmem_copy_frame, la frame doit deja etre projetee.
+ */
+void vmem_zero_frame(uint32_t frame);
+
+/**
+ * Remplit de 0 des frames libres pour la reserve de vmem_demand_fault, tant qu'elle n'est pas pleine.
+ * A appeler quand le processeur n'a rien d'autre a faire : les erreurs de page
+ * n'ont alors plus a remplir leur frame.
+ * @param frame_nb Le nombre maximal de frames a remplir.
+ */
+void vmem_refill_zeroed_frames(uint32_t frame_nb);
+
+/**
+ * Passe une page projetee de l'espace utilisateur en lecture seule.
+ * Si sa frame est partagee, elle sera copiee a sa premiere ecriture (voir vmem_cow_fault).
+ * @param page_table La table des pages, chargee ou non.
+ * @param page Le numero de la page.
+ */
+void vmem_protect_page(uint32_t* page_table, uint32_t page);
+
+/**
+ * Projette une page de l'espace utilisateur sur une frame deja projetee ailleurs,
+ * en lecture seule et en copie sur ecriture, comme apres fork.
+ * L'ancienne frame de la page perd une projection.
+ * @param page_table La table des pages, chargee ou non.
+ * @param page Le numero de la page, qui doit etre projetee.
+ * @param frame La frame a partager.
+ * @return 1 si l'ancienne frame a ete rendue a l'allocateur, 0 si elle reste projetee ailleurs.
+ */
+int vmem_share_frame(uint32_t* page_table, uint32_t page, uint32_t frame);
+
+/**
+ * Efface le bit d'acces d'une page projetee de l'espace utilisateur, pour l'horloge du swap.
+ * Le prochain acces a la page leve une erreur de bit d'acces, qui remet le bit.
+ * @param page_table La table des pages, chargee ou non.
+ * @param page Le numero de la page.
+ * @return 1 si la page avait ete accedee depuis que son bit a ete efface, 0 sinon.
+ */
+int vmem_age_page(uint32_t* page_table, uint32_t page);
+
+/**
+ * Remplace la projection d'une page de l'espace utilisateur par son emplacement dans le swap.
+ * Sa frame, dont le contenu a ete ecrit dans le swap, perd sa projection.
+ * La page est relue a son prochain acces.
+ * @param page_table La table des pages, chargee ou non.
+ * @param page Le numero de la page.
+ * @param slot L'emplacement de la page dans le swap.
+ * @return 1 si la page a ete evincee, 0 si elle n'etait pas projetee.
+ */
+int vmem_evict_page(uint32_t* page_table, uint32_t page, uint32_t slot);
+
+/**
+ * Partage toutes les pages de l'espace utilisateur d'un processus avec un autre,
+ * en copie sur ecriture : les pages passent en lecture seule dans les deux tables,
+ * et la frame n'est copiee qu'a la premiere ecriture (voir data_handler_C).
+ * Le cout depend du nombre d'entrees des tables, pas de la taille de la memoire.
+ * @param destination La table des pages, vide, du nouveau processus.
+ * @param source La table des pages du processus copie.
+ * @return 1 si toutes les pages ont ete partagees, 0 si une table de niveau 2 du fils n'a pas pu etre creee,
+ * ou si une frame ou un emplacement du swap est deja partage UINT16_MAX fois.
+ * Les pages deja partagees restent projetees par le fils : sa table doit alors etre liberee.
+ */
+int vmem_fork_userland(uint32_t* destination, uint32_t* source);
+
+/**
+ * Prepare des pages de l'espace utilisateur a un acces du noyau :
+ * une page reservee recoit sa frame, une page evincee est relue du swap,
+ * une page vieillie est marquee accedee, une page en copie sur ecriture est copiee.
+ * Le noyau ne doit pas provoquer lui-meme ces erreurs, data_handler ne sauvegarde
+ * que le contexte du mode user.
+ * @param page_table La table des pages du processus, chargee dans TTBR1.
+ * @param address L'adresse de debut de la zone.
+ * @param size La taille de la zone, en octets.
+ * @param write 1 si le noyau va ecrire dans la zone, 0 s'il ne fait que la lire.
+ * @return 1 si toutes les pages sont accessibles, 0 sinon.
+ */
+int vmem_touch(uint32_t* page_table, const void* address, uint32_t size, int write);
+
 /**
  * Libère une plage de pages mémoires dans une table de pages.
  * @param page_table La table des pages dans laquelle libérer la mémoire.
+ * @param vmas Les zones du processus, dont la plage est retiree.
  * @param address L'adresse de début de la plage de pages.
  * @param size La taille de la mémoire à libérer.
  */
-void vmem_free(uint32_t* page_table, uint8_t* address, uint32_t size);
+void vmem_free(uint32_t* page_table, VmaSet* vmas, uint8_t* address, uint32_t size);
+
+/**
+ * Rend a l'allocateur les frames des pages entierement comprises dans une zone.
+ * Les pages restent reservees : elles recevront une frame remplie de 0 a leur prochain acces.
+ * Les pages evincees rendent leur emplacement dans le swap.
+ * Une frame partagee par fork reste projetee chez les autres processus.
+ * @param page_table La table des pages du processus.
+ * @param address L'adresse de début de la zone.
+ * @param size La taille de la zone, en octets.
+ * @return Le nombre de frames rendues.
+ */
+uint32_t vmem_release(uint32_t* page_table, uint8_t* address, uint32_t size);
 
 /**
- * Handler de l'évenement data abort.
+ * Handler de l'évenement data abort, appele par data_handler (context.s).
+ * @param pile Les registres sauvegardés du processus fautif.
  */
-void __attribute__((naked)) data_handler();
+void data_handler_C(int* pile);
 
 #endif
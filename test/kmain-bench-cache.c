@@ -0,0 +1,80 @@
+#include "stdint.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "sched.h"
+#include "kheap.h"
+#include "vmem.h"
+
+//Une grille du jeu de la vie, comme celles de kmain.c.
+#define WIDTH 64
+#define HEIGHT 48
+#define ROUND_NB 20
+
+int screen[HEIGHT * WIDTH];
+int buffer[HEIGHT * WIDTH];
+
+//Le cout de ROUND_NB tours, en ticks du timer systeme, sans puis avec les caches.
+uint32_t uncached_cost;
+uint32_t cached_cost;
+//Le registre de controle (SCTLR) pendant chaque mesure, pour ses bits C, Z et I.
+//QEMU ne simule pas les caches : seuls ces bits sont verifies, les couts sont seulement affiches.
+uint32_t uncached_control;
+uint32_t cached_control;
+
+void game_of_life_rounds()
+{
+    for (int i = 0;i < HEIGHT * WIDTH;i++)
+    {
+        screen[i] = (i % 3);
+    }
+
+    for (int tour = 0;tour < ROUND_NB;tour++)
+    {
+        for (int i = 0;i < HEIGHT;i++)
+        {
+            for (int j = 0;j < WIDTH;j++)
+            {
+                int living_cell_nb = 0;
+                for (int di = -1;di <= 1;di++)
+                {
+                    for (int dj = -1;dj <= 1;dj++)
+                    {
+                        int ic = i + di;
+                        int jc = j + dj;
+                        if (ic >= 0 && ic < HEIGHT && jc >= 0 && jc < WIDTH && (di != 0 || dj != 0))
+                        {
+                            living_cell_nb += (screen[ic*WIDTH + jc] == 1);
+                        }
+                    }
+                }
+                buffer[i*WIDTH + j] = (living_cell_nb == 3) || (screen[i*WIDTH + j] == 1 && living_cell_nb == 2);
+            }
+        }
+
+        for (int i = 0;i < HEIGHT * WIDTH;i++)
+        {
+            screen[i] = buffer[i];
+        }
+    }
+}
+
+void kmain( void )
+{
+    kheap_init();
+    //sched_init demarre la MMU, avec les caches.
+    sched_init();
+
+    vmem_set_caches(0);
+    __asm volatile("mrc p15, 0, %0, c1, c0, 0" : "=r"(uncached_control));
+    uint32_t start = Get32(CLO);
+    game_of_life_rounds();
+    uncached_cost = Get32(CLO) - start;
+
+    vmem_set_caches(1);
+    __asm volatile("mrc p15, 0, %0, c1, c0, 0" : "=r"(cached_control));
+    start = Get32(CLO);
+    game_of_life_rounds();
+    cached_cost = Get32(CLO) - start;
+
+    return;
+}
@@ -0,0 +1,162 @@
+#include "stdint.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "sched.h"
+#include "kheap.h"
+#include "memory.h"
+#include "dma.h"
+
+#define PAGE_NB 64
+//Une image de 640x480 pixels de 3 octets.
+#define IMAGE_PITCH (640 * 3)
+#define IMAGE_HEIGHT 480
+#define ROUND_NB 4
+
+extern uint32_t dma_started_count, dma_irq_count;
+
+uint8_t source[PAGE_NB * PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+uint8_t destination[PAGE_NB * PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+uint8_t image[IMAGE_PITCH * IMAGE_HEIGHT] __attribute__((aligned(32)));
+
+//Le cout de ROUND_NB copies de PAGE_NB pages : par le processeur, par une copie DMA
+//par page comme vmem_copy_frame, et par un seul transfert chainant toutes les pages.
+uint32_t cpu_copy_cost, dma_page_cost, dma_chain_cost;
+//Le cout de ROUND_NB remplissages de l'image a partir de sa premiere ligne.
+uint32_t cpu_fill_cost, dma_fill_cost;
+//1 si les copies et les remplissages du controleur sont exacts.
+uint32_t copy_ok, chain_ok, fill_ok;
+//Les transferts lances, et les fins de transfert recues par interruption.
+uint32_t started, irq_callbacks;
+
+void count_callback(DmaTransfer* transfer, void* argument)
+{
+    (*(volatile uint32_t*)argument)++;
+}
+
+void fill_source(uint8_t seed)
+{
+    for (uint32_t i = 0;i < sizeof(source);i++)
+    {
+        source[i] = (uint8_t)(i * 7 + seed);
+    }
+}
+
+uint32_t same(const uint8_t* a, const uint8_t* b, uint32_t size)
+{
+    for (uint32_t i = 0;i < size;i++)
+    {
+        if (a[i] != b[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint32_t rows_filled()
+{
+    for (uint32_t y = 1;y < IMAGE_HEIGHT;y++)
+    {
+        if (!same(image + y * IMAGE_PITCH, image, IMAGE_PITCH))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    //sched_init demarre la MMU et le controleur DMA.
+    sched_init();
+    uint32_t started_before = dma_started_count;
+
+    fill_source(1);
+    uint32_t start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        for (int page = 0;page < PAGE_NB;page++)
+        {
+            memcpy(destination + page * PAGE_SIZE, source + page * PAGE_SIZE, PAGE_SIZE);
+        }
+    }
+    cpu_copy_cost = Get32(CLO) - start;
+
+    fill_source(2);
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        for (int page = 0;page < PAGE_NB;page++)
+        {
+            dma_copy((uint32_t)(destination + page * PAGE_SIZE), (uint32_t)(source + page * PAGE_SIZE), PAGE_SIZE);
+        }
+    }
+    dma_page_cost = Get32(CLO) - start;
+    copy_ok = same(destination, source, sizeof(source));
+
+    //Les pages sont copiees dans l'ordre inverse : un bloc par page, dans un seul transfert.
+    fill_source(3);
+    DmaTransfer* transfer = dma_transfer_create();
+    for (int page = 0;page < PAGE_NB;page++)
+    {
+        dma_add_copy(transfer, (uint32_t)(destination + (PAGE_NB - 1 - page) * PAGE_SIZE), (uint32_t)(source + page * PAGE_SIZE), PAGE_SIZE);
+    }
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        dma_start(transfer, NULL, NULL);
+        dma_wait(transfer);
+    }
+    dma_chain_cost = Get32(CLO) - start;
+    dma_transfer_destroy(transfer);
+    chain_ok = 1;
+    for (int page = 0;page < PAGE_NB;page++)
+    {
+        chain_ok &= same(destination + (PAGE_NB - 1 - page) * PAGE_SIZE, source + page * PAGE_SIZE, PAGE_SIZE);
+    }
+
+    for (uint32_t x = 0;x < IMAGE_PITCH;x++)
+    {
+        image[x] = (uint8_t)x;
+    }
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        for (uint32_t y = 1;y < IMAGE_HEIGHT;y++)
+        {
+            memcpy(image + y * IMAGE_PITCH, image, IMAGE_PITCH);
+        }
+    }
+    cpu_fill_cost = Get32(CLO) - start;
+
+    memset(image + IMAGE_PITCH, 0, IMAGE_PITCH * (IMAGE_HEIGHT - 1));
+    //La premiere ligne est relue pour chaque ligne : la source a un pas de 0.
+    transfer = dma_transfer_create();
+    dma_add_2d(transfer, (uint32_t)(image + IMAGE_PITCH), IMAGE_PITCH, (uint32_t)image, 0, IMAGE_PITCH, IMAGE_HEIGHT - 1);
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        dma_start(transfer, NULL, NULL);
+        dma_wait(transfer);
+    }
+    dma_fill_cost = Get32(CLO) - start;
+    fill_ok = rows_filled();
+
+    //La fin d'un transfert lance sans l'attendre est signalee par l'interruption du canal.
+    volatile uint32_t callbacks = 0;
+    uint32_t irq_before = dma_irq_count;
+    ENABLE_IRQ();
+    dma_start(transfer, count_callback, (void*)&callbacks);
+    start = Get32(CLO);
+    while (callbacks == 0 && Get32(CLO) - start < 100000)
+    {
+    }
+    DISABLE_IRQ();
+    irq_callbacks = (dma_irq_count != irq_before) ? callbacks : 0;
+    dma_wait(transfer);
+    dma_transfer_destroy(transfer);
+    started = dma_started_count - started_before;
+
+    return;
+}
@@ -0,0 +1,53 @@
+#include "stdint.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "syscall.h"
+
+#define UPTIME_NB 6
+#define CALL_NB 1000
+
+//Les uptimes simulés, en millisecondes : 1s, 1h, 1 jour, 1 an, 100 ans, 10000 ans.
+const uint64_t uptimes_ms[UPTIME_NB] = {
+    1000ULL,
+    3600000ULL,
+    86400000ULL,
+    31536000000ULL,
+    3153600000000ULL,
+    315360000000000ULL
+};
+
+//Le cout de CALL_NB conversions, en ticks du timer systeme, pour chaque uptime.
+uint32_t conversion_cost[UPTIME_NB];
+//Le cout de CALL_NB appels a sys_gettime.
+uint32_t gettime_cost;
+
+void kmain( void )
+{
+    volatile uint64_t date;
+
+    //On convertit des compteurs de plus en plus grands, comme le fait get_date_ms.
+    for (int u = 0;u < UPTIME_NB;u++)
+    {
+        uint64_t ticks = uptimes_ms[u] * SYS_TIMER_CLOCK_div_1000;
+        uint32_t start = Get32(CLO);
+        for (int i = 0;i < CALL_NB;i++)
+        {
+            date = timer_ticks_to_ms(ticks + i);
+        }
+        conversion_cost[u] = Get32(CLO) - start;
+    }
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    //Le cout complet d'un appel systeme pour l'uptime reel.
+    uint32_t start = Get32(CLO);
+    for (int i = 0;i < CALL_NB;i++)
+    {
+        date = sys_gettime();
+    }
+    gettime_cost = Get32(CLO) - start;
+
+    date++; // suppress compiler error
+    return;
+}
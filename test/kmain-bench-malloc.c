@@ -0,0 +1,71 @@
+#include "stdint.h"
+#include "util.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "malloc.h"
+
+#define PAIR_NB 1000
+#define BLOCK_SIZE 32
+
+struct pcb_s* bench;
+
+//Le cout de PAIR_NB allocations et liberations, en ticks du timer systeme.
+uint32_t sys_malloc_cost, malloc_cost;
+//Le nombre d'appels a sys_sbrk faits par malloc pendant la mesure.
+uint32_t sbrk_calls;
+//Passe a 1 si realloc perd le contenu ou si aligned_alloc n'aligne pas.
+int realloc_lost, misaligned;
+
+int bench_process()
+{
+    uint32_t start = Get32(CLO);
+    for (int i = 0;i < PAIR_NB;i++)
+    {
+        sys_free(sys_malloc(BLOCK_SIZE));
+    }
+    sys_malloc_cost = Get32(CLO) - start;
+
+    //Un premier bloc pour que la zone de malloc soit deja obtenue.
+    free(malloc(BLOCK_SIZE));
+    uint32_t sbrk_before = malloc_state()->sbrk_count;
+    start = Get32(CLO);
+    for (int i = 0;i < PAIR_NB;i++)
+    {
+        free(malloc(BLOCK_SIZE));
+    }
+    malloc_cost = Get32(CLO) - start;
+    sbrk_calls = malloc_state()->sbrk_count - sbrk_before;
+
+    int* numbers = (int*)malloc(4 * sizeof(int));
+    for (int i = 0;i < 4;i++)
+    {
+        numbers[i] = i;
+    }
+    numbers = (int*)realloc(numbers, 2 * MALLOC_SMALL_MAX);
+    realloc_lost = numbers[3] != 3;
+    free(numbers);
+
+    void* aligned = aligned_alloc(1024, 100);
+    misaligned = ((uint32_t)aligned & 1023) != 0;
+    free(aligned);
+
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    bench = create_process((func_t*)&bench_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(bench);
+
+    PANIC();
+}
@@ -0,0 +1,103 @@
+#include "stdint.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "sched.h"
+#include "kheap.h"
+#include "memory.h"
+
+#define BUFFER_SIZE (64 * 1024)
+#define ROUND_NB 16
+
+uint8_t source[BUFFER_SIZE + 32] __attribute__((aligned(32)));
+uint8_t destination[BUFFER_SIZE + 32] __attribute__((aligned(32)));
+
+//Le cout de ROUND_NB copies ou remplissages de BUFFER_SIZE octets, en ticks du timer systeme.
+uint32_t word_loop_cost, memcpy_cost, unaligned_cost, memmove_cost, memset_cost;
+//1 si le resultat de chaque fonction est exact.
+uint32_t memcpy_ok, unaligned_ok, memmove_ok, memset_ok;
+
+//L'ancienne copie, un mot par tour.
+void word_loop_copy(void* to, const void* from, uint32_t size)
+{
+    const uint32_t* copy_source = (const uint32_t*)from;
+    uint32_t* copy_destination = (uint32_t*)to;
+    for (uint32_t i = 0;i < size / 4;i++)
+    {
+        copy_destination[i] = copy_source[i];
+    }
+}
+
+void fill_source()
+{
+    for (uint32_t i = 0;i < sizeof(source);i++)
+    {
+        source[i] = (uint8_t)(i * 7 + 3);
+    }
+}
+
+uint32_t same(const uint8_t* a, const uint8_t* b, uint32_t size)
+{
+    for (uint32_t i = 0;i < size;i++)
+    {
+        if (a[i] != b[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+    fill_source();
+
+    uint32_t start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        word_loop_copy(destination, source, BUFFER_SIZE);
+    }
+    word_loop_cost = Get32(CLO) - start;
+
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        memcpy(destination, source, BUFFER_SIZE);
+    }
+    memcpy_cost = Get32(CLO) - start;
+    memcpy_ok = same(destination, source, BUFFER_SIZE);
+
+    //La source et la destination ne peuvent pas etre alignees ensemble, avec une queue de 3 octets.
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        memcpy(destination + 1, source + 2, BUFFER_SIZE - 1);
+    }
+    unaligned_cost = Get32(CLO) - start;
+    unaligned_ok = same(destination + 1, source + 2, BUFFER_SIZE - 1);
+
+    //Une copie vers le haut dans la meme zone, qui se fait depuis la fin.
+    memcpy(destination, source, BUFFER_SIZE + 32);
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        memmove(destination + 4, destination, BUFFER_SIZE);
+    }
+    memmove_cost = Get32(CLO) - start;
+    memmove_ok = same(destination + 4 * ROUND_NB, source, BUFFER_SIZE - 4 * ROUND_NB);
+
+    //Les octets de part et d'autre de la zone remplie ne doivent pas changer.
+    uint8_t before = destination[2];
+    uint8_t after = destination[BUFFER_SIZE + 3];
+    start = Get32(CLO);
+    for (int round = 0;round < ROUND_NB;round++)
+    {
+        memset(destination + 3, round, BUFFER_SIZE);
+    }
+    memset_cost = Get32(CLO) - start;
+    memset_ok = (destination[2] == before && destination[3] == ROUND_NB - 1
+        && destination[BUFFER_SIZE + 2] == ROUND_NB - 1 && destination[BUFFER_SIZE + 3] == after);
+
+    return;
+}
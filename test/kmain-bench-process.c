@@ -0,0 +1,72 @@
+#include "stdint.h"
+#include "util.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "slab.h"
+#include "page_table.h"
+#include "vmem.h"
+
+#define PROCESS_NB 100
+//Les tables privees construites pour comparaison, et leurs pages : 16Mo de noyau et 16Mo de devices.
+#define PRIVATE_TABLE_NB 10
+#define PRIVATE_PAGE_NB (2 * 4096)
+
+extern uint32_t first_level_table_count;
+extern SlabCache second_level_table_cache;
+
+//Le cout de PROCESS_NB creations et terminaisons, en ticks du timer systeme.
+uint32_t process_cost;
+//Le cout de PRIVATE_TABLE_NB tables qui projettent le noyau et les devices page par page,
+//comme chaque processus le faisait avant le partage des tables du noyau.
+uint32_t private_tables_cost;
+//Les tables de niveau 1 et de niveau 2 avant et apres la mesure.
+uint32_t first_level_before, first_level_after;
+uint32_t second_level_before, second_level_after;
+
+int child()
+{
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    first_level_before = first_level_table_count;
+    second_level_before = slab_cache_object_count(&second_level_table_cache);
+
+    uint32_t start = Get32(CLO);
+    for (int i = 0;i < PROCESS_NB;i++)
+    {
+        sys_wait(sys_create_process((func_t*)&child, 0, PROCESS_STACK_LIMIT));
+    }
+    process_cost = Get32(CLO) - start;
+
+    first_level_after = first_level_table_count;
+    second_level_after = slab_cache_object_count(&second_level_table_cache);
+
+    //Les frames du noyau ne sont pas comptees : les projeter dans l'espace utilisateur
+    //d'une table libre ensuite ne change rien a la table des frames.
+    const uint32_t KERNEL_PAGE_NB = ((uint32_t)&__kernel_heap_end__ + 1) / PAGE_SIZE;
+    start = Get32(CLO);
+    for (int i = 0;i < PRIVATE_TABLE_NB;i++)
+    {
+        uint32_t* page_table = create_page_table();
+        for (uint32_t page = 0;page < PRIVATE_PAGE_NB;page++)
+        {
+            add_entry_page_table(page_table, USER_FIRST_LVL_INDEX + page / SECOND_LVL_TT_COUNT, page % SECOND_LVL_TT_COUNT,
+                (page % KERNEL_PAGE_NB) * PAGE_SIZE, SECOND_LEVEL_FLAGS);
+        }
+        free_page_table(page_table);
+    }
+    private_tables_cost = Get32(CLO) - start;
+
+    PANIC();
+}
@@ -0,0 +1,87 @@
+#include "stdint.h"
+#include "util.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+
+//Chaque processus touche PAGE_NB pages de son tas entre deux changements de contexte.
+//Si la TLB est videe a chaque changement, chaque page coute un parcours de table.
+#define PAGE_NB 32
+#define ROUND_TRIP_NB 500
+
+struct pcb_s *ping, *pong;
+
+//Le cout de ROUND_TRIP_NB allers-retours, en ticks du timer systeme.
+uint32_t round_trip_cost;
+//La reference : les memes pages touchees et autant d'appels systeme, sans changement de contexte.
+uint32_t nop_cost;
+//Le nombre de fois ou pong a repris la main.
+volatile uint32_t pong_turns;
+
+void touch_pages(volatile uint32_t* pages)
+{
+    for (int page = 0;page < PAGE_NB;page++)
+    {
+        pages[page * PAGE_SIZE / sizeof(uint32_t)]++;
+    }
+}
+
+void ping_process()
+{
+    volatile uint32_t* pages = (volatile uint32_t*)sys_malloc(PAGE_NB * PAGE_SIZE);
+
+    //Un premier aller-retour pour que pong ait alloue ses pages.
+    touch_pages(pages);
+    sys_yieldto(pong);
+
+    uint32_t start = Get32(CLO);
+    for (int i = 0;i < ROUND_TRIP_NB;i++)
+    {
+        touch_pages(pages);
+        sys_yieldto(pong);
+    }
+    round_trip_cost = Get32(CLO) - start;
+
+    start = Get32(CLO);
+    for (int i = 0;i < ROUND_TRIP_NB;i++)
+    {
+        touch_pages(pages);
+        touch_pages(pages);
+        sys_nop();
+        sys_nop();
+    }
+    nop_cost = Get32(CLO) - start;
+
+    sys_reboot();
+}
+
+void pong_process()
+{
+    volatile uint32_t* pages = (volatile uint32_t*)sys_malloc(PAGE_NB * PAGE_SIZE);
+
+    while(1)
+    {
+        touch_pages(pages);
+        pong_turns++;
+        sys_yieldto(ping);
+    }
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    ping=create_process((func_t*)&ping_process, 0, PROCESS_STACK_LIMIT);
+    pong=create_process((func_t*)&pong_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_yieldto(ping);
+
+    // this is now unreachable
+    PANIC();
+}
@@ -0,0 +1,95 @@
+#include "stdint.h"
+#include "util.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+
+#define ROUND_TRIP_NB 1000
+
+struct pcb_s *ping, *pong;
+
+//Le cout de ROUND_TRIP_NB allers-retours, en ticks du timer systeme.
+//Un aller-retour fait deux appels systeme et deux changements de contexte.
+uint32_t round_trip_cost;
+//La reference : autant d'appels systeme sans changement de contexte (sys_nop).
+uint32_t nop_cost;
+//Le nombre de fois ou pong a repris la main.
+volatile uint32_t pong_turns;
+//Avant context.s, save_context et restore_context copiaient en C, a chaque changement
+//de contexte, r0-r12 et lr entre la pile du handler et la PCB : le cout de ces copies
+//pour les memes changements de contexte, mesure ici faute de pouvoir reprendre l'ancien chemin.
+uint32_t legacy_copy_cost;
+struct pcb_s legacy_pcb;
+
+void legacy_copies(volatile int* pile, volatile struct pcb_s* pcb)
+{
+    for (int i = 0;i < 13;i++)
+    {
+        pcb->registers[i] = pile[i];
+    }
+    pcb->lr_svc = (func_t*)pile[13];
+    for (int i = 0;i < 13;i++)
+    {
+        pile[i] = pcb->registers[i];
+    }
+    pile[13] = (int)pcb->lr_svc;
+}
+
+void ping_process()
+{
+    //Un premier aller-retour pour que pong soit deja lance.
+    sys_yieldto(pong);
+
+    uint32_t start = Get32(CLO);
+    for (int i = 0;i < ROUND_TRIP_NB;i++)
+    {
+        sys_yieldto(pong);
+    }
+    round_trip_cost = Get32(CLO) - start;
+
+    start = Get32(CLO);
+    for (int i = 0;i < ROUND_TRIP_NB;i++)
+    {
+        sys_nop();
+        sys_nop();
+    }
+    nop_cost = Get32(CLO) - start;
+
+    int pile[14] = {0};
+    start = Get32(CLO);
+    for (int i = 0;i < 2 * ROUND_TRIP_NB;i++)
+    {
+        legacy_copies(pile, &legacy_pcb);
+    }
+    legacy_copy_cost = Get32(CLO) - start;
+
+    sys_reboot();
+}
+
+void pong_process()
+{
+    while(1)
+    {
+        pong_turns++;
+        sys_yieldto(ping);
+    }
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    ping=create_process((func_t*)&ping_process, 0, PROCESS_STACK_LIMIT);
+    pong=create_process((func_t*)&pong_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_yieldto(ping);
+
+    // this is now unreachable
+    PANIC();
+}
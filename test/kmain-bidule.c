@@ -1,9 +1,9 @@
 #include "hw.h"
 
-
-void bidule()
+//noinline et l'asm vide : a -O2, gcc supprimerait les appels a une fonction vide.
+__attribute__((noinline)) void bidule()
 {
-    
+    __asm volatile("");
 }
 
 void kmain()
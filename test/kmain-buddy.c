@@ -0,0 +1,39 @@
+#include "sched.h"
+#include "kheap.h"
+#include "page_table.h"
+#include "util.h"
+
+//Un tampon de 16 frames consecutives et quelques frames isolees.
+#define BUFFER_ORDER 4
+#define SINGLE_FRAME_NB 3
+
+uint32_t free_before, free_allocated, free_after;
+uint32_t buffer, frames[SINGLE_FRAME_NB];
+//Passe a 1 si le tampon n'est pas aligne sur sa taille.
+int misaligned;
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    free_before = get_free_frame_count_occupancy_table();
+
+    buffer = find_free_frames_occupancy_table(BUFFER_ORDER);
+    misaligned = (buffer & ((1 << BUFFER_ORDER) - 1)) != 0;
+    for (int i = 0;i < SINGLE_FRAME_NB;i++)
+    {
+        frames[i] = find_free_frame_occupancy_table();
+    }
+    free_allocated = get_free_frame_count_occupancy_table();
+
+    //Les blocs liberes fusionnent avec leurs voisins.
+    for (int i = 0;i < SINGLE_FRAME_NB;i++)
+    {
+        release_frames_occupancy_table(frames[i], 0);
+    }
+    release_frames_occupancy_table(buffer, BUFFER_ORDER);
+    free_after = get_free_frame_count_occupancy_table();
+
+    PANIC();
+}
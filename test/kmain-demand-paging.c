@@ -0,0 +1,54 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "util.h"
+
+//Une grande grille, dont on ne touche que quelques pages.
+#define GRID_PAGE_NB 64
+#define TOUCHED_PAGE_NB 4
+
+struct pcb_s *grid, *wild;
+//Les pages projetees pendant l'allocation, puis apres avoir touche la grille.
+uint32_t faults_after_malloc, faults_after_touch;
+//Passe a 1 si le processus survit a un acces hors de ses zones.
+int wild_survived;
+
+int grid_process()
+{
+    uint8_t* cells = (uint8_t*)sys_malloc(GRID_PAGE_NB * PAGE_SIZE);
+    faults_after_malloc = sys_process_page_faults(grid);
+
+    //La premiere page porte l'etiquette du bloc, deja ecrite par le noyau.
+    for (int page = 1;page <= TOUCHED_PAGE_NB;page++)
+    {
+        cells[page * PAGE_SIZE] = 1;
+    }
+    faults_after_touch = sys_process_page_faults(grid);
+
+    return EXIT_SUCCESS;
+}
+
+int wild_process()
+{
+    //Cette adresse n'est ni dans le tas ni dans la pile.
+    *(volatile int*)0x90000000 = 1;
+    wild_survived = 1;
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    grid = create_process((func_t*)&grid_process, 0, PROCESS_STACK_LIMIT);
+    wild = create_process((func_t*)&wild_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(grid);
+    sys_wait(wild);
+
+    PANIC();
+}
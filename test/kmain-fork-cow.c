@@ -0,0 +1,72 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "util.h"
+
+#define VALUE_NB 2048
+
+//Les valeurs lues par le pere apres la fin du fils, et le code retour du fils.
+int parent_sum, parent_heap_block, child_status;
+
+int sum(int* values)
+{
+    int total = 0;
+    for (int i = 0;i < VALUE_NB;i++)
+    {
+        total += values[i];
+    }
+    return total;
+}
+
+int forking_process()
+{
+    //Le tableau occupe deux pages du tas.
+    int* values = (int*)sys_malloc(VALUE_NB * sizeof(int));
+    for (int i = 0;i < VALUE_NB;i++)
+    {
+        values[i] = 1;
+    }
+
+    struct pcb_s* child = sys_fork();
+    if (child == FORK_FAILED)
+    {
+        return EXIT_FAILURE;
+    }
+    if (child == 0)
+    {
+        //Le fils herite du contenu du tas et de ses blocs.
+        int total = sum(values);
+        //Il ecrit dans sa copie, le pere ne doit rien voir.
+        for (int i = 0;i < VALUE_NB;i++)
+        {
+            values[i] = 2;
+        }
+        //La somme est lue avant sys_free, qui peut rendre les pages du bloc.
+        total += sum(values);
+        sys_free(values);
+        return total;
+    }
+
+    child_status = sys_wait(child);
+    parent_sum = sum(values);
+    //Le bloc n'a ete libere que dans le tas du fils.
+    parent_heap_block = (int)sys_malloc(sizeof(int)) != (int)values;
+    return 0;
+}
+
+void kmain( void )
+{
+    struct pcb_s* process;
+
+    kheap_init();
+    sched_init();
+
+    process = create_process((func_t*)&forking_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+
+    PANIC();
+}
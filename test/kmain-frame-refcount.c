@@ -0,0 +1,49 @@
+#include "sched.h"
+#include "kheap.h"
+#include "page_table.h"
+#include "vmem.h"
+#include "util.h"
+
+//Autant de projections que le compteur de 16 bits peut en compter,
+//bien plus que n'en comptait l'ancienne table d'occupation sur 8 bits.
+#define MAPPING_NB UINT16_MAX
+
+uint32_t free_before, free_after;
+uint32_t shared_refcount, kernel_refcount;
+//Passe a 1 si la projection de trop est refusee.
+int refused;
+uint16_t kernel_flags;
+const uint32_t* shared_owner;
+uint32_t* page_table;
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    free_before = get_free_frame_count_occupancy_table();
+
+    //Une meme frame projetee dans MAPPING_NB pages de l'espace utilisateur.
+    page_table = create_page_table();
+    uint32_t frame = find_free_frame_occupancy_table();
+    for (uint32_t page = 0;page < MAPPING_NB;page++)
+    {
+        add_entry_page_table(page_table, USER_FIRST_LVL_INDEX + page / SECOND_LVL_TT_COUNT, page % SECOND_LVL_TT_COUNT,
+            frame * PAGE_SIZE, SECOND_LEVEL_USER_FLAGS);
+    }
+    shared_refcount = get_frame_occupancy_table(frame);
+    //Le compteur est plein : une projection de plus le ferait revenir a 0.
+    refused = !add_entry_page_table(page_table, USER_FIRST_LVL_INDEX + MAPPING_NB / SECOND_LVL_TT_COUNT,
+        MAPPING_NB % SECOND_LVL_TT_COUNT, frame * PAGE_SIZE, SECOND_LEVEL_USER_FLAGS);
+    shared_owner = get_frame_descriptor(frame)->owner;
+
+    //Le code du noyau est projete par ses sections, sans etre compte.
+    kernel_refcount = get_frame_occupancy_table(0x8000 / PAGE_SIZE);
+    kernel_flags = get_frame_descriptor(0x8000 / PAGE_SIZE)->flags;
+
+    //La frame est rendue a l'allocateur avec sa derniere projection.
+    free_page_table(page_table);
+    free_after = get_free_frame_count_occupancy_table();
+
+    PANIC();
+}
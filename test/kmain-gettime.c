@@ -6,7 +6,7 @@ void kmain( void )
     __asm("cps 0x10"); // switch CPU to USER mode
     // **********************************************************************
 
-    uint64_t time = sys_gettime();
+    volatile uint64_t time = sys_gettime();
 
     time++; // suppress compiler error
     return;
@@ -0,0 +1,75 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "util.h"
+
+//Un tampon assez grand pour rendre ses pages une fois libere.
+#define BUFFER_PAGE_NB 64
+//Un tampon au-dessus de HEAP_TRIM_THRESHOLD, mais de moins de HEAP_TOP_PAD : il garde ses pages.
+#define BAND_PAGE_NB 17
+
+struct pcb_s* process;
+//Les pages projetees a nouveau apres sys_free d'un tampon proche du seuil, d'un grand tampon
+//puis apres sys_madvise.
+uint32_t faults_in_band, faults_after_free, faults_after_madvise;
+//La somme du tampon relu apres sys_madvise.
+uint32_t madvised_sum;
+
+void fill(uint8_t* buffer, int page_nb, uint8_t value)
+{
+    for (int page = 0;page < page_nb;page++)
+    {
+        buffer[page * PAGE_SIZE] = value;
+    }
+}
+
+int trimming_process()
+{
+    //Le meme cycle d'allocation et de liberation, proche du seuil, ne refait pas de fautes.
+    uint8_t* buffer = (uint8_t*)sys_malloc(BAND_PAGE_NB * PAGE_SIZE);
+    fill(buffer, BAND_PAGE_NB, 1);
+    sys_free(buffer);
+    uint32_t faults = sys_process_page_faults(process);
+    buffer = (uint8_t*)sys_malloc(BAND_PAGE_NB * PAGE_SIZE);
+    fill(buffer, BAND_PAGE_NB, 2);
+    faults_in_band = sys_process_page_faults(process) - faults;
+    sys_free(buffer);
+
+    buffer = (uint8_t*)sys_malloc(BUFFER_PAGE_NB * PAGE_SIZE);
+    fill(buffer, BUFFER_PAGE_NB, 1);
+
+    //Le bloc libere rend ses frames au-dela de HEAP_TOP_PAD : le suivant doit les reprojeter.
+    sys_free(buffer);
+    faults = sys_process_page_faults(process);
+    buffer = (uint8_t*)sys_malloc(BUFFER_PAGE_NB * PAGE_SIZE);
+    fill(buffer, BUFFER_PAGE_NB, 2);
+    faults_after_free = sys_process_page_faults(process) - faults;
+
+    //Les pages rendues par sys_madvise sont relues remplies de 0.
+    sys_madvise(buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+    faults = sys_process_page_faults(process);
+    madvised_sum = 0;
+    for (int page = 1;page < BUFFER_PAGE_NB;page++)
+    {
+        madvised_sum += buffer[page * PAGE_SIZE];
+    }
+    faults_after_madvise = sys_process_page_faults(process) - faults;
+
+    sys_free(buffer);
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    process = create_process((func_t*)&trimming_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+
+    PANIC();
+}
@@ -0,0 +1,113 @@
+#include "stdint.h"
+#include "hw.h"
+#include "asm_tools.h"
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "heap.h"
+#include "util.h"
+
+//Les blocs laisses libres, un sur deux, pour allonger la liste de leur taille.
+#define FRAGMENT_NB 200
+#define PAIR_NB 1000
+#define BLOCK_SIZE 100
+
+struct pcb_s* process;
+//Passe a 1 si les trois blocs liberes ont ete fusionnes en un seul.
+int coalesced;
+//Les octets occupes avant les allocations et apres leur liberation.
+uint32_t used_before, used_after;
+//Les variations de la taille du tas et de sa fin, quand il grandit.
+uint32_t grown_size, grown_end;
+//Le cout de PAIR_NB liberations et allocations, avec une liste courte puis longue.
+uint32_t flat_cost, fragmented_cost;
+//Le resultat d'une allocation dans une liste bouclee par le processus.
+void* looped;
+
+uint32_t free_malloc_cost(void* block)
+{
+    uint32_t start = Get32(CLO);
+    for (int i = 0;i < PAIR_NB;i++)
+    {
+        sys_free(block);
+        block = sys_malloc(BLOCK_SIZE);
+    }
+    return Get32(CLO) - start;
+}
+
+int heap_process()
+{
+    //L'en-tete du tas est au debut de l'espace utilisateur, lisible par le processus.
+    Heap* heap = (Heap*)USER_SPACE_START;
+    void* first = sys_malloc(BLOCK_SIZE);
+
+    //Les blocs a, b et c sont voisins, d les separe du haut du tas.
+    used_before = heap->used;
+    uint8_t* a = (uint8_t*)sys_malloc(BLOCK_SIZE);
+    uint8_t* b = (uint8_t*)sys_malloc(BLOCK_SIZE);
+    uint8_t* c = (uint8_t*)sys_malloc(BLOCK_SIZE);
+    void* d = sys_malloc(BLOCK_SIZE);
+    sys_free(a);
+    sys_free(c);
+    //b est fusionne avec ses deux voisins : le bloc de a contient les trois.
+    sys_free(b);
+    uint8_t* merged = (uint8_t*)sys_malloc(3 * BLOCK_SIZE);
+    coalesced = merged == a;
+    sys_free(merged);
+    sys_free(d);
+    used_after = heap->used;
+
+    //Deux blocs libres trop petits, entoures de blocs occupes, dont le processus boucle la liste.
+    //La liste de leur taille n'est plus utilisee ensuite.
+    uint32_t* small = (uint32_t*)sys_malloc(32);
+    sys_malloc(BLOCK_SIZE);
+    uint32_t* larger = (uint32_t*)sys_malloc(40);
+    sys_malloc(BLOCK_SIZE);
+    sys_free(small);
+    sys_free(larger);
+    //Le lien vers le bloc suivant est juste apres l'etiquette, au debut de la zone rendue.
+    small[0] = (uint32_t)larger - 4;
+    looped = sys_malloc(48);
+
+    //La taille du tas suit sa fin quand des pages sont ajoutees.
+    uint32_t size = heap->size;
+    uint8_t* end = heap->end;
+    void* big = sys_malloc(8 * PAGE_SIZE);
+    grown_size = heap->size - size;
+    grown_end = heap->end - end;
+
+    //Le bloc mesure est entoure de blocs occupes : il n'est jamais fusionne.
+    void* measured = sys_malloc(BLOCK_SIZE);
+    void* guard = sys_malloc(BLOCK_SIZE);
+    flat_cost = free_malloc_cost(measured);
+    void* fragments[FRAGMENT_NB];
+    for (int i = 0;i < FRAGMENT_NB;i++)
+    {
+        fragments[i] = sys_malloc(BLOCK_SIZE);
+    }
+    for (int i = 0;i < FRAGMENT_NB;i += 2)
+    {
+        sys_free(fragments[i]);
+    }
+    fragmented_cost = free_malloc_cost(sys_malloc(BLOCK_SIZE));
+
+    sys_free(guard);
+    sys_free(big);
+    sys_free(first);
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    process = create_process((func_t*)&heap_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+
+    PANIC();
+}
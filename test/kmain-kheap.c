@@ -0,0 +1,31 @@
+#include "kheap.h"
+#include "util.h"
+
+struct kheap_stats before, after_merge, after_all;
+//Passe a 1 si un bloc aligne ne l'est pas.
+int misaligned;
+
+void kmain( void )
+{
+    kheap_init();
+    kheap_get_stats(&before);
+
+    uint8_t* a = kAlloc(100);
+    uint8_t* b = kAlloc(200);
+    uint8_t* c = kAlloc(24);
+
+    //a et b sont voisins : ils fusionnent en un seul bloc libre.
+    kFree(a, 100);
+    kFree(b, 200);
+    kheap_get_stats(&after_merge);
+
+    uint8_t* table = kAlloc_aligned(1024, 10);
+    misaligned = ((uint32_t)table & 1023) != 0;
+
+    //Le dernier bloc libere rejoint la fin du tas, avec ses voisins libres.
+    kFree(table, 1024);
+    kFree(c, 24);
+    kheap_get_stats(&after_all);
+
+    PANIC();
+}
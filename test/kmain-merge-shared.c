@@ -0,0 +1,90 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "config.h"
+#include "util.h"
+#include "merge.h"
+#include "page_table.h"
+
+#define BUFFER_PAGE_NB 4
+//Assez de passages pour examiner deux fois les pages des deux processus.
+#define YIELD_NB 16
+
+struct pcb_s* filler;
+struct pcb_s* scanner;
+uint8_t* filler_buffer;
+//Passe a 1 quand filler a rempli son tampon et attend scanner.
+volatile int filled;
+//Les pages partagees et les pages economisees par le scanner pendant les passages.
+uint32_t merged_pages, saved_pages;
+//1 si les pages des deux processus sont projetees sur la meme frame.
+uint32_t same_frame;
+
+void fill(uint8_t* buffer)
+{
+    for (int i = 0;i < BUFFER_PAGE_NB * PAGE_SIZE;i++)
+    {
+        buffer[i] = (uint8_t)((i % PAGE_SIZE) * 29 + 3);
+    }
+}
+
+int filler_process()
+{
+    filler_buffer = (uint8_t*)sys_mmap(BUFFER_PAGE_NB * PAGE_SIZE);
+    fill(filler_buffer);
+    filled = 1;
+    //filler est bloque : scanner est seul pret, ses sys_yield font tourner le scanner.
+    sys_wait(scanner);
+    sys_munmap(filler_buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+    return EXIT_SUCCESS;
+}
+
+int scanner_process()
+{
+    uint8_t* buffer = (uint8_t*)sys_mmap(BUFFER_PAGE_NB * PAGE_SIZE);
+    fill(buffer);
+    while (!filled)
+    {
+        sys_yield();
+    }
+
+    MergeStats stats;
+    merge_get_stats(&stats);
+    uint32_t merged_before = stats.merged_pages;
+    uint32_t saved_before = stats.saved_pages;
+    for (int i = 0;i < YIELD_NB;i++)
+    {
+        sys_yield();
+    }
+    merge_get_stats(&stats);
+    merged_pages = stats.merged_pages - merged_before;
+    saved_pages = stats.saved_pages - saved_before;
+
+    //Les pages de filler sont examinees sans que sa table soit chargee.
+    uint32_t first_frame = vmem_translate((uint32_t)filler_buffer, filler->page_table) / PAGE_SIZE;
+    same_frame = 1;
+    for (int page = 0;page < BUFFER_PAGE_NB;page++)
+    {
+        same_frame &= vmem_translate((uint32_t)(filler_buffer + page * PAGE_SIZE), filler->page_table) / PAGE_SIZE == first_frame;
+        same_frame &= vmem_translate((uint32_t)(buffer + page * PAGE_SIZE), get_current_process_page_table()) / PAGE_SIZE == first_frame;
+    }
+
+    sys_munmap(buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    filler = create_process((func_t*)&filler_process, 0, PROCESS_STACK_LIMIT);
+    scanner = create_process((func_t*)&scanner_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(filler);
+
+    PANIC();
+}
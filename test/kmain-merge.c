@@ -0,0 +1,89 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "config.h"
+#include "util.h"
+#include "merge.h"
+#include "page_table.h"
+
+#define BUFFER_PAGE_NB 8
+//Assez de passages pour examiner deux fois toutes les pages des zones du processus.
+#define YIELD_NB 16
+
+extern uint32_t zeroed_frame_count;
+
+struct pcb_s* process;
+//Les pages partagees et les pages economisees par le scanner pendant les passages.
+uint32_t merged_pages, saved_pages;
+//Les frames rendues a l'allocateur pendant les passages, sans compter la reserve de frames nulles.
+uint32_t released_frames;
+//1 si toutes les pages du tampon sont projetees sur la meme frame.
+uint32_t same_frame;
+//Apres une ecriture dans une page du tampon : 1 si elle a sa propre frame,
+//1 si les contenus sont corrects, et les pages economisees.
+uint32_t split_frame, split_content, saved_after_split;
+
+uint32_t available_frames()
+{
+    return get_free_frame_count_occupancy_table() + zeroed_frame_count;
+}
+
+int merge_process()
+{
+    uint8_t* buffer = (uint8_t*)sys_mmap(BUFFER_PAGE_NB * PAGE_SIZE);
+    uint32_t* page_table = get_current_process_page_table();
+    for (int page = 0;page < BUFFER_PAGE_NB;page++)
+    {
+        for (int i = 0;i < PAGE_SIZE;i++)
+        {
+            buffer[page * PAGE_SIZE + i] = (uint8_t)(i * 13 + 7);
+        }
+    }
+
+    MergeStats stats;
+    merge_get_stats(&stats);
+    uint32_t merged_before = stats.merged_pages;
+    uint32_t saved_before = stats.saved_pages;
+    uint32_t available_before = available_frames();
+    for (int i = 0;i < YIELD_NB;i++)
+    {
+        sys_yield();
+    }
+    released_frames = available_frames() - available_before;
+    merge_get_stats(&stats);
+    merged_pages = stats.merged_pages - merged_before;
+    saved_pages = stats.saved_pages - saved_before;
+
+    uint32_t first_frame = vmem_translate((uint32_t)buffer, page_table) / PAGE_SIZE;
+    same_frame = 1;
+    for (int page = 1;page < BUFFER_PAGE_NB;page++)
+    {
+        same_frame &= vmem_translate((uint32_t)(buffer + page * PAGE_SIZE), page_table) / PAGE_SIZE == first_frame;
+    }
+
+    //L'ecriture copie la page partagee, les autres pages ne voient rien.
+    buffer[3 * PAGE_SIZE] = 0xEE;
+    split_frame = vmem_translate((uint32_t)(buffer + 3 * PAGE_SIZE), page_table) / PAGE_SIZE != first_frame;
+    split_content = buffer[3 * PAGE_SIZE] == 0xEE && buffer[3 * PAGE_SIZE + 1] == 20
+        && buffer[0] == 7 && buffer[4 * PAGE_SIZE] == 7;
+    merge_get_stats(&stats);
+    saved_after_split = stats.saved_pages - saved_before;
+
+    sys_munmap(buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    process = create_process((func_t*)&merge_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+
+    PANIC();
+}
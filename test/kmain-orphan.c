@@ -0,0 +1,45 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "util.h"
+
+extern struct pcb_s kmain_process;
+
+int parent_status, orphan_status, none_status;
+struct pcb_s *orphan, *none;
+
+int orphaning_parent()
+{
+    //Le fils survit a son pere, qui ne l'attend pas.
+    struct pcb_s* child = sys_fork();
+    if (child == FORK_FAILED)
+    {
+        return EXIT_FAILURE;
+    }
+    if (child == 0)
+    {
+        for (volatile int i = 0;i < 100000;i++);
+        return 9;
+    }
+    return 1;
+}
+
+void kmain( void )
+{
+    struct pcb_s* parent;
+
+    kheap_init();
+    sched_init();
+
+    parent = create_process((func_t*)&orphaning_parent, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    parent_status = sys_wait(parent);
+    //Le fils orphelin a ete adopte par kmain.
+    orphan = sys_wait_any(&orphan_status);
+    none = sys_wait_any(&none_status);
+
+    PANIC();
+}
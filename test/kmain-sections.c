@@ -0,0 +1,37 @@
+#include "sched.h"
+#include "kheap.h"
+#include "page_table.h"
+#include "vmem.h"
+#include "slab.h"
+#include "fb.h"
+#include "hw.h"
+#include "util.h"
+
+extern uint32_t* mmu_table_base;
+extern SlabCache second_level_table_cache;
+
+//Les entrees de niveau 1 du noyau et des devices.
+uint32_t kernel_descriptor, device_descriptor;
+//Les traductions d'une adresse du noyau, d'un device et du dernier pixel.
+uint32_t kernel_pa, device_pa, framebuffer_pa, framebuffer_va;
+//Le nombre de tables de niveau 2 de la table du noyau.
+uint32_t kernel_tables;
+
+void kmain( void )
+{
+    hw_init();
+    FramebufferInitialize();
+    kheap_init();
+    sched_init();
+
+    kernel_descriptor = mmu_table_base[0x8000 / SECTION_SIZE];
+    device_descriptor = mmu_table_base[DEVICE_SPACE_START / SECTION_SIZE];
+    kernel_pa = vmem_translate(0x8004, mmu_table_base);
+    device_pa = vmem_translate(DEVICE_SPACE_START + 0x200008, mmu_table_base);
+    framebuffer_va = getAddressFB() + getSizeFB() - 4;
+    framebuffer_pa = vmem_translate(framebuffer_va, mmu_table_base);
+    //Les tables de niveau 2 du framebuffer et du break de kmain.
+    kernel_tables = slab_cache_object_count(&second_level_table_cache);
+
+    PANIC();
+}
@@ -0,0 +1,45 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "slab.h"
+#include "util.h"
+
+#define CHILD_NB 3
+
+extern SlabCache pcb_cache;
+extern SlabCache second_level_table_cache;
+
+struct pcb_s* children[CHILD_NB];
+uint32_t pcb_before, pcb_created, pcb_after;
+uint32_t tables_created, tables_after;
+
+int child()
+{
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    pcb_before = slab_cache_object_count(&pcb_cache);
+    for (int i = 0;i < CHILD_NB;i++)
+    {
+        children[i] = create_process((func_t*)&child, 0, PROCESS_STACK_LIMIT);
+    }
+    pcb_created = slab_cache_object_count(&pcb_cache);
+    tables_created = slab_cache_object_count(&second_level_table_cache);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    for (int i = 0;i < CHILD_NB;i++)
+    {
+        sys_wait(children[i]);
+    }
+    pcb_after = slab_cache_object_count(&pcb_cache);
+    tables_after = slab_cache_object_count(&second_level_table_cache);
+
+    PANIC();
+}
@@ -0,0 +1,90 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "page_table.h"
+#include "util.h"
+
+//Chaque appel de recurse occupe un peu plus d'1ko de pile.
+#define DEEP_DEPTH 40
+#define DEEP_STACK_SIZE (16 * PAGE_SIZE)
+#define OVERFLOW_DEPTH 64
+#define OVERFLOW_STACK_SIZE (4 * PAGE_SIZE)
+
+struct pcb_s *idle, *deep, *overflow;
+//Les pages reservees ou projetees de la pile de chaque processus.
+uint32_t idle_pages, deep_pages;
+//Passe a 1 si le processus survit au debordement de sa pile.
+int overflow_survived;
+volatile int idle_done;
+
+uint32_t stack_pages(struct pcb_s* process)
+{
+    uint32_t first_page = ((uint32_t)process->debut_sp - process->stack_size) / PAGE_SIZE;
+    uint32_t count = 0;
+    for (uint32_t page = first_page;page < first_page + process->stack_size / PAGE_SIZE;page++)
+    {
+        if (get_entry_page_table(process->page_table, page / SECOND_LVL_TT_COUNT, page % SECOND_LVL_TT_COUNT) != 0)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int recurse(int depth)
+{
+    volatile uint8_t frame[1024];
+    frame[0] = depth;
+    frame[sizeof(frame) - 1] = depth;
+    if (depth == 0)
+    {
+        return frame[0];
+    }
+    return recurse(depth - 1) + frame[sizeof(frame) - 1];
+}
+
+int idle_process()
+{
+    while (!idle_done)
+    {
+        sys_yield();
+    }
+    return EXIT_SUCCESS;
+}
+
+int deep_process()
+{
+    recurse(DEEP_DEPTH);
+    deep_pages = stack_pages(deep);
+    return EXIT_SUCCESS;
+}
+
+int overflow_process()
+{
+    //La pile touche sa page de garde avant la fin de la recursion.
+    recurse(OVERFLOW_DEPTH);
+    overflow_survived = 1;
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    idle = create_process((func_t*)&idle_process, 0, PAGE_SIZE);
+    deep = create_process((func_t*)&deep_process, 0, DEEP_STACK_SIZE);
+    overflow = create_process((func_t*)&overflow_process, 0, OVERFLOW_STACK_SIZE);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(deep);
+    sys_wait(overflow);
+    //Le processus inactif a deja tourne, il n'a touche que le haut de sa pile.
+    idle_pages = stack_pages(idle);
+    idle_done = 1;
+    sys_wait(idle);
+
+    PANIC();
+}
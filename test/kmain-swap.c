@@ -0,0 +1,73 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "config.h"
+#include "util.h"
+#include "swap.h"
+#include "page_table.h"
+
+//Le tampon du processus est quatre fois plus grand que la memoire qui lui reste.
+#define FREE_FRAME_NB 64
+#define BUFFER_PAGE_NB 256
+
+struct pcb_s* process;
+//Le swap trouve sur la carte, en pages.
+uint32_t slot_count;
+//Les pages examinees, evincees et relues pendant que le processus parcourt son tampon.
+uint32_t scanned_pages, evicted_pages, swapped_in_pages;
+//1 si toutes les pages du tampon ont garde leur contenu.
+uint32_t content_ok;
+
+int swap_process()
+{
+    uint32_t* buffer = (uint32_t*)sys_mmap(BUFFER_PAGE_NB * PAGE_SIZE);
+    SwapStats before;
+    swap_get_stats(&before);
+
+    //Chaque page a son propre contenu : une page relue a la place d'une autre se verrait.
+    for (uint32_t page = 0;page < BUFFER_PAGE_NB;page++)
+    {
+        for (uint32_t i = 0;i < PAGE_SIZE / sizeof(uint32_t);i++)
+        {
+            buffer[page * PAGE_SIZE / sizeof(uint32_t) + i] = page * 0x10001 + i;
+        }
+    }
+    content_ok = 1;
+    for (uint32_t page = 0;page < BUFFER_PAGE_NB;page++)
+    {
+        for (uint32_t i = 0;i < PAGE_SIZE / sizeof(uint32_t);i++)
+        {
+            content_ok &= buffer[page * PAGE_SIZE / sizeof(uint32_t) + i] == page * 0x10001 + i;
+        }
+    }
+
+    SwapStats after;
+    swap_get_stats(&after);
+    slot_count = after.slot_count;
+    scanned_pages = after.scanned_pages - before.scanned_pages;
+    evicted_pages = after.evicted_pages - before.evicted_pages;
+    swapped_in_pages = after.swapped_in_pages - before.swapped_in_pages;
+
+    sys_munmap(buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    //Les frames en trop sont retirees a l'allocateur, sans etre rendues.
+    while (get_free_frame_count_occupancy_table() > FREE_FRAME_NB)
+    {
+        set_frame_occupancy_table(find_free_frame_occupancy_table(), 1);
+    }
+    process = create_process((func_t*)&swap_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+
+    PANIC();
+}
@@ -0,0 +1,69 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "slab.h"
+#include "util.h"
+
+extern SlabCache vma_cache;
+
+struct pcb_s* process;
+//Le nombre de zones du processus au debut, puis apres chaque operation.
+uint32_t initial_count, merged_count, split_count, refilled_count;
+//1 si les projections sont placees comme attendu.
+uint32_t adjacent, hole_reused, stack_kept, cloned;
+//Le nombre d'ensembles de zones alloues une fois le processus termine.
+uint32_t sets_after;
+
+int vma_process()
+{
+    VmaSet* vmas = get_current_process_vmas();
+    initial_count = vmas->count;
+
+    //Deux projections contigues forment une seule zone.
+    uint8_t* first = (uint8_t*)sys_mmap(3 * PAGE_SIZE);
+    uint8_t* second = (uint8_t*)sys_mmap(2 * PAGE_SIZE);
+    adjacent = (second == first + 3 * PAGE_SIZE);
+    merged_count = vmas->count;
+
+    //Liberer une page au milieu coupe la zone, la page libre est reprise par la suivante.
+    sys_munmap(first + PAGE_SIZE, PAGE_SIZE);
+    split_count = vmas->count;
+    hole_reused = (sys_mmap(PAGE_SIZE) == first + PAGE_SIZE);
+    refilled_count = vmas->count;
+
+    //La pile n'est pas une projection de sys_mmap.
+    uint8_t* stack_page = (uint8_t*)get_current_process()->debut_sp - PAGE_SIZE;
+    sys_munmap(stack_page, PAGE_SIZE);
+    stack_kept = (vma_find(vmas, (uint32_t)stack_page) != 0);
+
+    //Le fils a sa propre copie des zones.
+    struct pcb_s* child = sys_fork();
+    if (child == FORK_FAILED)
+    {
+        return EXIT_FAILURE;
+    }
+    if (child == 0)
+    {
+        return EXIT_SUCCESS;
+    }
+    cloned = (child->vmas != vmas && child->vmas->count == vmas->count);
+    sys_wait(child);
+
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+
+    process = create_process((func_t*)&vma_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+    sets_after = slab_cache_object_count(&vma_cache);
+
+    PANIC();
+}
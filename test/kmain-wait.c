@@ -0,0 +1,41 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "util.h"
+
+int status, any_status, none_status;
+struct pcb_s *any, *none;
+
+int long_child()
+{
+    for (volatile int i = 0;i < 100000;i++);
+    return 42;
+}
+
+int quick_child()
+{
+    return 7;
+}
+
+void kmain( void )
+{
+    struct pcb_s* child;
+
+    kheap_init();
+    sched_init();
+
+    child = create_process((func_t*)&long_child, 0, PROCESS_STACK_LIMIT);
+    create_process((func_t*)&quick_child, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    //quick_child se termine pendant qu'on attend long_child : il reste zombie.
+    status = sys_wait(child);
+    //On le recupere sans savoir lequel des enfants c'est.
+    any = sys_wait_any(&any_status);
+    //Il n'y a plus d'enfant.
+    none = sys_wait_any(&none_status);
+
+    PANIC();
+}
@@ -1,11 +1,13 @@
 #include "syscall.h"
 #include "sched.h"
+#include "kheap.h"
 
-#define NB_PROCESS 5
+//Des centaines de processus vivants : le choix du suivant ne doit pas en dependre.
+#define NB_PROCESS 200
 
 void user_process()
 {
-    int v=0;
+    volatile int v=0;
     for(;;)
     {
         v++;
@@ -15,12 +17,13 @@ void user_process()
 
 void kmain( void )
 {
+    kheap_init();
     sched_init();
 
     int i;
     for(i=0;i<NB_PROCESS;i++)
     {
-        create_process((func_t*)&user_process);
+        create_process((func_t*)&user_process, 0, PROCESS_STACK_LIMIT);
     }
 
     __asm("cps 0x10"); // switch CPU to USER mode
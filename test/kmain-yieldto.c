@@ -1,12 +1,13 @@
 #include "util.h"
 #include "syscall.h"
 #include "sched.h"
+#include "kheap.h"
 
 struct pcb_s *p1, *p2;
 
 void user_process_1()
 {
-    int v1=5;
+    volatile int v1=5;
     while(1)
     {
         v1++;
@@ -16,7 +17,7 @@ void user_process_1()
 
 void user_process_2()
 {
-    int v2=-12;
+    volatile int v2=-12;
     while(1)
     {
         v2-=2;
@@ -26,10 +27,11 @@ void user_process_2()
 
 void kmain( void )
 {    
+    kheap_init();
     sched_init();
     
-    p1=create_process((func_t*)&user_process_1);
-    p2=create_process((func_t*)&user_process_2);
+    p1=create_process((func_t*)&user_process_1, 0, PROCESS_STACK_LIMIT);
+    p2=create_process((func_t*)&user_process_2, 0, PROCESS_STACK_LIMIT);
     
     __asm("cps 0x10"); // switch CPU to USER mode
     // **********************************************************************
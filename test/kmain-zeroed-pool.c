@@ -0,0 +1,75 @@
+#include "syscall.h"
+#include "sched.h"
+#include "kheap.h"
+#include "config.h"
+#include "util.h"
+
+//Moins de pages que la reserve n'a de frames.
+#define BUFFER_PAGE_NB 8
+
+extern uint32_t zeroed_frame_count;
+extern uint32_t zeroed_hit_count, zeroed_miss_count;
+
+struct pcb_s* process;
+//Les frames de la reserve au demarrage, puis une fois le processus termine.
+uint32_t pool_at_start, pool_at_end;
+//Les frames prises dans la reserve et remplies pendant l'erreur de page, en touchant le tampon.
+uint32_t hits, misses;
+//La somme d'un tampon projete sur les frames d'un tampon deja ecrit.
+uint32_t reused_sum;
+
+void touch(uint8_t* buffer, uint8_t value)
+{
+    for (int page = 0;page < BUFFER_PAGE_NB;page++)
+    {
+        buffer[page * PAGE_SIZE] = value;
+    }
+}
+
+int pool_process()
+{
+    uint8_t* buffer = (uint8_t*)sys_mmap(BUFFER_PAGE_NB * PAGE_SIZE);
+    uint32_t hits_before = zeroed_hit_count;
+    uint32_t misses_before = zeroed_miss_count;
+    touch(buffer, 0xFF);
+    hits = zeroed_hit_count - hits_before;
+    misses = zeroed_miss_count - misses_before;
+    sys_munmap(buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+
+    //Les frames rendues ne reviennent qu'une fois remplies de 0.
+    for (int i = 0;i < ZEROED_POOL_SIZE / ZEROED_FRAMES_PER_YIELD;i++)
+    {
+        sys_yield();
+    }
+    buffer = (uint8_t*)sys_mmap(BUFFER_PAGE_NB * PAGE_SIZE);
+    reused_sum = 0;
+    for (int i = 0;i < BUFFER_PAGE_NB * PAGE_SIZE;i++)
+    {
+        reused_sum += buffer[i];
+    }
+    sys_munmap(buffer, BUFFER_PAGE_NB * PAGE_SIZE);
+
+    //La reserve se remplit quand le processus n'a rien a faire.
+    for (int i = 0;i < ZEROED_POOL_SIZE / ZEROED_FRAMES_PER_YIELD;i++)
+    {
+        sys_yield();
+    }
+    pool_at_end = zeroed_frame_count;
+    return EXIT_SUCCESS;
+}
+
+void kmain( void )
+{
+    kheap_init();
+    sched_init();
+    pool_at_start = zeroed_frame_count;
+
+    process = create_process((func_t*)&pool_process, 0, PROCESS_STACK_LIMIT);
+
+    __asm("cps 0x10"); // switch CPU to USER mode
+    // **********************************************************************
+
+    sys_wait(process);
+
+    PANIC();
+}